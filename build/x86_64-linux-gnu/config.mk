@@ -0,0 +1,9 @@
+# config.mk generated on Mon Oct 19 16:10:12 UTC 2026
+# CXX=g++
+# CXXFLAGS=-W -Wall -O3 -fno-exceptions 
+HAVE_GETOPT = 1
+HAVE_MMAP = 1
+HAVE_PTHREAD = 1
+HAVE_READLINE = 0
+HAVE_SNPRINTF = 1
+HAVE_STRTOK_R = 1
@@ -0,0 +1,41 @@
+#!/bin/sh
+config_mk="$1"
+config_log="$2"
+
+echo -n "Checking if mmap is available..." | tee -a "$config_log"
+
+if [ -z "$CXX" ]; then
+	echo "CXX not defined" >&2
+	exit 2
+elif ! $CXX --version >/dev/null 2>&1; then
+	echo "CXX not working" >&2
+	exit 2
+fi
+
+tmpdir=`mktemp -d` || exit 2
+
+cat > "$tmpdir"/test.cc <<EOF2
+#include <sys/mman.h>
+#include <stddef.h>
+
+int main()
+{
+	void * p = mmap(NULL, 4096, PROT_READ, MAP_SHARED, 0, 0);
+	return (p == MAP_FAILED) ? 1 : munmap(p, 4096);
+}
+EOF2
+
+$CXX $CXXFLAGS -o "$tmpdir"/test "$tmpdir"/test.cc >> "$config_log" 2>&1
+ret=$?
+
+rm -rf "$tmpdir"
+
+if [ $ret -eq 0 ]; then
+	echo "yes" | tee -a "$config_log"
+	echo "HAVE_MMAP = 1" >> "$config_mk"
+	exit 0
+else
+	echo "no" | tee -a "$config_log"
+	echo "HAVE_MMAP = 0" >> "$config_mk"
+	exit 0
+fi
@@ -82,4 +82,11 @@ std::string opening_fen();
 typedef uint64_t Hashkey;
 #define NULLHASHKEY	((uint64_t) 0)
 
+/* Material signature, see Board::get_materialkey(): the number of pieces
+ * of each color and type, four bits each. */
+#define MATERIALKEY_SHIFT(c, p)		(4 * ((c) * 6 + (p)))
+#define MATERIALKEY_ONE(c, p)		((Hashkey) 1 << MATERIALKEY_SHIFT(c, p))
+#define MATERIALKEY_COUNT(key, c, p)	\
+	((unsigned int) ((key) >> MATERIALKEY_SHIFT(c, p)) & 15)
+
 #endif // BASIC_H
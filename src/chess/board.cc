@@ -100,6 +100,10 @@ void Board::clear()
 
 	material[WHITE] = 0;
 	material[BLACK] = 0;
+	psq_mg[WHITE] = 0;
+	psq_mg[BLACK] = 0;
+	psq_eg[WHITE] = 0;
+	psq_eg[BLACK] = 0;
 	has_castled[WHITE] = false;
 	has_castled[BLACK] = false;
 
@@ -109,6 +113,7 @@ void Board::clear()
 	
 	hashkey = NULLHASHKEY;
 	pawnhashkey = NULLHASHKEY;
+	materialkey = NULLHASHKEY;
 }
 
 #ifdef USE_UNMAKE_MOVE
@@ -580,6 +585,27 @@ void Board::switch_sides()
 	pawnhashkey ^= hash_side; // ?
 }
 
+/*
+ * Recompute the piece-square sums, after Evaluator::init() has
+ * changed the piece-square tables.
+ */
+void Board::update_psq()
+{
+	for (Color c = WHITE; c <= BLACK; c++) {
+		psq_mg[c] = 0;
+		psq_eg[c] = 0;
+		for (Piece p = PAWN; p <= KING; p++) {
+			Bitboard bb = position[c][p];
+			while (bb) {
+				Square sq = bb.firstbit();
+				bb.clearbit(sq);
+				psq_mg[c] += psq_table_mg[c][p][sq];
+				psq_eg[c] += psq_table_eg[c][p][sq];
+			}
+		}
+	}
+}
+
 void Board::place_piece(Square sq, Color side, Piece ptype)
 {
 	ASSERT_DEBUG(color_at(sq) == NO_COLOR);
@@ -597,6 +623,9 @@ void Board::place_piece(Square sq, Color side, Piece ptype)
 	}
 	
 	material[side] += mat_values[ptype];
+	materialkey += MATERIALKEY_ONE(side, ptype);
+	psq_mg[side] += psq_table_mg[side][ptype][sq];
+	psq_eg[side] += psq_table_eg[side][ptype][sq];
 	
 	hashkey ^= hashkeys[side][ptype][sq];
 	/* Alternative (also for remove_piece() and move_piece()):
@@ -634,6 +663,9 @@ void Board::remove_piece(Square sq, Color side, Piece ptype)
 	}
 	
 	material[side] -= mat_values[ptype];
+	materialkey -= MATERIALKEY_ONE(side, ptype);
+	psq_mg[side] -= psq_table_mg[side][ptype][sq];
+	psq_eg[side] -= psq_table_eg[side][ptype][sq];
 	
 	hashkey ^= hashkeys[side][ptype][sq];
 	/* See place_piece() for a comment */
@@ -666,6 +698,11 @@ void Board::move_piece(Square from, Square to, Color side, Piece ptype)
 		king[side] = to;
 	}
 
+	psq_mg[side] += psq_table_mg[side][ptype][to]
+		- psq_table_mg[side][ptype][from];
+	psq_eg[side] += psq_table_eg[side][ptype][to]
+		- psq_table_eg[side][ptype][from];
+
 	/* A quick implementation of a pre-computed table
 	 * with all from-to-pairs to reduce computation here
 	 * did not show a significant speed benefit. */
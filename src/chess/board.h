@@ -44,6 +44,8 @@ class BoardHistory;
 class Board
 {
 	friend class Evaluator;
+	friend class NNUE;
+	friend class MoveParser;
 
 	/* Data Members */
       private:
@@ -64,12 +66,15 @@ class Board
 	Square 		epsq;
 
 	int 		material[2];
+	int		psq_mg[2];		// piece-square sums, see
+	int		psq_eg[2];		// Evaluator::init()
 	bool 		has_castled[2];		// TODO pack into flags
 
 	unsigned int	pce_movecnt[64];	// TODO replace by Bitboard?
 
 	Hashkey 	hashkey;
 	Hashkey 	pawnhashkey;
+	Hashkey		materialkey;		// piece counts, see basic.h
 
 	
 	/* Constructors / Destructor, defined in board.cc */
@@ -104,6 +109,9 @@ class Board
 	Hashkey get_pawnhashkey() const
 	{ return pawnhashkey; }
 
+	Hashkey get_materialkey() const
+	{ return materialkey; }
+
 	inline Hashkey get_hashkey_noside() const;
 	inline unsigned int get_pce_movecnt(Square sq) const;
 
@@ -140,6 +148,7 @@ class Board
 	/* Basic board functions, defined in board.cc */
       public:
 	void clear();
+	void update_psq();
 #ifdef USE_UNMAKE_MOVE
 	BoardHistory make_move(Move mov);
 	void unmake_move(const BoardHistory & hist);
@@ -206,6 +215,16 @@ class Board
 	void generate_noncaptures(Movelist * movelist) const;
 	void generate_escapes(Movelist * movelist) const;
       private:
+	/* Specialized for the side to move, so that color dependent
+	 * lookups and branches are resolved at compile time. The
+	 * public functions above dispatch to these once per call. */
+	template <Color SIDE>
+	void generate_captures(Movelist * movelist, bool allpromo) const;
+	template <Color SIDE>
+	void generate_noncaptures(Movelist * movelist) const;
+	template <Color SIDE>
+	void generate_escapes(Movelist * movelist) const;
+
 	void generate_castling(Movelist * movelist) const;
 	void add_move(Movelist * movelist, Square from, Square to,
 			bool allpromo) const;	
@@ -234,6 +253,8 @@ class Board
 	/* Static Data Members */
       private:
 	static Hashkey hashkeys[2][6][64];
+	static int psq_table_mg[2][6][64];
+	static int psq_table_eg[2][6][64];
 	static Hashkey hash_side;
 	static Hashkey hash_ep[64];
 	static Hashkey hash_wk;
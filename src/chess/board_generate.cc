@@ -29,6 +29,23 @@
  */
 //#define USE_INDEPENDENT_GENERATE_MOVES
 
+/*
+ * Helpers for the color-specialized generators below: pawn pushes in the
+ * direction of SIDE, for a single square and for a whole bitboard.
+ */
+template <Color SIDE>
+static FORCEINLINE Square pawn_push_sq(Square sq)
+{
+	return (SIDE == WHITE) ? sq + 8 : sq - 8;
+}
+
+template <Color SIDE>
+static FORCEINLINE Bitboard pawn_push_bb(Bitboard bb)
+{
+	return (SIDE == WHITE) ? Bitboard((uint64_t) bb << 8)
+		: Bitboard((uint64_t) bb >> 8);
+}
+
 void Board::generate_moves(Movelist * movelist, bool allpromo) const
 {
 #ifndef USE_INDEPENDENT_GENERATE_MOVES
@@ -220,18 +237,31 @@ void Board::generate_moves(Movelist * movelist, bool allpromo) const
  */
 void Board::generate_captures(Movelist * movelist, bool allpromo) const 
 {
+	if (side == WHITE) {
+		generate_captures<WHITE>(movelist, allpromo);
+	} else {
+		generate_captures<BLACK>(movelist, allpromo);
+	}
+}
+
+template <Color SIDE>
+void Board::generate_captures(Movelist * movelist, bool allpromo) const 
+{
+	const Color xside = XSIDE(SIDE);
+	const Bitboard rank7 = Bitboard::rank[SIDE == WHITE ? RANK7 : RANK2];
+	const Bitboard targets = get_pieces(xside);
+
 	Bitboard bb, to_bb;
 	Square from, to;
 
 	/* pawn promotions and promotion-captures */
-	bb = get_pawns(side) & (side == WHITE ? Bitboard::rank[RANK7]
-			: Bitboard::rank[RANK2]);
+	bb = get_pawns(SIDE) & rank7;
 	while (bb) {
 		from = bb.firstbit();
 		bb.clearbit(from);
 
 		/* promotion-captures */
-		to_bb = pawn_captures(from, side) & get_pieces(XSIDE(side));
+		to_bb = Bitboard::pawn_capt_bb[SIDE][from] & targets;
 		while (to_bb) {
 			to = to_bb.firstbit();
 			to_bb.clearbit(to);
@@ -250,11 +280,8 @@ void Board::generate_captures(Movelist * movelist, bool allpromo) const
 		}
 
 		/* promotions */
-		to_bb = pawn_noncaptures(from, side);
-		while (to_bb) {
-			to = to_bb.firstbit();
-			to_bb.clearbit(to);
-
+		to = pawn_push_sq<SIDE>(from);
+		if (!get_blocker().testbit(to)) {
 			movelist->add(Move::promotion(from, to, QUEEN));
 			movelist->add(Move::promotion(from, to, KNIGHT));
 			if (allpromo) {
@@ -267,13 +294,16 @@ void Board::generate_captures(Movelist * movelist, bool allpromo) const
 	}
 	
 	/* pawn captures */
-	bb = get_pawns(side) & ~(side == WHITE ? Bitboard::rank[RANK7]
-			: Bitboard::rank[RANK2]);
+	Bitboard pawn_targets = targets;
+	if (epsq != NO_SQUARE) {
+		pawn_targets.setbit(epsq);
+	}
+	bb = get_pawns(SIDE) & ~rank7;
 	while (bb) {
 		from = bb.firstbit();
 		bb.clearbit(from);
 
-		to_bb = pawn_captures(from, side) & ~get_pieces(side);
+		to_bb = Bitboard::pawn_capt_bb[SIDE][from] & pawn_targets;
 		while (to_bb) {
 			to = to_bb.firstbit();
 			to_bb.clearbit(to);
@@ -288,12 +318,12 @@ void Board::generate_captures(Movelist * movelist, bool allpromo) const
 	}
 
 	/* knights */
-	bb = get_knights(side);
+	bb = get_knights(SIDE);
 	while (bb) {
 		from = bb.firstbit();
 		bb.clearbit(from);
 
-		to_bb = knight_attacks(from) & get_pieces(XSIDE(side));
+		to_bb = knight_attacks(from) & targets;
 		while (to_bb) {
 			to = to_bb.firstbit();
 			to_bb.clearbit(to);
@@ -304,12 +334,12 @@ void Board::generate_captures(Movelist * movelist, bool allpromo) const
 	}
 	
 	/* bishops */
-	bb = get_bishops(side);
+	bb = get_bishops(SIDE);
 	while (bb) {
 		from = bb.firstbit();
 		bb.clearbit(from);
 
-		to_bb = bishop_attacks(from) & get_pieces(XSIDE(side));
+		to_bb = bishop_attacks(from) & targets;
 		while (to_bb) {
 			to = to_bb.firstbit();
 			to_bb.clearbit(to);
@@ -320,12 +350,12 @@ void Board::generate_captures(Movelist * movelist, bool allpromo) const
 	}
 
 	/* rooks */
-	bb = get_rooks(side);
+	bb = get_rooks(SIDE);
 	while (bb) {
 		from = bb.firstbit();
 		bb.clearbit(from);
 
-		to_bb = rook_attacks(from) & get_pieces(XSIDE(side));
+		to_bb = rook_attacks(from) & targets;
 		while (to_bb) {
 			to = to_bb.firstbit();
 			to_bb.clearbit(to);
@@ -336,12 +366,12 @@ void Board::generate_captures(Movelist * movelist, bool allpromo) const
 	}
 
 	/* queens */
-	bb = get_queens(side);
+	bb = get_queens(SIDE);
 	while (bb) {
 		from = bb.firstbit();
 		bb.clearbit(from);
 
-		to_bb = queen_attacks(from) & get_pieces(XSIDE(side));
+		to_bb = queen_attacks(from) & targets;
 		while (to_bb) {
 			to = to_bb.firstbit();
 			to_bb.clearbit(to);
@@ -352,8 +382,8 @@ void Board::generate_captures(Movelist * movelist, bool allpromo) const
 	}
 
 	/* king, only one */
-	from = get_king(side);
-	to_bb = king_attacks(from) & get_pieces(XSIDE(side));
+	from = get_king(SIDE);
+	to_bb = king_attacks(from) & targets;
 	while (to_bb) {
 		to = to_bb.firstbit();
 		to_bb.clearbit(to);
@@ -363,40 +393,57 @@ void Board::generate_captures(Movelist * movelist, bool allpromo) const
 	}
 }
 
+
 /*
  * This routine generates all moves except captures and promotions.
  */
 void Board::generate_noncaptures(Movelist * movelist) const
 {
+	if (side == WHITE) {
+		generate_noncaptures<WHITE>(movelist);
+	} else {
+		generate_noncaptures<BLACK>(movelist);
+	}
+}
+
+template <Color SIDE>
+void Board::generate_noncaptures(Movelist * movelist) const
+{
+	const Bitboard rank3 = Bitboard::rank[SIDE == WHITE ? RANK3 : RANK6];
+	const Bitboard rank7 = Bitboard::rank[SIDE == WHITE ? RANK7 : RANK2];
+	const Bitboard empty = ~get_blocker();
+
 	Bitboard bb, to_bb;
 	Square from, to;
 	
 	/* first try castling */
 	generate_castling(movelist);
 
-	/* pawn non-captures non-promotions */
-	bb = get_pawns(side) & ~(side == WHITE ? Bitboard::rank[RANK7] 
-				: Bitboard::rank[RANK2]);
-	while (bb) {
-		from = bb.firstbit();
-		bb.clearbit(from);
-	
-		to_bb = pawn_noncaptures(from, side);
-		while (to_bb) {
-			to = to_bb.firstbit();
-			to_bb.clearbit(to);
+	/* pawn non-captures non-promotions, all pawns at once */
+	Bitboard single = pawn_push_bb<SIDE>(get_pawns(SIDE) & ~rank7) & empty;
+	Bitboard twice = pawn_push_bb<SIDE>(single & rank3) & empty;
+	while (single) {
+		to = single.firstbit();
+		single.clearbit(to);
 
-			movelist->add(Move::normal(from, to, PAWN));
-		}
+		from = pawn_push_sq<XSIDE(SIDE)>(to);
+		movelist->add(Move::normal(from, to, PAWN));
 	}
-			
+	while (twice) {
+		to = twice.firstbit();
+		twice.clearbit(to);
+
+		from = pawn_push_sq<XSIDE(SIDE)>(pawn_push_sq<XSIDE(SIDE)>(to));
+		movelist->add(Move::normal(from, to, PAWN));
+	}
+		
 	/* knights */
-	bb = get_knights(side);
+	bb = get_knights(SIDE);
 	while (bb) {
 		from = bb.firstbit();
 		bb.clearbit(from);
 
-		to_bb = knight_attacks(from) & ~get_blocker();
+		to_bb = knight_attacks(from) & empty;
 		while (to_bb) {
 			to = to_bb.firstbit();
 			to_bb.clearbit(to);
@@ -406,12 +453,12 @@ void Board::generate_noncaptures(Movelist * movelist) const
 	}
 	
 	/* bishops */
-	bb = get_bishops(side);
+	bb = get_bishops(SIDE);
 	while (bb) {
 		from = bb.firstbit();
 		bb.clearbit(from);
 
-		to_bb = bishop_attacks(from) & ~get_blocker();
+		to_bb = bishop_attacks(from) & empty;
 		while (to_bb) {
 			to = to_bb.firstbit();
 			to_bb.clearbit(to);
@@ -421,12 +468,12 @@ void Board::generate_noncaptures(Movelist * movelist) const
 	}
 
 	/* rooks */
-	bb = get_rooks(side);
+	bb = get_rooks(SIDE);
 	while (bb) {
 		from = bb.firstbit();
 		bb.clearbit(from);
 
-		to_bb = rook_attacks(from) & ~get_blocker();
+		to_bb = rook_attacks(from) & empty;
 		while (to_bb) {
 			to = to_bb.firstbit();
 			to_bb.clearbit(to);
@@ -436,12 +483,12 @@ void Board::generate_noncaptures(Movelist * movelist) const
 	}
 
 	/* queens */
-	bb = get_queens(side);
+	bb = get_queens(SIDE);
 	while (bb) {
 		from = bb.firstbit();
 		bb.clearbit(from);
 
-		to_bb = queen_attacks(from) & ~get_blocker();
+		to_bb = queen_attacks(from) & empty;
 		while (to_bb) {
 			to = to_bb.firstbit();
 			to_bb.clearbit(to);
@@ -451,8 +498,8 @@ void Board::generate_noncaptures(Movelist * movelist) const
 	}
 
 	/* king, only one */
-	from = get_king(side);
-	to_bb = king_attacks(from) & ~get_blocker();
+	from = get_king(SIDE);
+	to_bb = king_attacks(from) & empty;
 	while (to_bb) {
 		to = to_bb.firstbit();
 		to_bb.clearbit(to);
@@ -525,26 +572,38 @@ void Board::generate_escapes(Movelist * movelist) const
  * moves, so the king might actually be left in check!
  */
 void Board::generate_escapes(Movelist * movelist) const
+{
+	if (side == WHITE) {
+		generate_escapes<WHITE>(movelist);
+	} else {
+		generate_escapes<BLACK>(movelist);
+	}
+}
+
+template <Color SIDE>
+void Board::generate_escapes(Movelist * movelist) const
 {
 	ASSERT_DEBUG(in_check());
+
+	const Color xside = XSIDE(SIDE);
 	
 	Bitboard from_bb, to_bb;
 	Square from, to;
 
-	Square king = get_king(side);
-	Bitboard checkers = attackers(king, XSIDE(side));
+	Square king = get_king(SIDE);
+	Bitboard checkers = attackers(king, xside);
 	
 	/*
 	 * Try to move the king.
 	 */
-	to_bb = king_attacks(king) & ~get_pieces(side);
+	to_bb = king_attacks(king) & ~get_pieces(SIDE);
 	while (to_bb) {
 		to = to_bb.firstbit();
 		to_bb.clearbit(to);
 
-		if (is_attacked(to, XSIDE(side))) {
+		if (is_attacked(to, xside)) {
 			continue;
-		} else if (get_pieces(XSIDE(side)).testbit(to)) {
+		} else if (get_pieces(xside).testbit(to)) {
 			movelist->add(Move::capture(king, to, KING,
 						piece_at(to)));
 		} else {
@@ -567,7 +626,7 @@ void Board::generate_escapes(Movelist * movelist) const
 	 * Captures taken by the king were
 	 * already considered above.
 	 */
-	from_bb = attackers(checker, side) & ~get_kings(side);
+	from_bb = attackers(checker, SIDE) & ~get_kings(SIDE);
 	while (from_bb) {
 		from = from_bb.firstbit();
 		from_bb.clearbit(from);
@@ -577,7 +636,7 @@ void Board::generate_escapes(Movelist * movelist) const
 
 	/* Also try enpassant capture. */
 	if (checker == get_eppawn()) {
-		from_bb = pawn_captures(epsq, XSIDE(side)) & get_pawns(side);
+		from_bb = pawn_captures(epsq, xside) & get_pawns(SIDE);
 		while (from_bb) {
 			from = from_bb.firstbit();
 			from_bb.clearbit(from);
@@ -599,28 +658,28 @@ void Board::generate_escapes(Movelist * movelist) const
 
 		ASSERT_DEBUG(piece_at(to) == NO_PIECE);
 
-		from_bb = attackers(to, side)
-			& ~get_pawns(side)  // would be captures, not blocks
-			& ~get_kings(side); // already considered above
+		from_bb = attackers(to, SIDE)
+			& ~get_pawns(SIDE)  // would be captures, not blocks
+			& ~get_kings(SIDE); // already considered above
 
 		/* Hmm, pawn forward moves must
 		 * be added separately. */
-		if (side == WHITE) {
+		if (SIDE == WHITE) {
 			if (RNK(to) != RANK1
-					&& get_pawns(side).testbit(to-8)) {
+					&& get_pawns(SIDE).testbit(to-8)) {
 				from_bb.setbit(to-8);
 			} else if (RNK(to) == RANK4
 					&& !get_blocker().testbit(to-8)
-					&& get_pawns(side).testbit(to-16)) {
+					&& get_pawns(SIDE).testbit(to-16)) {
 				from_bb.setbit(to-16);
 			}
 		} else {
 			if (RNK(to) != RANK8
-					&& get_pawns(side).testbit(to+8)) {
+					&& get_pawns(SIDE).testbit(to+8)) {
 				from_bb.setbit(to+8);
 			} else if (RNK(to) == RANK5
 					&& !get_blocker().testbit(to+8)
-					&& get_pawns(side).testbit(to+16)) {
+					&& get_pawns(SIDE).testbit(to+16)) {
 				from_bb.setbit(to+16);
 			}
 		}
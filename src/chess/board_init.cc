@@ -23,6 +23,8 @@
 
 
 Hashkey Board::hashkeys[2][6][64];
+int Board::psq_table_mg[2][6][64];
+int Board::psq_table_eg[2][6][64];
 Hashkey Board::hash_side;
 Hashkey Board::hash_ep[64];
 Hashkey Board::hash_wk;
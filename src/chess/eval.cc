@@ -22,6 +22,44 @@
 #include "bitboard.h"
 #include "board.h"
 
+
+/*
+ * Tunable parameters. The scalar ones are defined in eval_param_defs.h,
+ * the EVAL_* macros of the scoring plugins refer to them. All of them,
+ * including the tables, are listed in params[] so that they can be
+ * changed at runtime by "evalparams load" and by the tuner.
+ */
+
+#define EVAL_DEFINE_PARAM(name, value) static int param_##name = value;
+#include "eval_param_defs.h"
+#undef EVAL_DEFINE_PARAM
+
+/* passed pawn bonus, indexed by distance to promotion rank */
+static int param_passedpawn[7] = {
+	0,
+	SCORE(105, 105),
+	SCORE( 65,  65),
+	SCORE( 51,  51),
+	SCORE( 45,  45),
+	SCORE( 41,  41),
+	SCORE( 38,  38)
+};
+
+const struct eval_param Evaluator::params[] = {
+#define EVAL_DEFINE_PARAM(name, value) { #name, &param_##name, 1, true },
+#include "eval_param_defs.h"
+#undef EVAL_DEFINE_PARAM
+	{ "passedpawn",			param_passedpawn,	7,  true },
+	{ "pawn_scores_midgame",	pawn_scores_midgame,	64, false },
+	{ "pawn_scores_endgame",	pawn_scores_endgame,	64, false },
+	{ "knight_scores",		knight_scores,		64, false },
+	{ "king_scores",		king_scores,		64, false },
+	{ "king_scores_endgame",	king_scores_endgame,	64, false },
+	{ "control_score",		control_score,		64, false },
+
+	{ NULL, NULL, 0, false }
+};
+
 /*****************************************************************************
  *
  * Main evaluation functions.
@@ -87,8 +125,11 @@ int Evaluator::material_balance(int ms, int mxs)
  */
 unsigned int Evaluator::get_phase(const Board & board)
 {
-	const int mat = board.material[WHITE] + board.material[BLACK];
+	return get_phase(board.material[WHITE] + board.material[BLACK]);
+}
 
+unsigned int Evaluator::get_phase(int mat)
+{
 	/* Starting material is 7900 */
 	if (mat > 7000) {
 		return OPENING;
@@ -99,6 +140,161 @@ unsigned int Evaluator::get_phase(const Board & board)
 	}
 }
 
+/*
+ * Continuous version of get_phase(), used to interpolate between
+ * midgame and endgame scores.
+ */
+int Evaluator::get_phase_weight(const Board & board)
+{
+	return get_phase_weight(board.material[WHITE] + board.material[BLACK]);
+}
+
+int Evaluator::get_phase_weight(int mat)
+{
+	const int mat_opening = 7000;
+	const int mat_endgame = 3200;
+
+	if (mat >= mat_opening) {
+		return PHASE_WEIGHT_MAX;
+	} else if (mat <= mat_endgame) {
+		return 0;
+	} else {
+		return (mat - mat_endgame) * PHASE_WEIGHT_MAX
+			/ (mat_opening - mat_endgame);
+	}
+}
+
+/*
+ * Fill a material table entry from the material signature alone.
+ */
+void Evaluator::compute_material(Hashkey key, MaterialEntry * e)
+{
+	unsigned int count[2][6];
+	int mat[2];
+
+	for (Color c = WHITE; c <= BLACK; c++) {
+		mat[c] = 0;
+		for (Piece p = PAWN; p <= KING; p++) {
+			count[c][p] = MATERIALKEY_COUNT(key, c, p);
+			mat[c] += count[c][p] * mat_values[p];
+		}
+	}
+
+	e->imbalance = material_balance(mat[WHITE], mat[BLACK]);
+	e->phase = get_phase(mat[WHITE] + mat[BLACK]);
+	e->phase_weight = get_phase_weight(mat[WHITE] + mat[BLACK]);
+	e->endgame = NULL;
+	e->strong = NO_COLOR;
+
+	for (Color c = WHITE; c <= BLACK; c++) {
+		const Color xc = XSIDE(c);
+		const unsigned int minors = count[c][KNIGHT] + count[c][BISHOP];
+
+		e->scale[c] = MaterialEntry::SCALE_NORMAL;
+		if (count[c][PAWN] == 0
+				&& mat[c] - mat[xc] <= mat_values[BISHOP]) {
+			/* Without pawns, being ahead by no more than a
+			 * minor piece is usually not enough to win (KRKB,
+			 * KRBKR), and a lone minor piece cannot win at all
+			 * (KNK, KBKP). */
+			e->scale[c] = (mat[c] < mat_values[ROOK])
+				? 0 : MaterialEntry::SCALE_NORMAL / 4;
+		} else if (mat[xc] == 0
+				&& mat[c] == 2 * mat_values[KNIGHT]
+				&& count[c][KNIGHT] == 2) {
+			/* KNNK, mate cannot be forced */
+			e->scale[c] = 0;
+		}
+
+		/* Lone king against enough material to mate: drive it to
+		 * the edge instead of evaluating the usual features. */
+		if (mat[xc] == 0 && (count[c][QUEEN] || count[c][ROOK]
+				|| (count[c][BISHOP] && minors >= 2))) {
+			e->strong = c;
+			if (mat[c] == mat_values[KNIGHT] + mat_values[BISHOP]
+					&& count[c][KNIGHT] == 1) {
+				e->endgame = &endgame_kbnk;
+			} else {
+				e->endgame = &endgame_kxk;
+			}
+		}
+	}
+}
+
+/* Distance of a square from the four center squares, 0 to 6. */
+static inline int center_distance(Square sq)
+{
+	return MAX(RANK4 - RNK(sq), RNK(sq) - RANK5)
+		+ MAX(FILED - FIL(sq), FIL(sq) - FILEE);
+}
+
+/*
+ * KXK: Push the lone king to the edge and approach it with the
+ * own king.
+ */
+int Evaluator::endgame_kxk(const Board & board, Color strong)
+{
+	const Color weak = XSIDE(strong);
+	const Square sk = board.get_king(strong);
+	const Square wk = board.get_king(weak);
+
+	return board.material[strong]
+		+ board.psq_eg[strong] - board.psq_eg[weak]
+		+ 20 * center_distance(wk)
+		+ 10 * (14 - sq_distance(sk, wk));
+}
+
+/*
+ * KBNK: Mate is only possible in a corner of the bishop's color,
+ * so push the lone king there.
+ */
+int Evaluator::endgame_kbnk(const Board & board, Color strong)
+{
+	const Color weak = XSIDE(strong);
+	const Square sk = board.get_king(strong);
+	const Square wk = board.get_king(weak);
+
+	int corner;
+	if (board.get_bishops(strong) & DARKBITBOARD) {
+		corner = MIN(sq_distance(wk, A1), sq_distance(wk, H8));
+	} else {
+		corner = MIN(sq_distance(wk, H1), sq_distance(wk, A8));
+	}
+
+	return board.material[strong]
+		+ 20 * (14 - corner)
+		+ 10 * (14 - sq_distance(sk, wk));
+}
+
+/*
+ * Fill the piece-square tables of class Board, which are used to
+ * update Board::psq_mg and Board::psq_eg incrementally. Must be called
+ * after Board::init() and before any Board is set up.
+ */
+void Evaluator::init()
+{
+	for (Square sq = A1; sq <= H8; sq++) {
+		for (Color c = WHITE; c <= BLACK; c++) {
+			const Square idx = (c == WHITE) ? sq
+				: SQUARE(XRNK(RNK(sq)),FIL(sq));
+			for (Piece p = PAWN; p <= KING; p++) {
+				Board::psq_table_mg[c][p][sq] = 0;
+				Board::psq_table_eg[c][p][sq] = 0;
+			}
+
+			Board::psq_table_mg[c][PAWN][sq] =
+				pawn_scores_midgame[idx];
+			Board::psq_table_eg[c][PAWN][sq] =
+				pawn_scores_endgame[idx];
+			Board::psq_table_mg[c][KNIGHT][sq] = knight_scores[idx];
+			Board::psq_table_eg[c][KNIGHT][sq] = knight_scores[idx];
+			Board::psq_table_mg[c][KING][sq] = king_scores[idx];
+			Board::psq_table_eg[c][KING][sq] =
+				king_scores_endgame[idx];
+		}
+	}
+}
+
 void Evaluator::setup(const Board * board)
 {
 	ASSERT_DEBUG(board != NULL);
@@ -107,25 +303,104 @@ void Evaluator::setup(const Board * board)
 //	const Color side = board->get_side();
 //	const Color xside = XSIDE(side);
 
-	phase = get_phase(*board);
-
 	if (pawnhashtable) {
+		/* probe() marks entry invalid if nothing was found in
+		 * the table, so we don't need to do this here again.
+		 * Pawn scores are midgame/endgame pairs, so an entry can
+		 * be used regardless of the phase it was stored in. */
+		stat_pawnhash_probes++;
 		if (pawnhashtable->probe(board->get_pawnhashkey(),
-					&pawnhashentry)){
-			if (pawnhashentry.get_phase() == phase) {
-				pawnhashtable->incr_hits2();
-			}
+					&pawnhashentry)) {
+			stat_pawnhash_hits++;
 		}
-		/* probe() marks entry invalid if nothing was found in
-		 * the table, so we don't need to do this here again. */
 	} else {
 		pawnhashentry.set_invalid();
 	}
+
+	setup_attacks<WHITE>();
+	setup_attacks<BLACK>();
 	
 //	pinned_on_king[side] = board->pinned(board->get_king(side), side);
 //	pinned_on_king[xside] = board->pinned(board->get_king(xside), xside);
 }
 
+/*
+ * Compute the attack maps of one side. For each square, the number of
+ * attackers is kept in four bitboards, one per bit (saturating at 15).
+ */
+template <Color side>
+void Evaluator::setup_attacks()
+{
+	Bitboard cnt0 = NULLBITBOARD;
+	Bitboard cnt1 = NULLBITBOARD;
+	Bitboard cnt2 = NULLBITBOARD;
+	Bitboard cnt3 = NULLBITBOARD;
+
+	for (Piece ptype = PAWN; ptype <= KING; ptype++) {
+		Bitboard all = NULLBITBOARD;
+		Bitboard pieces = board->position[side][ptype];
+		while (pieces) {
+			Square sq = pieces.firstbit();
+			pieces.clearbit(sq);
+
+			Bitboard atk;
+			switch (ptype) {
+			case PAWN:
+				/* not pawn_captures(), which only returns
+				 * occupied squares */
+				atk = Bitboard::pawn_capt_bb[side][sq];
+				break;
+			case KNIGHT:
+				atk = board->knight_attacks(sq);
+				break;
+			case BISHOP:
+				atk = board->bishop_attacks(sq);
+				break;
+			case ROOK:
+				atk = board->rook_attacks(sq);
+				break;
+			case QUEEN:
+				atk = board->queen_attacks(sq);
+				break;
+			default:
+				atk = board->king_attacks(sq);
+				break;
+			}
+			attacks_from[sq] = atk;
+			all |= atk;
+
+			/* add to bit-sliced counter */
+			Bitboard carry = cnt0 & atk;
+			cnt0 = cnt0 ^ atk;
+			Bitboard carry2 = cnt1 & carry;
+			cnt1 = cnt1 ^ carry;
+			Bitboard carry3 = cnt2 & carry2;
+			cnt2 = cnt2 ^ carry2;
+			cnt3 |= carry3;
+		}
+		attacked_by[side][ptype] = all;
+	}
+
+	attack_count[side][0] = cnt0;
+	attack_count[side][1] = cnt1;
+	attack_count[side][2] = cnt2;
+	attack_count[side][3] = cnt3;
+	attacked[side] = cnt0 | cnt1 | cnt2 | cnt3;
+	attacked2[side] = cnt1 | cnt2 | cnt3;
+}
+
+/*
+ * Number of pieces of side attacking sq, same as
+ * board->attackers(sq, side).popcnt().
+ */
+unsigned int Evaluator::get_attack_count(Color side, Square sq) const
+{
+	return attack_count[side][0].testbit(sq)
+		| (attack_count[side][1].testbit(sq) << 1)
+		| (attack_count[side][2].testbit(sq) << 2)
+		| (attack_count[side][3].testbit(sq) << 3);
+}
+
 void Evaluator::finish()
 {
 	if (pawnhashtable) {
@@ -143,37 +418,31 @@ void Evaluator::finish()
  *****************************************************************************/
 
 const struct score_plugin Evaluator::plugins[] = {
-	{ "pawns",	&Evaluator::score_pawns		},
-	{ "knights",	&Evaluator::score_knights	},
-	{ "bishops",	&Evaluator::score_bishops	},
-	{ "rooks",	&Evaluator::score_rooks		},
-	{ "queens",	&Evaluator::score_queens	},
-	{ "king",	&Evaluator::score_king		},
-	{ "devel",	&Evaluator::score_devel		},
-	{ "combo",	&Evaluator::score_combo		},
-
-	{ NULL, NULL }
+	SCORE_PLUGIN("pawns",	score_pawns),
+	SCORE_PLUGIN("knights",	score_knights),
+	SCORE_PLUGIN("bishops",	score_bishops),
+	SCORE_PLUGIN("rooks",	score_rooks),
+	SCORE_PLUGIN("queens",	score_queens),
+	SCORE_PLUGIN("king",	score_king),
+	SCORE_PLUGIN("devel",	score_devel),
+	SCORE_PLUGIN("combo",	score_combo),
+
+	{ NULL, { NULL, NULL } }
 };
 
 const struct score_plugin Evaluator::plugins2[] = {
-	{ "control",	&Evaluator::score_control	},
+	SCORE_PLUGIN("control",	score_control),
 
-	{ NULL, NULL }
+	{ NULL, { NULL, NULL } }
 };
 
 
-const int Evaluator::pawn_scores_opening[] = {
-	  0,  0,  0,  0,  0,  0,  0,  0,
-	  8,  5,  8,-10,-15,  8,  5,  8,
-	 -5,  5,  0, -8, -8,  0,  5, -5,
-	 -5, -5, -5, 24, 32, -5, -5, -5,
-	  0,  0,  0, 12, 12,  0,  0,  0,
-	  0,  0,  8,  8,  8,  8,  0,  0,
-	  0,  8,  8,  8,  8,  8,  8,  0,
-	  0,  0,  0,  0,  0,  0,  0,  0
-};
+/*
+ * Piece-square tables. These are not used by the scoring plugins,
+ * but summed up incrementally by class Board, see init().
+ */
 
-const int Evaluator::pawn_scores_midgame[] = {
+int Evaluator::pawn_scores_midgame[] = {
 	  0,  0,  0,  0,  0,  0,  0,  0,
 	  5,  5,  4,-25,-25,  4,  5,  5,
 	  0,  0,  0,-10,-10,  0,  0,  0,
@@ -184,7 +453,7 @@ const int Evaluator::pawn_scores_midgame[] = {
 	  0,  0,  0,  0,  0,  0,  0,  0
 };
 
-const int Evaluator::pawn_scores_endgame[] = {
+int Evaluator::pawn_scores_endgame[] = {
 	  0,  0,  0,  0,  0,  0,  0,  0,
 	  0,  0,  0,  0,  0,  0,  0,  0,
 	  2,  2,  2,  2,  2,  2,  2,  2,
@@ -195,7 +464,7 @@ const int Evaluator::pawn_scores_endgame[] = {
 	  0,  0,  0,  0,  0,  0,  0,  0
 };
 
-const int Evaluator::knight_scores[] = {
+int Evaluator::knight_scores[] = {
 	-15, -5, -5, -5, -5, -5, -5,-15,
 	 -5,  0,  0,  0,  0,  0,  0, -5,
 	 -5,  0,  5,  5,  5,  5,  0, -5,
@@ -206,7 +475,7 @@ const int Evaluator::knight_scores[] = {
 	-15, -5, -5, -5, -5, -5, -5,-15
 };
 
-const int Evaluator::king_scores[] = {
+int Evaluator::king_scores[] = {
 	 12, 12, 10,  0,  0, 10, 16, 16,
 	  0,-70,-70,-70,-70,-70,-70,  0,
 	  0,-70,-75,-75,-75,-75,-70,  0,
@@ -217,7 +486,7 @@ const int Evaluator::king_scores[] = {
 	 12, 12, 10,  0,  0, 10, 16, 16
 };
 
-const int Evaluator::king_scores_endgame[] = {
+int Evaluator::king_scores_endgame[] = {
 	  0,  0,  0,  0,  0,  0,  0,  0,
 	  0,  5,  5,  5,  5,  5,  5,  0,
 	  0,  5, 15, 15, 15, 15,  5,  0,
@@ -233,21 +502,22 @@ const int Evaluator::king_scores_endgame[] = {
  * Pawn evaluation.
  */
 
-#define EVAL_DOUBLEPAWNS	-5	/* TODO perhaps -50 ? */
-//#define EVAL_EIGHTPAWNS		-10
-//#define EVAL_PAWNRAMS		-10
-#define EVAL_ISOLATEDPAWN	-10
-#define EVAL_PASSEDPAWN(dist)	(25 + 80/(dist))
-#define EVAL_CONNECTEDPP	20
+#define EVAL_DOUBLEPAWNS	param_doublepawns
+//#define EVAL_EIGHTPAWNS		SCORE(-10, -10)
+//#define EVAL_PAWNRAMS		SCORE(-10, -10)
+#define EVAL_ISOLATEDPAWN	param_isolatedpawn
+#define EVAL_PASSEDPAWN(dist)	param_passedpawn[dist]
+#define EVAL_CONNECTEDPP	param_connectedpp
 
-int Evaluator::score_pawns(Color side)
+template <Color side>
+int Evaluator::score_pawns()
 {
 	int score = 0;
 
 	/* 
 	 * First look if pawn hash table probe was successful.
 	 */
-	if (pawnhashentry.is_valid() && pawnhashentry.get_phase() == phase) {
+	if (pawnhashentry.is_valid()) {
 		passed_pawns[side] = pawnhashentry.get_passed(side);
 		return pawnhashentry.get_score(side);
 	} else {
@@ -282,17 +552,6 @@ int Evaluator::score_pawns(Color side)
 		sq = pawns.firstbit();
 		pawns.clearbit(sq);
 
-		/* Positional score */
-		const Square idx = (side == WHITE) ? sq
-			: SQUARE(XRNK(RNK(sq)),FIL(sq));
-		if (phase == ENDGAME) {
-			score += pawn_scores_endgame[idx];
-		} else if (phase == MIDGAME) {
-			score += pawn_scores_midgame[idx];
-		} else {
-			score += pawn_scores_opening[idx];
-		}
-
 #ifdef EVAL_PAWNRAMS
 		/* Pawn rams */
 		if (side == myside) {
@@ -348,10 +607,11 @@ int Evaluator::score_pawns(Color side)
  * Knight evaluation.
  */
 
-#define EVAL_KNIGHTMOBILITY	2
-//#define EVAL_PINNEDKNIGHT	-30
+#define EVAL_KNIGHTMOBILITY	param_knightmobility
+//#define EVAL_PINNEDKNIGHT	SCORE(-30, -30)
 
-int Evaluator::score_knights(Color side)
+template <Color side>
+int Evaluator::score_knights()
 {
 	int score = 0;
 
@@ -361,13 +621,9 @@ int Evaluator::score_knights(Color side)
 		sq = knights.firstbit();
 		knights.clearbit(sq);
 
-		/* Positional score */
-		score += knight_scores[sq];
-
 #ifdef EVAL_KNIGHTMOBILITY
 		/* Simple mobility bonus */
-		Bitboard ka = board->knight_attacks(sq)
-				& ~board->get_pieces(side);
+		Bitboard ka = attacks_from[sq] & ~board->get_pieces(side);
 		score += ka.popcnt() * EVAL_KNIGHTMOBILITY;
 #endif
 
@@ -387,12 +643,13 @@ int Evaluator::score_knights(Color side)
  * Bishop evaluation.
  */
 
-#define EVAL_BISHOPMOBILITY	2
-//#define EVAL_PINNEDBISHOP	-30
-#define EVAL_BISHOPPAWN		25
-#define EVAL_FIANCHETTOBISHOP	15
+#define EVAL_BISHOPMOBILITY	param_bishopmobility
+//#define EVAL_PINNEDBISHOP	SCORE(-30, -30)
+#define EVAL_BISHOPPAWN		param_bishoppawn
+#define EVAL_FIANCHETTOBISHOP	param_fianchettobishop
 
-int Evaluator::score_bishops(Color side)
+template <Color side>
+int Evaluator::score_bishops()
 {
 	int score = 0;
 
@@ -404,8 +661,7 @@ int Evaluator::score_bishops(Color side)
 
 #ifdef EVAL_BISHOPMOBILITY
 		/* Simple mobility bonus */
-		Bitboard ba = board->bishop_attacks(sq)
-				& ~board->get_pieces(side);
+		Bitboard ba = attacks_from[sq] & ~board->get_pieces(side);
 		score += ba.popcnt() * EVAL_BISHOPMOBILITY;
 #endif
 		
@@ -440,17 +696,18 @@ int Evaluator::score_bishops(Color side)
  * Rook evaluation.
  */
 
-#define EVAL_ROOKMOBILITY	2
-#define EVAL_EARLYROOKADVANCE	-10
-#define EVAL_ROOKOPENFILE	10
-#define EVAL_ROOKHALFOPENFILE	5
-#define EVAL_ROOK7PAWNS7	20	// FIXME too high?
-#define EVAL_ROOK7KING8		50	// FIXME too high?
-#define EVAL_ROOKINFRONTPP	-15
-#define EVAL_ROOKBEHINDPP	25
-//#define EVAL_PINNEDROOK		-50
-
-int Evaluator::score_rooks(Color side)
+#define EVAL_ROOKMOBILITY	param_rookmobility
+#define EVAL_EARLYROOKADVANCE	param_earlyrookadvance
+#define EVAL_ROOKOPENFILE	param_rookopenfile
+#define EVAL_ROOKHALFOPENFILE	param_rookhalfopenfile
+#define EVAL_ROOK7PAWNS7	param_rook7pawns7
+#define EVAL_ROOK7KING8		param_rook7king8
+#define EVAL_ROOKINFRONTPP	param_rookinfrontpp
+#define EVAL_ROOKBEHINDPP	param_rookbehindpp
+//#define EVAL_PINNEDROOK		SCORE(-50, -50)
+
+template <Color side>
+int Evaluator::score_rooks()
 {
 	int score = 0;
 
@@ -467,17 +724,14 @@ int Evaluator::score_rooks(Color side)
 
 #ifdef EVAL_ROOKMOBILITY
 		/* Simple mobility bonus */
-		Bitboard ra = board->rook_attacks(sq)
-				& ~board->get_pieces(side);
+		Bitboard ra = attacks_from[sq] & ~board->get_pieces(side);
 		score += ra.popcnt() * EVAL_ROOKMOBILITY;
 #endif
 
 #ifdef EVAL_EARLYROOKADVANCE
 		/* Keep rooks on back rank until endgame */
-		if (phase != ENDGAME) {
-			if (RNK(sq) != rank1) {
-				score += EVAL_EARLYROOKADVANCE;
-			}
+		if (RNK(sq) != rank1) {
+			score += EVAL_EARLYROOKADVANCE;
 		}
 #endif
 
@@ -495,7 +749,7 @@ int Evaluator::score_rooks(Color side)
 
 #if defined(EVAL_ROOK7PAWNS7) || defined(EVAL_ROOK7KING8)
 		/* Rook on 7th rank and ...*/
-		if (phase != ENDGAME && RNK(sq) == rank7) {
+		if (RNK(sq) == rank7) {
 #ifdef EVAL_ROOK7PAWNS7
 			/* ... enemy pawns on 7th rank */
 			if (board->get_pawns(XSIDE(side)) 
@@ -553,12 +807,13 @@ int Evaluator::score_rooks(Color side)
  * Queen evaluation.
  */
 
-//#define EVAL_QUEENNOTPRESENT	-40
-#define EVAL_QUEENMOBILITY	1
-//#define EVAL_QUEENNEARENEMYKING	5
-//#define EVAL_PINNEDQUEEN	-90
+//#define EVAL_QUEENNOTPRESENT	SCORE(-40, -40)
+#define EVAL_QUEENMOBILITY	param_queenmobility
+//#define EVAL_QUEENNEARENEMYKING	SCORE(5, 5)
+//#define EVAL_PINNEDQUEEN	SCORE(-90, -90)
 
-int Evaluator::score_queens(Color side)
+template <Color side>
+int Evaluator::score_queens()
 {
 	int score = 0;
 
@@ -578,8 +833,7 @@ int Evaluator::score_queens(Color side)
 		
 #ifdef EVAL_QUEENMOBILITY
 		/* Simple mobility bonus */
-		Bitboard qa = board->queen_attacks(sq)
-				& ~board->get_pieces(side);
+		Bitboard qa = attacks_from[sq] & ~board->get_pieces(side);
 		score += qa.popcnt() * EVAL_QUEENMOBILITY;
 #endif
 		
@@ -608,24 +862,19 @@ int Evaluator::score_queens(Color side)
  * King evaluation.
  */
 
-#define EVAL_KINGPAWNSHIELD 8
-//#define EVAL_SQAROUNDKINGATKD	-4
+#define EVAL_KINGPAWNSHIELD	param_kingpawnshield
+//#define EVAL_SQAROUNDKINGATKD	SCORE(-4, -4)
 
-int Evaluator::score_king(Color side)
+template <Color side>
+int Evaluator::score_king()
 {
 	int score = 0;
 
 	const Square kingsq = board->get_king(side);
 
-	if (phase == ENDGAME) {
-		score += king_scores_endgame[kingsq];
-	} else {
-		score += king_scores[kingsq];
-	}
-
 #ifdef EVAL_KINGPAWNSHIELD
-	/* Pawn shield */
-	if (phase != ENDGAME) {
+	/* Pawn shield, midgame only */
+	if (phase_weight > 0) {
 		static const Bitboard kingmask[2] = {
 			/* A1,B1,C1,F1,G1,H1   A8,B8,C8,F8,G8,H8 */
 			0x00000000000000e7ULL, 0xe700000000000000ULL
@@ -636,7 +885,7 @@ int Evaluator::score_king(Color side)
 		};
 
 		if (board->get_kings(side) & kingmask[side]) {
-			Bitboard pawnshield = board->king_attacks(kingsq)
+			Bitboard pawnshield = attacks_from[kingsq]
 				& pawnmask[side] & board->get_pawns(side);
 			score += pawnshield.popcnt() * EVAL_KINGPAWNSHIELD;
 		}
@@ -644,16 +893,12 @@ int Evaluator::score_king(Color side)
 #endif // EVAL_KINGPAWNSHIELD
 
 #ifdef EVAL_SQAROUNDKINGATKD
-	/* Enemy pieces attacking squares around king */
-	Bitboard attackers = NULLBITBOARD;
-	Bitboard bb = Bitboard::attack_bb[KING][kingsq];
-	while (bb) {
-		Square sq = bb.firstbit();
-		bb.clearbit(sq);
-
-		attackers |= board->attackers(sq, XSIDE(side));
-	}
-	score += attackers.popcnt() * EVAL_SQAROUNDKINGATKD;
+	/* Squares around king attacked by enemy pieces, squares
+	 * attacked twice count double */
+	Bitboard kingzone = attacks_from[kingsq];
+	score += ((kingzone & attacked[XSIDE(side)]).popcnt()
+			+ (kingzone & attacked2[XSIDE(side)]).popcnt())
+		* EVAL_SQAROUNDKINGATKD;
 #endif // EVAL_SQAROUNDKINGATKD
 
 	return score;
@@ -661,21 +906,23 @@ int Evaluator::score_king(Color side)
 
 
 /*
- * Evaluation of development (in opening phase).
+ * Evaluation of development. All terms are midgame-only and fade out
+ * with the phase weight.
  */
 
-#define EVAL_MINORNOTDEV	-15
-#define EVAL_EARLYROOKMOVE	-20
-#define EVAL_EARLYQUEENMOVE	-25
+#define EVAL_MINORNOTDEV	param_minornotdev
+#define EVAL_EARLYROOKMOVE	param_earlyrookmove
+#define EVAL_EARLYQUEENMOVE	param_earlyqueenmove
 
-#define EVAL_CASTLED		32
-#define EVAL_CANCASTLE		16
+#define EVAL_CASTLED		param_castled
+#define EVAL_CANCASTLE		param_cancastle
 
-int Evaluator::score_devel(Color side)
+template <Color side>
+int Evaluator::score_devel()
 {
 	int score = 0;
 
-	if (phase != OPENING)
+	if (phase_weight == 0)
 		return score;
 	
 #ifdef EVAL_MINORNOTDEV
@@ -735,10 +982,11 @@ int Evaluator::score_devel(Color side)
  * Evaluation of mixed-piece combinations.
  */
 
-#define EVAL_QBCOMBO		15
-#define EVAL_QRCOMBO		30
+#define EVAL_QBCOMBO		param_qbcombo
+#define EVAL_QRCOMBO		param_qrcombo
 
-int Evaluator::score_combo(Color side)
+template <Color side>
+int Evaluator::score_combo()
 {
 	int score = 0;
 
@@ -785,7 +1033,7 @@ int Evaluator::score_combo(Color side)
  * Control over board.
  */
 
-const int Evaluator::control_score[] = {
+int Evaluator::control_score[] = {
 	  1,  1,  1,  1,  1,  1,  1,  1,
 	  1,  2,  2,  2,  2,  2,  2,  1,
 	  1,  2,  3,  3,  3,  3,  2,  1,
@@ -807,17 +1055,21 @@ const unsigned int Evaluator::control_maxattackers[] = {
 	  5,  5,  5,  5,  5,  5,  5,  5
 };
 
-int Evaluator::score_control(Color side)
+template <Color side>
+int Evaluator::score_control()
 {
 	int score = 0;
 
-	for (Square sq = A1; sq <= H8; sq++) {
-		Bitboard attackers = board->attackers(sq, side);
-		unsigned int nr_attackers = attackers.popcnt();
+	Bitboard bb = attacked[side];
+	while (bb) {
+		Square sq = bb.firstbit();
+		bb.clearbit(sq);
+
+		unsigned int nr_attackers = get_attack_count(side, sq);
 		
 		score += control_score[sq]
 			* MIN(nr_attackers, control_maxattackers[sq]);
 	}
 
-	return score;
+	return SCORE(score, score);
 }
@@ -22,6 +22,7 @@
 #include "common.h"
 #include "board.h"
 #include "evalcache.h"
+#include "materialtable.h"
 #include "pawnhash.h"
 
 
@@ -30,6 +31,13 @@
 #define MATE		 90000
 #define DRAW		     0
 
+/* The scoring plugins return pairs of a midgame and an endgame score,
+ * packed into one int so that they can be added and multiplied like
+ * plain scores. Evaluator::taper() interpolates them by phase weight. */
+#define SCORE(mg, eg)	((eg) * 65536 + (mg))
+#define SCORE_MG(s)	((int) (int16_t) ((s) & 0xffff))
+#define SCORE_EG(s)	(((s) - SCORE_MG(s)) / 65536)
+
 
 class Evaluator
 {
@@ -40,6 +48,16 @@ class Evaluator
 		ENDGAME
 	};
 
+	/* get_phase_weight() returns values from 0 (endgame)
+	 * to PHASE_WEIGHT_MAX (opening) */
+	enum { PHASE_WEIGHT_MAX = 256 };
+
+	/* number of entries of the material table */
+	enum { MATERIALTABLE_SIZE = 1024 };
+
+	/* size of the profiling arrays, see set_profile() */
+	enum { MAX_PLUGINS = 16 };
+
       private:
 	static const struct score_plugin plugins[];
 	static const struct score_plugin plugins2[];
@@ -47,18 +65,47 @@ class Evaluator
       private:
 	PawnHashTable * pawnhashtable;
 	EvaluationCache * evalcache;
+	MaterialTable * materialtable;
+	bool shared_pawnhashtable;
+	bool shared_evalcache;
 
 	unsigned long stat_evals;
 	unsigned long stat_evals_phase1;
 	unsigned long stat_evals_phase2;
+	unsigned long stat_pawnhash_probes;
+	unsigned long stat_pawnhash_hits;
+	unsigned long stat_evalcache_probes;
+	unsigned long stat_evalcache_hits;
+	unsigned long stat_material_probes;
+	unsigned long stat_material_hits;
+	unsigned long stat_endgame_evals;
+	unsigned long stat_lazy_cutoffs;
+	unsigned long stat_phase1_cutoffs;
+
+	/* profiling, [0] is phase 1 and [1] is phase 2 */
+	bool profile;
+	unsigned long long prof_ticks_setup;
+	unsigned long long prof_ticks_phase[2];
+	unsigned long prof_calls[2][MAX_PLUGINS];
+	unsigned long long prof_ticks[2][MAX_PLUGINS];
 
       private:
 	const Board * board;
+	const MaterialEntry * material;
 	unsigned int phase;
+	int phase_weight;
 	Color myside;
 	PawnHashEntry pawnhashentry;
 	Bitboard passed_pawns[2];
 	//Bitboard pinned_on_king[2];
+
+	/* Attack maps, computed once by setup() and shared by all
+	 * scoring plugins. */
+	Bitboard attacks_from[64];	// attacks of the piece on a square
+	Bitboard attacked_by[2][6];	// squares attacked by piece type
+	Bitboard attacked[2];		// squares attacked by any piece
+	Bitboard attacked2[2];		// squares attacked at least twice
+	Bitboard attack_count[2][4];	// bit-sliced number of attackers
 	
       public:
 	Evaluator();
@@ -71,45 +118,90 @@ class Evaluator
       public:
 	void reset_statistics();
 	void print_statistics(FILE * fp = stdout) const;
+	void set_profile(bool enable);
+	void print_profile(FILE * fp = stdout) const;
 	void set_pawnhash_size(size_t bytes);
+	void set_pawnhash_table(PawnHashTable * table);
 	void clear_pawnhash();
 	void set_evalcache_size(size_t bytes);
+	void set_evalcache_table(EvaluationCache * cache);
 	void clear_evalcache();
+	void get_cache_statistics(unsigned long * pawnhash_probes,
+			unsigned long * pawnhash_hits,
+			unsigned long * evalcache_probes,
+			unsigned long * evalcache_hits) const;
 	
       private:
+	void probe_material(const Board & board);
 	void setup(const Board * board);
+	template <Color side> void setup_attacks();
+	unsigned int get_attack_count(Color side, Square sq) const;
 	void finish();
+	int taper(int score) const;
+	int call_plugins(const struct score_plugin * plugins,
+			unsigned int stage, Color side);
 	
       public:
+	static void init();
 	static bool is_draw(const Board & board);
 	static int material_balance(int mat_side, int mat_xside);
 	static unsigned int get_phase(const Board & board);
+	static unsigned int get_phase(int mat);
+	static int get_phase_weight(const Board & board);
+	static int get_phase_weight(int mat);
+	static int psq_score(const Board & board, Color side);
+
+      public:
+	static const struct eval_param params[];
+	static const struct eval_param * find_param(const char * name);
+	static void print_params(FILE * fp = stdout);
+	static bool load_params(const char * filename);
+	static bool save_params(const char * filename);
+	static void params_changed();
 
       private:
-	static const int pawn_scores_opening[64];
-	static const int pawn_scores_midgame[64];
-	static const int pawn_scores_endgame[64];
-	static const int knight_scores[64];
-	static const int king_scores[64];
-	static const int king_scores_endgame[64];
-	static const int control_score[64];
+	static int pawn_scores_midgame[64];
+	static int pawn_scores_endgame[64];
+	static int knight_scores[64];
+	static int king_scores[64];
+	static int king_scores_endgame[64];
+	static int control_score[64];
 	static const unsigned int control_maxattackers[64];
 
       private:
-	int score_pawns(Color side);
-	int score_knights(Color side);
-	int score_bishops(Color side);
-	int score_rooks(Color side);
-	int score_queens(Color side);
-	int score_king(Color side);
-	int score_devel(Color side);
-	int score_combo(Color side);
-	int score_control(Color side);
+	template <Color side> int score_pawns();
+	template <Color side> int score_knights();
+	template <Color side> int score_bishops();
+	template <Color side> int score_rooks();
+	template <Color side> int score_queens();
+	template <Color side> int score_king();
+	template <Color side> int score_devel();
+	template <Color side> int score_combo();
+	template <Color side> int score_control();
+
+      private:
+	static void compute_material(Hashkey key, MaterialEntry * entry);
+	static int endgame_kxk(const Board & board, Color strong);
+	static int endgame_kbnk(const Board & board, Color strong);
 };
 
+/* Plugins are specialized for the side they score, see
+ * Evaluator::call_plugins(). */
 struct score_plugin {
 	const char * name;
-	int (Evaluator::* func)(Color);
+	int (Evaluator::* func[2])();
+};
+
+#define SCORE_PLUGIN(name, f) \
+	{ name, { &Evaluator::f<WHITE>, &Evaluator::f<BLACK> } }
+
+/* A tunable parameter, one value or a table of values, see
+ * Evaluator::params[]. Packed values are SCORE() pairs. */
+struct eval_param {
+	const char * name;
+	int * values;
+	unsigned int count;
+	bool packed;
 };
 
 #endif // EVAL_H
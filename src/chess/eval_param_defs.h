@@ -0,0 +1,33 @@
+/* Tunable scalar evaluation parameters, see Evaluator::params[].
+ * All values are midgame/endgame pairs. */
+EVAL_DEFINE_PARAM(doublepawns,		SCORE(-5, -5))	/* TODO perhaps -50 ? */
+EVAL_DEFINE_PARAM(isolatedpawn,		SCORE(-10, -10))
+EVAL_DEFINE_PARAM(connectedpp,		SCORE(20, 20))
+
+EVAL_DEFINE_PARAM(knightmobility,	SCORE(2, 2))
+
+EVAL_DEFINE_PARAM(bishopmobility,	SCORE(2, 2))
+EVAL_DEFINE_PARAM(bishoppawn,		SCORE(25, 25))
+EVAL_DEFINE_PARAM(fianchettobishop,	SCORE(15, 15))
+
+EVAL_DEFINE_PARAM(rookmobility,		SCORE(2, 2))
+EVAL_DEFINE_PARAM(earlyrookadvance,	SCORE(-10, 0))
+EVAL_DEFINE_PARAM(rookopenfile,		SCORE(10, 10))
+EVAL_DEFINE_PARAM(rookhalfopenfile,	SCORE(5, 5))
+EVAL_DEFINE_PARAM(rook7pawns7,		SCORE(20, 0))	// FIXME too high?
+EVAL_DEFINE_PARAM(rook7king8,		SCORE(50, 0))	// FIXME too high?
+EVAL_DEFINE_PARAM(rookinfrontpp,	SCORE(-15, -15))
+EVAL_DEFINE_PARAM(rookbehindpp,		SCORE(25, 25))
+
+EVAL_DEFINE_PARAM(queenmobility,	SCORE(1, 1))
+
+EVAL_DEFINE_PARAM(kingpawnshield,	SCORE(8, 0))
+
+EVAL_DEFINE_PARAM(minornotdev,		SCORE(-15, 0))
+EVAL_DEFINE_PARAM(earlyrookmove,	SCORE(-20, 0))
+EVAL_DEFINE_PARAM(earlyqueenmove,	SCORE(-25, 0))
+EVAL_DEFINE_PARAM(castled,		SCORE(32, 0))
+EVAL_DEFINE_PARAM(cancastle,		SCORE(16, 0))
+
+EVAL_DEFINE_PARAM(qbcombo,		SCORE(15, 15))
+EVAL_DEFINE_PARAM(qrcombo,		SCORE(30, 30))
@@ -0,0 +1,516 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "nnue.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+/* The AVX2 kernels are compiled with a function level target attribute
+ * and selected at runtime, so the binary still runs on CPUs without
+ * AVX2. */
+#if defined(__GNUC__) && !defined(__clang__) \
+	&& (defined(__x86_64__) || defined(__i386__)) \
+	&& (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+# define NNUE_HAVE_AVX2
+# include <immintrin.h>
+#endif
+
+
+NNUE * NNUE::network = NULL;
+
+
+/*****************************************************************************
+ *
+ * Kernels
+ *
+ * add/sub:	acc[i] += / -= w[i], n is a multiple of 32
+ * clip:	out[i] = min(max(in[i], 0), 127), n is a multiple of 32
+ * dot:		sum of a[i] * b[i], n is a multiple of 32
+ *
+ *****************************************************************************/
+
+struct nnue_kernel {
+	void (*add)(int16_t * acc, const int16_t * w, unsigned int n);
+	void (*sub)(int16_t * acc, const int16_t * w, unsigned int n);
+	void (*clip)(const int16_t * in, uint8_t * out, unsigned int n);
+	int32_t (*dot)(const uint8_t * a, const int8_t * b, unsigned int n);
+};
+
+static void add_scalar(int16_t * acc, const int16_t * w, unsigned int n)
+{
+	for (unsigned int i=0; i<n; i++) {
+		acc[i] += w[i];
+	}
+}
+
+static void sub_scalar(int16_t * acc, const int16_t * w, unsigned int n)
+{
+	for (unsigned int i=0; i<n; i++) {
+		acc[i] -= w[i];
+	}
+}
+
+static void clip_scalar(const int16_t * in, uint8_t * out, unsigned int n)
+{
+	for (unsigned int i=0; i<n; i++) {
+		out[i] = (in[i] < 0) ? 0 : (in[i] > 127) ? 127 : in[i];
+	}
+}
+
+static int32_t dot_scalar(const uint8_t * a, const int8_t * b, unsigned int n)
+{
+	int32_t sum = 0;
+	for (unsigned int i=0; i<n; i++) {
+		sum += a[i] * b[i];
+	}
+	return sum;
+}
+
+#ifdef __SSE2__
+static void add_sse2(int16_t * acc, const int16_t * w, unsigned int n)
+{
+	for (unsigned int i=0; i<n; i+=8) {
+		__m128i * p = (__m128i *) (acc + i);
+		__m128i x = _mm_loadu_si128((const __m128i *) (w + i));
+		x = _mm_add_epi16(_mm_loadu_si128(p), x);
+		_mm_storeu_si128(p, x);
+	}
+}
+
+static void sub_sse2(int16_t * acc, const int16_t * w, unsigned int n)
+{
+	for (unsigned int i=0; i<n; i+=8) {
+		__m128i * p = (__m128i *) (acc + i);
+		__m128i x = _mm_loadu_si128((const __m128i *) (w + i));
+		x = _mm_sub_epi16(_mm_loadu_si128(p), x);
+		_mm_storeu_si128(p, x);
+	}
+}
+
+static void clip_sse2(const int16_t * in, uint8_t * out, unsigned int n)
+{
+	const __m128i max = _mm_set1_epi8(127);
+	for (unsigned int i=0; i<n; i+=16) {
+		__m128i a = _mm_loadu_si128((const __m128i *) (in + i));
+		__m128i b = _mm_loadu_si128((const __m128i *) (in + i + 8));
+		__m128i x = _mm_min_epu8(_mm_packus_epi16(a, b), max);
+		_mm_storeu_si128((__m128i *) (out + i), x);
+	}
+}
+
+static int32_t dot_sse2(const uint8_t * a, const int8_t * b, unsigned int n)
+{
+	/* SSE2 has no u8 x i8 multiply, so widen both to 16 bit */
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = zero;
+	for (unsigned int i=0; i<n; i+=16) {
+		__m128i x = _mm_loadu_si128((const __m128i *) (a + i));
+		__m128i y = _mm_loadu_si128((const __m128i *) (b + i));
+		__m128i ysign = _mm_cmpgt_epi8(zero, y);
+		__m128i xlo = _mm_unpacklo_epi8(x, zero);
+		__m128i xhi = _mm_unpackhi_epi8(x, zero);
+		__m128i ylo = _mm_unpacklo_epi8(y, ysign);
+		__m128i yhi = _mm_unpackhi_epi8(y, ysign);
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(xlo, ylo));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(xhi, yhi));
+	}
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+	return _mm_cvtsi128_si32(sum);
+}
+#endif // __SSE2__
+
+#ifdef NNUE_HAVE_AVX2
+__attribute__((target("avx2")))
+static void add_avx2(int16_t * acc, const int16_t * w, unsigned int n)
+{
+	for (unsigned int i=0; i<n; i+=16) {
+		__m256i * p = (__m256i *) (acc + i);
+		__m256i x = _mm256_loadu_si256((const __m256i *) (w + i));
+		x = _mm256_add_epi16(_mm256_loadu_si256(p), x);
+		_mm256_storeu_si256(p, x);
+	}
+}
+
+__attribute__((target("avx2")))
+static void sub_avx2(int16_t * acc, const int16_t * w, unsigned int n)
+{
+	for (unsigned int i=0; i<n; i+=16) {
+		__m256i * p = (__m256i *) (acc + i);
+		__m256i x = _mm256_loadu_si256((const __m256i *) (w + i));
+		x = _mm256_sub_epi16(_mm256_loadu_si256(p), x);
+		_mm256_storeu_si256(p, x);
+	}
+}
+
+__attribute__((target("avx2")))
+static void clip_avx2(const int16_t * in, uint8_t * out, unsigned int n)
+{
+	const __m256i max = _mm256_set1_epi8(127);
+	for (unsigned int i=0; i<n; i+=32) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) (in + i));
+		__m256i b = _mm256_loadu_si256((const __m256i *) (in + i + 16));
+		/* packus works per 128 bit lane, restore the order */
+		__m256i x = _mm256_permute4x64_epi64(
+				_mm256_packus_epi16(a, b), 0xd8);
+		x = _mm256_min_epu8(x, max);
+		_mm256_storeu_si256((__m256i *) (out + i), x);
+	}
+}
+
+__attribute__((target("avx2")))
+static int32_t dot_avx2(const uint8_t * a, const int8_t * b, unsigned int n)
+{
+	/* maddubs cannot saturate here, since a[i] <= 127 */
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i sum = _mm256_setzero_si256();
+	for (unsigned int i=0; i<n; i+=32) {
+		__m256i x = _mm256_loadu_si256((const __m256i *) (a + i));
+		__m256i y = _mm256_loadu_si256((const __m256i *) (b + i));
+		__m256i p = _mm256_maddubs_epi16(x, y);
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(p, ones));
+	}
+	__m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum),
+			_mm256_extracti128_si256(sum, 1));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+	return _mm_cvtsi128_si32(s);
+}
+#endif // NNUE_HAVE_AVX2
+
+static const struct nnue_kernel kernels[3] = {
+	{ add_scalar, sub_scalar, clip_scalar, dot_scalar },
+#ifdef __SSE2__
+	{ add_sse2, sub_sse2, clip_sse2, dot_sse2 },
+#else
+	{ NULL, NULL, NULL, NULL },
+#endif
+#ifdef NNUE_HAVE_AVX2
+	{ add_avx2, sub_avx2, clip_avx2, dot_avx2 },
+#else
+	{ NULL, NULL, NULL, NULL },
+#endif
+};
+
+
+/*****************************************************************************
+ *
+ * Member functions of class NNUE
+ *
+ *****************************************************************************/
+
+NNUE::NNUE()
+{
+	half = 0;
+	hidden = 0;
+	divisor = 1;
+	ft_bias = NULL;
+	ft_weights = NULL;
+	h_bias = NULL;
+	h_weights = NULL;
+	o_bias = 0;
+	o_weights = NULL;
+
+	if (kernel_supported(KERNEL_AVX2)) {
+		kernel = KERNEL_AVX2;
+	} else if (kernel_supported(KERNEL_SSE2)) {
+		kernel = KERNEL_SSE2;
+	} else {
+		kernel = KERNEL_SCALAR;
+	}
+}
+
+NNUE::~NNUE()
+{
+	delete[] ft_bias;
+	delete[] ft_weights;
+	delete[] h_bias;
+	delete[] h_weights;
+	delete[] o_weights;
+}
+
+/*
+ * Read n little endian integers of the given size (1, 2 or 4 bytes)
+ * and store them sign extended in dst.
+ */
+template <typename T>
+static bool read_le(FILE * fp, T * dst, size_t n)
+{
+	unsigned char buf[4096];
+	const size_t chunk = sizeof(buf) / sizeof(T);
+
+	while (n > 0) {
+		size_t k = (n < chunk) ? n : chunk;
+		if (fread(buf, sizeof(T), k, fp) != k) {
+			return false;
+		}
+		for (size_t i=0; i<k; i++) {
+			uint32_t x = 0;
+			for (size_t j=0; j<sizeof(T); j++) {
+				x |= (uint32_t) buf[i*sizeof(T)+j] << (8*j);
+			}
+			*dst++ = (T) x;
+		}
+		n -= k;
+	}
+
+	return true;
+}
+
+bool NNUE::load(const char * filename)
+{
+	FILE * fp = fopen(filename, "rb");
+	if (fp == NULL) {
+		printf("Cannot open %s: %s\n", filename, strerror(errno));
+		return false;
+	}
+
+	char magic[8];
+	uint32_t hdr[3];
+	if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic)
+			|| memcmp(magic, NNUE_MAGIC, sizeof(magic)) != 0
+			|| !read_le(fp, hdr, 3)) {
+		printf("%s: not a network file\n", filename);
+		fclose(fp);
+		return false;
+	}
+
+	if (hdr[0] == 0 || hdr[0] % 32 != 0 || hdr[0] > NNUE_MAX_HALF
+			|| hdr[1] == 0 || hdr[1] > NNUE_MAX_HIDDEN
+			|| hdr[2] == 0 || hdr[2] > INT_MAX) {
+		printf("%s: unsupported network size %u/%u/%u\n",
+				filename, hdr[0], hdr[1], hdr[2]);
+		fclose(fp);
+		return false;
+	}
+
+	half = hdr[0];
+	hidden = hdr[1];
+	divisor = hdr[2];
+
+	delete[] ft_bias;
+	delete[] ft_weights;
+	delete[] h_bias;
+	delete[] h_weights;
+	delete[] o_weights;
+	ft_bias = new int16_t[half];
+	ft_weights = new int16_t[(size_t) NNUE_INPUTS * half];
+	h_bias = new int32_t[hidden];
+	h_weights = new int8_t[hidden * 2 * half];
+	o_weights = new int8_t[hidden];
+
+	bool ok = read_le(fp, ft_bias, half)
+		&& read_le(fp, ft_weights, (size_t) NNUE_INPUTS * half)
+		&& read_le(fp, h_bias, hidden)
+		&& read_le(fp, h_weights, hidden * 2 * half)
+		&& read_le(fp, &o_bias, 1)
+		&& read_le(fp, o_weights, hidden);
+	if (ok && fgetc(fp) != EOF) {
+		ok = false;
+	}
+	fclose(fp);
+
+	if (!ok) {
+		printf("%s: unexpected file size\n", filename);
+		return false;
+	}
+
+	return true;
+}
+
+void NNUE::print_info() const
+{
+	size_t bytes = (size_t) NNUE_INPUTS * half * sizeof(int16_t)
+		+ half * sizeof(int16_t)
+		+ hidden * (2 * half + sizeof(int32_t) + 1)
+		+ sizeof(int32_t);
+
+	printf("HalfKP network %ux2-%u-1, divisor %d, %lu KB\n",
+			half, hidden, divisor, (unsigned long) bytes / 1024);
+	printf("Kernel: %s (available:", kernel_name(kernel));
+	for (int k=KERNEL_SCALAR; k<=KERNEL_AVX2; k++) {
+		if (kernel_supported((enum kernel_type) k)) {
+			printf(" %s", kernel_name((enum kernel_type) k));
+		}
+	}
+	printf(")\n");
+}
+
+void NNUE::refresh_side(const Board & board, Color persp,
+		NNUEAccumulator * acc) const
+{
+	const struct nnue_kernel & k = kernels[kernel];
+	int16_t * v = acc->v[persp];
+	const Square ksq = board.get_king(persp);
+
+	memcpy(v, ft_bias, half * sizeof(int16_t));
+
+	for (Color c=WHITE; c<=BLACK; c++) {
+		for (Piece p=PAWN; p<KING; p++) {
+			Bitboard bb = board.position[c][p];
+			while (bb) {
+				Square sq = bb.firstbit();
+				bb.clearbit(sq);
+				k.add(v, ft_weights
+					+ (size_t) feature(persp, ksq, c, p, sq)
+					* half, half);
+			}
+		}
+	}
+}
+
+void NNUE::refresh(const Board & board, NNUEAccumulator * acc) const
+{
+	refresh_side(board, WHITE, acc);
+	refresh_side(board, BLACK, acc);
+	acc->computed = true;
+}
+
+/*
+ * Compute the accumulator for the position after from the one for
+ * the position before by adding and removing the features of the pieces
+ * that differ. A perspective whose king has moved is refreshed.
+ */
+void NNUE::update(const Board & before, const Board & after,
+		const NNUEAccumulator & from, NNUEAccumulator * acc) const
+{
+	const struct nnue_kernel & k = kernels[kernel];
+
+	for (Color persp=WHITE; persp<=BLACK; persp++) {
+		const Square ksq = after.get_king(persp);
+		if (before.get_king(persp) != ksq) {
+			refresh_side(after, persp, acc);
+			continue;
+		}
+
+		int16_t * v = acc->v[persp];
+		memcpy(v, from.v[persp], half * sizeof(int16_t));
+
+		for (Color c=WHITE; c<=BLACK; c++) {
+			for (Piece p=PAWN; p<KING; p++) {
+				const Bitboard & b0 = before.position[c][p];
+				const Bitboard & b1 = after.position[c][p];
+				Bitboard removed = b0 & ~b1;
+				Bitboard added = b1 & ~b0;
+				while (removed) {
+					Square sq = removed.firstbit();
+					removed.clearbit(sq);
+					k.sub(v, ft_weights + (size_t) feature(
+						persp, ksq, c, p, sq) * half,
+						half);
+				}
+				while (added) {
+					Square sq = added.firstbit();
+					added.clearbit(sq);
+					k.add(v, ft_weights + (size_t) feature(
+						persp, ksq, c, p, sq) * half,
+						half);
+				}
+			}
+		}
+	}
+
+	acc->computed = true;
+}
+
+/*
+ * Evaluate the position from the side to move's point of view.
+ */
+int NNUE::evaluate(const Board & board, const NNUEAccumulator & acc) const
+{
+	ASSERT_DEBUG(acc.computed);
+
+	const struct nnue_kernel & k = kernels[kernel];
+	const Color side = board.get_side();
+
+	uint8_t input[2 * NNUE_MAX_HALF] __attribute__((aligned(32)));
+	k.clip(acc.v[side], input, half);
+	k.clip(acc.v[XSIDE(side)], input + half, half);
+
+	int32_t out = o_bias;
+	for (unsigned int j=0; j<hidden; j++) {
+		int32_t s = h_bias[j]
+			+ k.dot(input, h_weights + j * 2 * half, 2 * half);
+		s = (s < 0) ? 0 : (s >> 6);
+		if (s > 127) {
+			s = 127;
+		}
+		out += o_weights[j] * s;
+	}
+
+	return out / divisor;
+}
+
+bool NNUE::set_kernel(enum kernel_type k)
+{
+	if (!kernel_supported(k)) {
+		return false;
+	}
+	kernel = k;
+	return true;
+}
+
+bool NNUE::kernel_supported(enum kernel_type k) /* static */
+{
+	switch (k) {
+	case KERNEL_SCALAR:
+		return true;
+	case KERNEL_SSE2:
+#ifdef __SSE2__
+		return true;
+#else
+		return false;
+#endif
+	case KERNEL_AVX2:
+#ifdef NNUE_HAVE_AVX2
+		return __builtin_cpu_supports("avx2");
+#else
+		return false;
+#endif
+	}
+	return false;
+}
+
+const char * NNUE::kernel_name(enum kernel_type k) /* static */
+{
+	switch (k) {
+	case KERNEL_SCALAR:
+		return "scalar";
+	case KERNEL_SSE2:
+		return "sse2";
+	case KERNEL_AVX2:
+		return "avx2";
+	}
+	return "?";
+}
+
+void NNUE::set_network(NNUE * net) /* static */
+{
+	if (network != net) {
+		delete network;
+		network = net;
+	}
+}
@@ -0,0 +1,136 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef NNUE_H
+#define NNUE_H
+
+#include "common.h"
+#include "board.h"
+
+#include <stdio.h>
+
+
+/* HalfKP input features: own king square x (piece type, color) x square,
+ * kings themselves are not part of the piece set. */
+#define NNUE_INPUTS		(64 * 10 * 64)
+
+/* Upper bounds for the layer sizes accepted by NNUE::load(). */
+#define NNUE_MAX_HALF		512
+#define NNUE_MAX_HIDDEN		32
+
+/* Magic at the beginning of a network file. */
+#define NNUE_MAGIC		"HOINNUE1"
+
+/*
+ * Output of the feature transformer for both perspectives
+ * (WHITE and BLACK). The search keeps one per ply and updates it
+ * incrementally from the one of the parent node.
+ */
+struct NNUEAccumulator {
+	int16_t v[2][NNUE_MAX_HALF] __attribute__((aligned(32)));
+	bool computed;
+};
+
+/*
+ * Network with a HalfKP feature transformer, one hidden layer and
+ * a single output, using int16 accumulators and int8 weights.
+ *
+ * File format (all values little endian):
+ *
+ *   char    magic[8]                  "HOINNUE1"
+ *   uint32  half                      accumulator size, multiple of 32
+ *   uint32  hidden                    hidden layer size
+ *   uint32  divisor                   output scale
+ *   int16   ft_bias[half]
+ *   int16   ft_weights[NNUE_INPUTS][half]
+ *   int32   h_bias[hidden]
+ *   int8    h_weights[hidden][2*half] input is [side to move, other side]
+ *   int32   o_bias
+ *   int8    o_weights[hidden]
+ */
+class NNUE {
+      public:
+	enum kernel_type { KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2 };
+
+      private:
+	unsigned int half;
+	unsigned int hidden;
+	int divisor;
+
+	int16_t * ft_bias;
+	int16_t * ft_weights;
+	int32_t * h_bias;
+	int8_t * h_weights;
+	int32_t o_bias;
+	int8_t * o_weights;
+
+	enum kernel_type kernel;
+
+	/* The network used by the search, NULL if none is loaded. */
+	static NNUE * network;
+
+      public:
+	NNUE();
+	~NNUE();
+
+      public:
+	bool load(const char * filename);
+	void print_info() const;
+
+	void refresh(const Board & board, NNUEAccumulator * acc) const;
+	void update(const Board & before, const Board & after,
+			const NNUEAccumulator & from,
+			NNUEAccumulator * acc) const;
+	int evaluate(const Board & board, const NNUEAccumulator & acc) const;
+
+	enum kernel_type get_kernel() const;
+	bool set_kernel(enum kernel_type k);
+	static bool kernel_supported(enum kernel_type k);
+	static const char * kernel_name(enum kernel_type k);
+
+	static NNUE * get_network();
+	static void set_network(NNUE * net);
+
+      private:
+	void refresh_side(const Board & board, Color persp,
+			NNUEAccumulator * acc) const;
+	static unsigned int feature(Color persp, Square ksq,
+			Color c, Piece p, Square sq);
+};
+
+inline enum NNUE::kernel_type NNUE::get_kernel() const
+{
+	return kernel;
+}
+
+inline NNUE * NNUE::get_network() /* static */
+{
+	return network;
+}
+
+inline unsigned int NNUE::feature(Color persp, Square ksq,
+		Color c, Piece p, Square sq) /* static */
+{
+	if (persp == BLACK) {
+		ksq = SQUARE(XRNK(RNK(ksq)), FIL(ksq));
+		sq = SQUARE(XRNK(RNK(sq)), FIL(sq));
+	}
+	return (ksq * 10 + p * 2 + (c != persp)) * 64 + sq;
+}
+
+#endif // NNUE_H
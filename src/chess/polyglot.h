@@ -0,0 +1,68 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef POLYGLOT_H
+#define POLYGLOT_H
+
+#include "common.h"
+#include "board.h"
+#include "move.h"
+
+
+/*
+ * One entry of a Polyglot opening book. In the file, an entry takes 16
+ * bytes in big endian byte order, and the entries are sorted by key.
+ * A position has one entry per book move.
+ */
+struct PolyglotEntry {
+	Hashkey key;
+	uint16_t move;
+	uint16_t weight;
+	uint32_t learn;
+};
+
+/*
+ * Support for the opening book format of Polyglot.
+ *
+ * Polyglot books use their own Zobrist keys, which are computed from
+ * the Random64[] table of the format specification.
+ */
+class Polyglot
+{
+      public:
+	static const unsigned int NR_KEYS = 781;
+	static const unsigned int ENTRY_SIZE = 16;
+
+      private:
+	/* offsets into random64[] */
+	static const unsigned int KEY_CASTLE = 768;
+	static const unsigned int KEY_ENPASSANT = 772;
+	static const unsigned int KEY_TURN = 780;
+
+	static const Hashkey random64[NR_KEYS];
+
+      public:
+	static Hashkey key(const Board & board);
+	static uint16_t encode_move(Move mov);
+	static Move decode_move(const Board & board, uint16_t pmove);
+
+	static void unpack(const unsigned char * buf, PolyglotEntry * entry);
+	static void pack(const PolyglotEntry & entry, unsigned char * buf);
+};
+
+#endif // POLYGLOT_H
@@ -20,7 +20,12 @@
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 #include <unistd.h>
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
 
 #include <algorithm>
 #include <fstream>
@@ -30,7 +35,10 @@
 
 #include "common.h"
 #include "book.h"
+#include "bookbuilder.h"
+#include "gamedb.h"
 #include "pgn.h"
+#include "pgnpipeline.h"
 
 
 /*****************************************************************************
@@ -79,13 +87,21 @@ BookHeader BookHeader::b2h(const BookHeader& b, bool swap_byteorder)
  *
  *****************************************************************************/
 
+/*
+ * Selection weight of a move. The count from the PGN is scaled by the
+ * results of our own games, so that a move that keeps losing is played
+ * less often and one that keeps winning more often. Without learned
+ * results, the weight is proportional to the count.
+ */
+unsigned long long BookMove::weight() const
+{
+	return (unsigned long long) count * 256
+		* (2ULL * wins + draws + 2) / (2ULL * losses + draws + 2);
+}
+
 BookEntry::BookEntry()
 {
 	hashkey = NULLHASHKEY;
-	for (unsigned int i=0; i<NR_MOVES; i++) {
-		move[i] = NO_MOVE;
-		count[i] = 0;
-	}
 }
 
 /*
@@ -96,10 +112,128 @@ BookEntry::BookEntry(Hashkey _hashkey,
 		std::vector<std::pair<Move, unsigned int> > moves)
 {
 	hashkey = _hashkey;
+	for (unsigned int i=0; i<moves.size(); i++) {
+		BookMove bm;
+		bm.move = moves[i].first;
+		bm.count = moves[i].second;
+		bm.wins = bm.draws = bm.losses = 0;
+		this->moves.push_back(bm);
+	}
+}
+
+/*
+ * Randomly choose one move, with the distribution given by the weights.
+ */
+Move BookEntry::choose() const
+{
+	if (is_empty()) {
+		WARN("BookEntry contains no move!");
+		return NO_MOVE;
+	}
+	
+	unsigned long long total_weight = 0;
+	unsigned int i;
+	
+	for (i=0; i<moves.size(); i++) {
+		total_weight += moves[i].weight();
+	}
+	if (total_weight == 0) {
+		return moves[0].move;
+	}
+
+	/* Same distribution as drawing from a bag with weight() copies of
+	 * each move, without building the bag. The weights can exceed
+	 * RAND_MAX, so two random numbers are combined. */
+	unsigned long long k = (((unsigned long long) rand() << 31)
+			^ (unsigned long long) rand()) % total_weight;
+	for (i=0; i<moves.size(); i++) {
+		if (k < moves[i].weight())
+			break;
+		k -= moves[i].weight();
+	}
+	ASSERT(i < moves.size());
+	return moves[i].move;
+}
+
+/*
+ * Return the number of moves in this book entry.
+ */
+unsigned int BookEntry::nr_moves() const
+{
+	return moves.size();
+}
+
+/*
+ * Check if all moves in this BookEntry are valid and legal
+ * on a given board.
+ */
+bool BookEntry::is_valid_and_legal(const Board & board) const
+{
+	for (unsigned int i=0; i<moves.size(); i++) {
+		Move mov = moves[i].move;
+		if (!mov.is_valid(board) || !mov.is_legal(board)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/* 
+ * Print information about the book entry. We prepend every line with a
+ * single space, as required by the "bk" command.
+ */
+void BookEntry::print(const Board & board) const
+{
+	unsigned long long total_weight = 0;
+	for (unsigned i=0; i<moves.size(); i++) {
+		total_weight += moves[i].weight();
+	}
+	
+	if (total_weight == 0) {
+		return;
+	}
+	
+	for (unsigned int i=0; i<moves.size(); i++) {
+		const BookMove & bm = moves[i];
+		printf(" %-7s (%2lu%%)", bm.move.san(board).c_str(),
+				(unsigned long) (bm.weight() * 100
+					/ total_weight));
+		if (bm.wins || bm.draws || bm.losses) {
+			printf("  +%lu =%lu -%lu", (unsigned long) bm.wins,
+					(unsigned long) bm.draws,
+					(unsigned long) bm.losses);
+		}
+		printf("\n");
+	}
+}
+
+
+/*****************************************************************************
+ *
+ * Member functions of class BookSlot.
+ *
+ *****************************************************************************/
+
+BookSlot::BookSlot()
+{
+	hashkey = NULLHASHKEY;
+	for (unsigned int i=0; i<NR_MOVES; i++) {
+		move[i] = NO_MOVE;
+		count[i] = 0;
+	}
+}
+
+/*
+ * Take the first NR_MOVES moves of a BookEntry.
+ */
+BookSlot::BookSlot(const BookEntry & entry)
+{
+	hashkey = entry.hashkey;
 	for (unsigned int i=0; i<NR_MOVES; i++) {
-		if (i < moves.size()) {
-			move[i] = moves[i].first;
-			count[i] = moves[i].second;
+		if (i < entry.moves.size()) {
+			move[i] = entry.moves[i].move;
+			count[i] = entry.moves[i].count;
 		} else {
 			move[i] = NO_MOVE;
 			count[i] = 0;
@@ -107,16 +241,15 @@ BookEntry::BookEntry(Hashkey _hashkey,
 	}
 }
 
-
 /*
  * Function to convert from book to host byte order.
  */
-BookEntry BookEntry::h2b(const BookEntry& h, bool swap_byteorder) 
+BookSlot BookSlot::h2b(const BookSlot& h, bool swap_byteorder) 
 {
 	if (!swap_byteorder) {
 		return h;
 	} else {
-		BookEntry b;
+		BookSlot b;
 		b.hashkey = reverse_byte_order(h.hashkey);
 		for (unsigned int i=0; i<NR_MOVES; i++) {
 #ifdef HOICHESS	// FIXME for Xiangqi
@@ -131,7 +264,7 @@ BookEntry BookEntry::h2b(const BookEntry& h, bool swap_byteorder)
 /*
  * Function to convert from book to host byte order.
  */
-BookEntry BookEntry::b2h(const BookEntry& b, bool swap_byteorder)
+BookSlot BookSlot::b2h(const BookSlot& b, bool swap_byteorder)
 {
 	if (!swap_byteorder) {
 		return b;
@@ -141,100 +274,93 @@ BookEntry BookEntry::b2h(const BookEntry& b, bool swap_byteorder)
 	}
 }
 
-
-
-/*
- * Randomly choose one move, with the distribution given by count[].
- */
-Move BookEntry::choose() const
+BookEntry BookSlot::to_entry() const
 {
-	if (is_empty()) {
-		WARN("BookEntry contains no move!");
-		return NO_MOVE;
-	}
-	
-	unsigned int total_count = 0;
-	unsigned int i;
-	
-	for (i=0; i<NR_MOVES; i++) {
-		if (move[i] == NO_MOVE)
-			break;
-		total_count += count[i];
-	}
-
-	Move * bag = new Move[total_count];
-	unsigned int k = 0;
-	for (i=0; i<NR_MOVES; i++) {
-		if (move[i] == NO_MOVE)
+	BookEntry entry;
+	entry.hashkey = hashkey;
+	for (unsigned int i=0; i<NR_MOVES; i++) {
+		if (move[i] == NO_MOVE) {
 			break;
-		for (unsigned int j=0; j<count[i]; j++) {
-			bag[k++] = move[i];
 		}
+		BookMove bm;
+		bm.move = move[i];
+		bm.count = count[i];
+		bm.wins = bm.draws = bm.losses = 0;
+		entry.moves.push_back(bm);
 	}
+	return entry;
+}
 
-	k = rand() % total_count;
-	Move ret = bag[k];
-	delete[] bag;
-	return ret;
+
+/*****************************************************************************
+ *
+ * Member functions of class BookRecord.
+ *
+ *****************************************************************************/
+
+BookRecord::BookRecord()
+{
+	hashkey = NULLHASHKEY;
+	move = NO_MOVE;
+	count = 0;
+	wins = draws = losses = 0;
+	reserved = 0;
+}
+
+BookRecord::BookRecord(Hashkey _hashkey, const BookMove & bm)
+{
+	hashkey = _hashkey;
+	move = bm.move;
+	count = bm.count;
+	wins = bm.wins;
+	draws = bm.draws;
+	losses = bm.losses;
+	reserved = 0;
 }
 
 /*
- * Return the number of moves in this book entry.
+ * Function to convert from book to host byte order.
  */
-unsigned int BookEntry::nr_moves() const
+BookRecord BookRecord::h2b(const BookRecord& h, bool swap_byteorder)
 {
-	unsigned int n = 0;
-	for (unsigned int i=0; i<NR_MOVES; i++) {
-		if (move[i] == NO_MOVE)
-			break;
-		n++;
+	if (!swap_byteorder) {
+		return h;
+	} else {
+		BookRecord b;
+		b.hashkey = reverse_byte_order(h.hashkey);
+#ifdef HOICHESS	// FIXME for Xiangqi
+		b.move = Move(reverse_byte_order(h.move));
+#endif
+		b.count = reverse_byte_order(h.count);
+		b.wins = reverse_byte_order(h.wins);
+		b.draws = reverse_byte_order(h.draws);
+		b.losses = reverse_byte_order(h.losses);
+		return b;
 	}
-	return n;
 }
 
 /*
- * Check if all moves in this BookEntry are valid and legal
- * on a given board.
+ * Function to convert from book to host byte order.
  */
-bool BookEntry::is_valid_and_legal(const Board & board) const
+BookRecord BookRecord::b2h(const BookRecord& b, bool swap_byteorder)
 {
-	for (unsigned int i=0; i<BookEntry::NR_MOVES; i++) {
-		Move mov = move[i];
-		if (mov == NO_MOVE) {
-			break;
-		} else if (!mov.is_valid(board) || !mov.is_legal(board)) {
-			return false;
-		}
+	if (!swap_byteorder) {
+		return b;
+	} else {
+		/* mapping is symmetric */
+		return h2b(b, swap_byteorder);
 	}
-
-	return true;
 }
 
-/* 
- * Print information about the book entry. We prepend every line with a
- * single space, as required by the "bk" command.
- */
-void BookEntry::print(const Board & board) const
+BookMove BookRecord::to_move() const
 {
-	unsigned long total_count = 0;
-	for (unsigned i=0; i<NR_MOVES; i++) {
-		if (move[i] == NO_MOVE)
-			break;
-		total_count += count[i];
-	}
-	
-	if (total_count == 0) {
-		return;
-	}
-	
-	for (unsigned int i=0; i<BookEntry::NR_MOVES; i++) {
-		if (move[i] == NO_MOVE) {
-			break;
-		} else {
-			printf(" %-7s (%2lu%%)\n", move[i].san(board).c_str(),
-					count[i] * 100 / total_count);
-		}
-	}
+	BookMove bm;
+	bm.move = move;
+	bm.count = count;
+	bm.wins = wins;
+	bm.draws = draws;
+	bm.losses = losses;
+	return bm;
 }
 
 
@@ -244,12 +370,30 @@ void BookEntry::print(const Board & board) const
  *
  *****************************************************************************/
 
+#ifdef HOICHESS
+/*
+ * Polyglot books have no header, so they are told by the file name.
+ */
+bool Book::is_polyglot_file(const char * filename) /* static */
+{
+	const size_t len = strlen(filename);
+	return len >= 4 && strcmp(filename + len - 4, ".bin") == 0;
+}
+#endif
+
 /*
- * Open the book for reading.
+ * Open the book for reading, or also for writing if the engine shall
+ * learn from its games, see learn(). If possible, the file is mapped
+ * into memory, so that lookups need no system calls and all processes
+ * using the same book share one copy in the page cache.
  */
-Book::Book(const char * filename, bool * ret)
+Book::Book(const char * filename, bool * ret, bool writable)
 {
-	fp = fopen(filename, "rb");
+	map = NULL;
+	map_size = 0;
+	this->writable = writable;
+
+	fp = fopen(filename, writable ? "r+b" : "rb");
 	if (!fp) {
 		/* Yuck! Under xboard, we must not print messages containing
 		 * things like 'no such file' because this will cause an
@@ -262,12 +406,41 @@ Book::Book(const char * filename, bool * ret)
 		return;
 	}
 
+	struct stat st;
+	if (fstat(fileno(fp), &st) == -1) {
+		perror("Book::Book(): fstat() failed");
+		exit(EXIT_FAILURE);
+	}
+
+#ifdef HOICHESS
+	if (is_polyglot_file(filename)) {
+		if (st.st_size % Polyglot::ENTRY_SIZE != 0) {
+			fclose(fp);
+			printf("%s seems to be no Polyglot opening book"
+					" (size %llu is no multiple of %u)\n",
+					filename,
+					(unsigned long long) st.st_size,
+					Polyglot::ENTRY_SIZE);
+			*ret = false;
+			return;
+		}
+		swap_byteorder = false;
+		format = FORMAT_POLYGLOT;
+		header.size = st.st_size / Polyglot::ENTRY_SIZE;
+		map_file();
+		*ret = true;
+		return;
+	}
+#endif
+
 	swap_byteorder = false;
 	read_header();
-	if (header.magic != BookHeader::s_magic) {
+	if (header.magic != BookHeader::s_magic
+			&& header.magic != BookHeader::s_magic_sorted) {
 		swap_byteorder = true;
 		read_header();
-		if (header.magic != BookHeader::s_magic) {
+		if (header.magic != BookHeader::s_magic
+				&& header.magic != BookHeader::s_magic_sorted) {
 			fclose(fp);
 			printf(	"%s seems to be no HoiChess opening book"
 				" (magic = 0x%0lx, should be 0x%0lx)\n",
@@ -281,6 +454,19 @@ Book::Book(const char * filename, bool * ret)
 			return;
 		}
 	}
+	format = (header.magic == BookHeader::s_magic_sorted)
+		? FORMAT_SORTED : FORMAT_HASH;
+
+	if ((unsigned long long) st.st_size < sizeof(BookHeader)
+			+ (unsigned long long) header.size * entry_size()) {
+		fclose(fp);
+		printf("%s is truncated (%lu slots, %llu bytes)\n",
+				filename, (unsigned long) header.size,
+				(unsigned long long) st.st_size);
+		*ret = false;
+		return;
+	}
+	map_file();
 
 	*ret = true;
 }
@@ -291,6 +477,10 @@ Book::Book(const char * filename, bool * ret)
  */
 Book::Book(const char * filename, unsigned long size)
 {
+	map = NULL;
+	map_size = 0;
+	writable = true;
+
 	fp = fopen(filename, "w+b");
 	if (!fp) {
 		fprintf(stderr, "Cannot open %s for writing: %s\n",
@@ -299,18 +489,24 @@ Book::Book(const char * filename, unsigned long size)
 	}
 
 	swap_byteorder = false;
+	format = FORMAT_HASH;
 	header.size = size;
 	write_header();
 	
 	/* Wipe out all slots */
-	BookEntry entry;
+	BookSlot entry;
 	for (unsigned long i=0; i<size; i++) {
-		write_entry(i, entry);
+		write_slot(i, entry);
 	}
 }
 
 Book::~Book()
 {
+#ifdef HAVE_MMAP
+	if (map) {
+		munmap((void *) map, map_size);
+	}
+#endif
 	fclose(fp);
 }
 
@@ -320,21 +516,48 @@ Book::~Book()
  */
 bool Book::lookup(const Board & board, BookEntry * entry) const
 {
+#ifdef HOICHESS
+	if (format == FORMAT_POLYGLOT) {
+		return lookup_polyglot(board, entry);
+	}
+#endif
+
 	Hashkey hashkey = board.get_hashkey();
 	unsigned long slot = 0;
+
+	if (format == FORMAT_SORTED) {
+		if (!find_sorted(hashkey, &slot)) {
+			return false;
+		}
+		*entry = BookEntry();
+		entry->hashkey = hashkey;
+		for (slot = first_sorted(hashkey, slot); slot < header.size
+				&& read_key(slot) == hashkey; slot++) {
+			entry->moves.push_back(read_record(slot).to_move());
+		}
+		if (!entry->is_valid_and_legal(board)) {
+			WARN("invalid or illegal move in book, perhaps an"
+					" undetected hash collision");
+			return false;
+		}
+		return true;
+	}
+
 	for (unsigned int i=0; i<header.size; i++) {
 		slot = hashfunc(hashkey, i);
 
-		*entry = read_entry(slot);
-		if (entry->is_empty()) {
+		const BookSlot bs = read_slot(slot);
+		if (bs.is_empty()) {
 			/* Slot is totally empty */
 			return false;
-		} else if (entry->hashkey != hashkey) {
+		} else if (bs.hashkey != hashkey) {
 			/* Collision */
 			continue;
-		} else if (!entry->is_valid_and_legal(board)) {
+		}
+		*entry = bs.to_entry();
+		if (!entry->is_valid_and_legal(board)) {
 			WARN("invalid or illegal move in book, perhaps an"
-					"undetected hash collision");
+					" undetected hash collision");
 			return false;
 		} else {
 			return true;
@@ -346,11 +569,13 @@ bool Book::lookup(const Board & board, BookEntry * entry) const
 
 bool Book::put(const BookEntry & newentry)
 {
+	ASSERT(format == FORMAT_HASH);
+
 	unsigned long slot = 0;
 	for (unsigned int i=0; i<header.size; i++) {
 		slot = hashfunc(newentry.hashkey, i);
 
-		BookEntry oldentry = read_entry(slot);
+		BookSlot oldentry = read_slot(slot);
 		if (oldentry.is_empty()) {
 			/* Slot was empty */
 #ifdef DEBUG
@@ -378,172 +603,176 @@ bool Book::put(const BookEntry & newentry)
 
 	}
 	
-	write_entry(slot, newentry);
+	write_slot(slot, BookSlot(newentry));
 	return true;
 }
 
 /*
- * This is a simple multi hash function. It works rather well in practice.
+ * Record the result of one of our games in which mov was played in the
+ * position on board. score is 1, 0 or -1 for a win, draw or loss of the
+ * side that played the move. The record is updated in place, so this
+ * needs a book with sorted layout opened for writing. Returns false if
+ * the move is not in the book.
  */
-unsigned long Book::hashfunc(Hashkey hashkey, unsigned int i) const
+bool Book::learn(const Board & board, Move mov, int score)
 {
-	return (hashkey % header.size + i * (hashkey % (header.size-1)))
-		% header.size;
+	if (!can_learn()) {
+		return false;
+	}
+
+	const Hashkey hashkey = board.get_hashkey();
+	unsigned long slot;
+	if (!find_sorted(hashkey, &slot)) {
+		return false;
+	}
+
+	for (slot = first_sorted(hashkey, slot); slot < header.size
+			&& read_key(slot) == hashkey; slot++) {
+		BookRecord record = read_record(slot);
+		if (record.move != mov) {
+			continue;
+		}
+
+		uint32_t * n = (score > 0) ? &record.wins
+			: (score < 0) ? &record.losses : &record.draws;
+		if (*n < 0xffffffffUL) {
+			(*n)++;
+		}
+		write_record(slot, record);
+		return true;
+	}
+
+	return false;
 }
 
 /*
- * Read a PGN game database and create a new opening book from the first
- * `depth' moves of each game.
+ * This is a simple multi hash function. It works rather well in practice.
  */
-void Book::create_from_pgn(const char * bookfile, const char * pgnfile,
-		unsigned int depth, unsigned int min_move_count)
+unsigned long Book::hashfunc(Hashkey hashkey, unsigned int i) const
 {
-	FILE * fp = fopen(pgnfile, "r");
-	if (!fp) {
-		fprintf(stderr, "Cannot open %s for reading: %s\n",
-			pgnfile, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
+	return hashfunc(hashkey, i, header.size);
+}
 
-	bool show_progress = (isatty(1) == 1);
+unsigned long Book::hashfunc(Hashkey hashkey, unsigned int i,
+		unsigned long size) /* static */
+{
+	return (hashkey % size + i * (hashkey % (size-1))) % size;
+}
 
-	/*
-	 * Read all games from PGN file. Create a map with a position's
-	 * hash key and a list of moves played in this position.
-	 *
-	 * TODO This is very slow.
-	 */
-	std::map<Hashkey, std::list<Move> > pgnmap;
-	unsigned long read = 0, skipped = 0;
+/*
+ * Search a book with sorted layout for hashkey. Hash keys are uniformly
+ * distributed, so interpolation search needs only a few probes. If it
+ * does not converge quickly, e.g. for a book with clustered keys, we
+ * continue with binary search.
+ */
+bool Book::find_sorted(Hashkey hashkey, unsigned long * slot) const
+{
+	unsigned long lo = 0, hi = header.size;
+	unsigned int probes = 0;
 
-	if (!show_progress) {
-		printf("Reading PGN...\n");
-	}
+	while (lo < hi) {
+		const Hashkey klo = read_key(lo);
+		const Hashkey khi = read_key(hi - 1);
+		if (hashkey < klo || hashkey > khi) {
+			return false;
+		} else if (hashkey == klo) {
+			*slot = lo;
+			return true;
+		} else if (hashkey == khi) {
+			*slot = hi - 1;
+			return true;
+		} else if (hi - lo <= 2) {
+			return false;
+		}
 
-	while (!feof(fp)) {
-		PGN pgn;
-		if (pgn.parse(fp)) {
-			Board board = pgn.get_opening();
-			std::list<Move> moves = pgn.get_moves();
-			unsigned int i = 0;
-			for (std::list<Move>::iterator it = moves.begin();
-					it != moves.end();
-					it++) {
-				ASSERT(it->is_valid(board));
-				ASSERT(it->is_legal(board));
-				pgnmap[board.get_hashkey()].push_back(*it);
-				
-				i++;
-				if (i > depth && depth > 0)
-					break;
-				
-				board.make_move(*it);
+		/* Now klo < hashkey < khi, so hashkey can only be in
+		 * lo+1 ... hi-2. */
+		unsigned long mid;
+		if (probes++ < 4) {
+			const double f = (double) (hashkey - klo)
+				/ (double) (khi - klo);
+			mid = lo + 1 + (unsigned long) (f * (hi - lo - 2));
+			if (mid > hi - 2) {
+				mid = hi - 2;
 			}
-
-			read++;
 		} else {
-			skipped++;
+			mid = lo + (hi - lo) / 2;
 		}
 
-		if (show_progress && ((read+skipped) % 1000 == 0)) {
-			printf("Reading PGN: %lu games read, "
-					"%lu games skipped due to errors\r",
-					read, skipped);
-			fflush(stdout);
+		const Hashkey key = read_key(mid);
+		if (key == hashkey) {
+			*slot = mid;
+			return true;
+		} else if (key < hashkey) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
 		}
 	}
 
-	fclose(fp);
-	
-	printf("Reading PGN: %lu games read, "
-			"%lu games skipped due to errors\n",
-			read, skipped);
+	return false;
+}
 
-	printf("Total number of different positions in games: %lu\n",
-			(unsigned long) pgnmap.size());
+/*
+ * Return the first of the records with hashkey, given any one of them.
+ */
+unsigned long Book::first_sorted(Hashkey hashkey, unsigned long slot) const
+{
+	while (slot > 0 && read_key(slot - 1) == hashkey) {
+		slot--;
+	}
+	return slot;
+}
 
+/*
+ * Read a PGN game database and create a new opening book from the first
+ * `depth' moves of each game, using at most about `memory' bytes for
+ * the moves and the book table, see class BookBuilder. pgnfile can also
+ * be a binary game database, see class GameDB.
+ */
+bool Book::create_from_pgn(const char * bookfile, const char * pgnfile,
+		unsigned int depth, unsigned int min_move_count, size_t memory,
+		unsigned int nthreads, Format format)
+{
+	bool show_progress = (isatty(1) == 1);
 
-	/*
-	 * Create a BookEntry for each position stored in
-	 * the map, and store all book entries in a list.
-	 */
+	BookBuilder builder(depth, min_move_count, memory, format);
 
 	if (!show_progress) {
-		printf("Sorting and filtering book contents...\n");
+		printf("Reading PGN...\n");
 	}
 
-	/* Statistics about average number of moves per BookEntry. */
-	unsigned long stat_mpe_sum = 0, stat_mpe_cnt = 0;
-	unsigned long nr_entries = 0;
-	unsigned long nr_entries_total = pgnmap.size();
-	std::list<BookEntry> entries;
-	for (std::map<Hashkey, std::list<Move> >::iterator it = pgnmap.begin();
-			it != pgnmap.end();
-			it++) {
-		BookEntry entry(it->first, group_moves(it->second,
-					min_move_count));
-		if (!entry.is_empty()) {
-			entries.push_back(entry);
-			stat_mpe_sum += entry.nr_moves();
-			stat_mpe_cnt++;
+	struct timeval tv_start, tv_now;
+	gettimeofday(&tv_start, NULL);
+
+	if (GameDB::is_gamedb(pgnfile)) {
+		bool ok;
+		GameDB db(pgnfile, &ok);
+		if (!ok) {
+			return false;
 		}
-		nr_entries++;
-
-		if (show_progress && ((nr_entries_total >= 100
-				&& (nr_entries % (nr_entries_total/100) == 0))
-				|| nr_entries == nr_entries_total)) {
-			printf("Sorting and filtering book contents: %lu%%\r",
-					nr_entries * 100 / nr_entries_total);
-			fflush(stdout);
+		/* BookBuilder takes up to depth+1 moves per game. */
+		db.replay_all(&builder, show_progress,
+				(depth > 0) ? depth + 1 : 0);
+	} else {
+		/* The order of the games does not matter for the book. */
+		PGNPipeline pipeline(nthreads, false);
+		if (!pipeline.run(pgnfile, &builder, show_progress)) {
+			return false;
 		}
+		pipeline.print_statistics();
 	}
-	printf("\n");
-	
-	float stat_mpe_avg = (stat_mpe_cnt != 0) ?
-		((float) stat_mpe_sum / stat_mpe_cnt) : ((float) 0);
-	printf("Average number of moves per position: %.2f\n", stat_mpe_avg);
-
-	
-	/*
-	 * Write book to file.
-	 */
-	
-	unsigned long booksize = entries.size();
-	printf("Opening book will contain %lu positions.\n", booksize);
 
-	/* Add some extra space to reduce hash collisions */
-	unsigned long ext_booksize = (unsigned long) (booksize * 1.1);
-	
-	printf("Creating opening book with %lu entries.\n", ext_booksize);
-	Book book(bookfile, ext_booksize);
-
-	if (!show_progress) {
-		printf("Writing book to file...\n");
+	if (!builder.write(bookfile)) {
+		return false;
 	}
-	
-	unsigned long written = 0, collisions = 0;
-	for (std::list<BookEntry>::iterator it = entries.begin();
-			it != entries.end();
-			it++) {
-		if (book.put(*it)) {
-			written++;
-		} else {
-			collisions++;
-		}
 
-		unsigned long total = written + collisions;
-		if (show_progress && ((booksize >= 100
-				&& (total % (booksize/100) == 0))
-					|| total == booksize)) {
-			printf("Writing book to file: %lu%%\r",
-					total * 100 / booksize);
-			fflush(stdout);
-		}
-	}
-	printf("\n");
-	
-	printf("%lu entries written, %lu irresolvable collisions\n",
-			written, collisions);
+	gettimeofday(&tv_now, NULL);
+	const double secs = (tv_now.tv_sec - tv_start.tv_sec)
+		+ (tv_now.tv_usec - tv_start.tv_usec) / 1000000.0;
+	printf("Book created in %.1f s, %.0f games/s\n",
+			secs, secs > 0 ? builder.get_games() / secs : 0.0);
+	return true;
 }
 
 /*
@@ -580,17 +809,25 @@ std::vector<std::pair<Move, unsigned int> > Book::group_moves(
 	}
 	
 	/* Put entries of map into vector. */
-	std::vector<std::pair<Move, unsigned int> > ret;
-	for (std::map<Move, unsigned int, Move::strict_weak_ordering>::iterator
-							it2 = count.begin();
-			it2 != count.end();
-			it2++) {
-		Move mov = it2->first;
-		unsigned int cnt = it2->second;
+	std::vector<std::pair<Move, unsigned int> > counts(count.begin(),
+			count.end());
+	return select_moves(counts, min_move_count);
+}
 
+/*
+ * Second half of group_moves(): take the distinct moves with their
+ * counts, in Move::strict_weak_ordering, keep those that appeared at
+ * least min_move_count times and sort them descendingly by count.
+ */
+std::vector<std::pair<Move, unsigned int> > Book::select_moves(
+		const std::vector<std::pair<Move, unsigned int> > & counts,
+		unsigned int min_move_count)
+{
+	std::vector<std::pair<Move, unsigned int> > ret;
+	for (size_t i=0; i<counts.size(); i++) {
 		/* Keep only frequently played moves. */
-		if (cnt >= min_move_count) {
-			ret.push_back(std::pair<Move, unsigned int>(mov, cnt));
+		if (counts[i].second >= min_move_count) {
+			ret.push_back(counts[i]);
 		}
 	}
 
@@ -605,6 +842,39 @@ std::vector<std::pair<Move, unsigned int> > Book::group_moves(
  * Low-level book access funtions.
  *****************************************************************************/
 
+/*
+ * Map the book file into memory, read-only unless it is opened for
+ * learning. If that is not possible, all reads and writes go through fp.
+ */
+void Book::map_file()
+{
+#ifdef HAVE_MMAP
+	size_t len = sizeof(BookHeader) + (size_t) header.size * entry_size();
+# ifdef HOICHESS
+	if (format == FORMAT_POLYGLOT) {
+		len = (size_t) header.size * Polyglot::ENTRY_SIZE;
+	}
+# endif
+	if (len == 0) {
+		return;
+	}
+	void * p = mmap(NULL, len, writable ? PROT_READ | PROT_WRITE
+			: PROT_READ, MAP_SHARED, fileno(fp), 0);
+	if (p == MAP_FAILED) {
+		WARN("mmap() failed, reading book with stdio");
+		return;
+	}
+# ifdef MADV_RANDOM
+	/* Hash table probes are scattered, readahead would be wasted. */
+	if (format == FORMAT_HASH) {
+		madvise(p, len, MADV_RANDOM);
+	}
+# endif
+	map = (char *) p;
+	map_size = len;
+#endif
+}
+
 void Book::read_header()
 {
 	if (fseek(fp, 0, SEEK_SET) == -1) {
@@ -634,43 +904,191 @@ void Book::write_header()
 	}
 }
 
-BookEntry Book::read_entry(unsigned long slot) const
+/*
+ * Size of a slot, a record or a Polyglot entry.
+ */
+size_t Book::entry_size() const
+{
+	switch (format) {
+	case FORMAT_SORTED:
+		return sizeof(BookRecord);
+#ifdef HOICHESS
+	case FORMAT_POLYGLOT:
+		return Polyglot::ENTRY_SIZE;
+#endif
+	default:
+		return sizeof(BookSlot);
+	}
+}
+
+/*
+ * Read len bytes at pos from the mapped book or from fp.
+ */
+void Book::read_at(unsigned long pos, void * buf, size_t len) const
+{
+	if (map) {
+		memcpy(buf, map + pos, len);
+		return;
+	}
+
+	if (fseek(fp, pos, SEEK_SET) == -1) {
+		perror("Book::read_at(): fseek() failed");
+		exit(EXIT_FAILURE);
+	}
+	if (fread(buf, len, 1, fp) != 1) {
+		perror("Book::read_at(): fread() failed");
+		exit(EXIT_FAILURE);
+	}
+}
+
+void Book::write_at(unsigned long pos, const void * buf, size_t len)
+{
+	ASSERT(writable);
+	if (map) {
+		memcpy(map + pos, buf, len);
+		return;
+	}
+
+	if (fseek(fp, pos, SEEK_SET) == -1) {
+		perror("Book::write_at(): fseek() failed");
+		exit(EXIT_FAILURE);
+	}
+	if (fwrite(buf, len, 1, fp) != 1) {
+		perror("Book::write_at(): fwrite() failed");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/*
+ * Read only the hash key of the slot or record, which both start with
+ * it.
+ */
+Hashkey Book::read_key(unsigned long slot) const
+{
+	if (slot >= header.size) {
+		BUG("Slot is beyond end of book: slot = %d, size = %d",
+				slot, header.size);
+	}
+
+	Hashkey key;
+	read_at(sizeof(BookHeader) + slot * entry_size(), &key, sizeof(key));
+	return swap_byteorder ? reverse_byte_order(key) : key;
+}
+
+BookSlot Book::read_slot(unsigned long slot) const
 {
+	ASSERT(format == FORMAT_HASH);
 	if (slot >= header.size) {
 		BUG("Slot is beyond end of book: slot = %d, size = %d",
 				slot, header.size);
 	}
 	
-	unsigned long pos = sizeof(BookHeader) + slot * sizeof(BookEntry);
-	if (fseek(fp, pos, SEEK_SET) == -1) {
-		perror("Book::read_entry(): fseek() failed");
-		exit(EXIT_FAILURE);
+	BookSlot tmp_entry;
+	read_at(sizeof(BookHeader) + slot * sizeof(BookSlot),
+			&tmp_entry, sizeof(BookSlot));
+	return BookSlot::b2h(tmp_entry, swap_byteorder);
+}
+
+void Book::write_slot(unsigned long slot, const BookSlot & entry)
+{
+	ASSERT(format == FORMAT_HASH);
+	if (slot >= header.size) {
+		BUG("Slot is beyond end of book: slot = %d, size = %d",
+				slot, header.size);
 	}
 	
-	BookEntry tmp_entry;
-	if (fread(&tmp_entry, sizeof(BookEntry), 1, fp) != 1) {
-		perror("Book::read_entry(): fread() failed");
-		exit(EXIT_FAILURE);
+	BookSlot tmp_entry = BookSlot::h2b(entry, swap_byteorder);
+	write_at(sizeof(BookHeader) + slot * sizeof(BookSlot),
+			&tmp_entry, sizeof(BookSlot));
+}
+
+BookRecord Book::read_record(unsigned long slot) const
+{
+	ASSERT(format == FORMAT_SORTED);
+	if (slot >= header.size) {
+		BUG("Slot is beyond end of book: slot = %d, size = %d",
+				slot, header.size);
 	}
-	return BookEntry::b2h(tmp_entry, swap_byteorder);
+
+	BookRecord tmp_record;
+	read_at(sizeof(BookHeader) + slot * sizeof(BookRecord),
+			&tmp_record, sizeof(BookRecord));
+	return BookRecord::b2h(tmp_record, swap_byteorder);
 }
 
-void Book::write_entry(unsigned long slot, const BookEntry & entry)
+void Book::write_record(unsigned long slot, const BookRecord & record)
 {
+	ASSERT(format == FORMAT_SORTED);
 	if (slot >= header.size) {
 		BUG("Slot is beyond end of book: slot = %d, size = %d",
 				slot, header.size);
 	}
-	
-	unsigned long pos = sizeof(BookHeader) + slot * sizeof(BookEntry);
-	if (fseek(fp, pos, SEEK_SET) == -1) {
-		perror("Book::write_entry(), fseek failed");
-		exit(EXIT_FAILURE);
+
+	BookRecord tmp_record = BookRecord::h2b(record, swap_byteorder);
+	write_at(sizeof(BookHeader) + slot * sizeof(BookRecord),
+			&tmp_record, sizeof(BookRecord));
+}
+
+#ifdef HOICHESS
+/*
+ * Look up a position in a Polyglot book. The entries of a position are
+ * found by binary search, and all its moves are returned, sorted by
+ * weight. Moves with weight 0 are never played.
+ */
+bool Book::lookup_polyglot(const Board & board, BookEntry * entry) const
+{
+	const Hashkey key = Polyglot::key(board);
+	PolyglotEntry pe;
+
+	/* find the first entry with key */
+	unsigned long lo = 0, hi = header.size;
+	while (lo < hi) {
+		const unsigned long mid = lo + (hi - lo) / 2;
+		read_polyglot_entry(mid, &pe);
+		if (pe.key < key) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
 	}
 
-	BookEntry tmp_entry = BookEntry::h2b(entry, swap_byteorder);
-	if (fwrite(&tmp_entry, sizeof(BookEntry), 1, fp) != 1) {
-		perror("Book::write_entry(): fwrite() failed");
-		exit(EXIT_FAILURE);
+	std::vector<std::pair<Move, unsigned int> > moves;
+	for (unsigned long slot = lo; slot < header.size; slot++) {
+		read_polyglot_entry(slot, &pe);
+		if (pe.key != key) {
+			break;
+		} else if (pe.weight == 0) {
+			continue;
+		}
+
+		const Move mov = Polyglot::decode_move(board, pe.move);
+		if (mov == NO_MOVE) {
+			WARN("illegal move in Polyglot book, perhaps an"
+					" undetected hash collision");
+			continue;
+		}
+		moves.push_back(std::pair<Move, unsigned int>(mov, pe.weight));
 	}
+
+	if (moves.empty()) {
+		return false;
+	}
+	std::stable_sort(moves.begin(), moves.end(),
+			cannot_imagine_a_name_for_this_class());
+	*entry = BookEntry(board.get_hashkey(), moves);
+	return true;
 }
+
+void Book::read_polyglot_entry(unsigned long slot,
+		PolyglotEntry * entry) const
+{
+	if (slot >= header.size) {
+		BUG("Slot is beyond end of book: slot = %d, size = %d",
+				slot, header.size);
+	}
+
+	unsigned char buf[Polyglot::ENTRY_SIZE];
+	read_at(slot * Polyglot::ENTRY_SIZE, buf, sizeof(buf));
+	Polyglot::unpack(buf, entry);
+}
+#endif
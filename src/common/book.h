@@ -23,6 +23,9 @@
 #include "board.h"
 #include "hash.h"
 #include "move.h"
+#ifdef HOICHESS
+# include "polyglot.h"
+#endif
 
 #include <stdio.h> 
 
@@ -31,26 +34,37 @@
 #include <stdexcept>
 
 
+/*
+ * A move in a book entry. wins, draws and losses count the engine's
+ * own games with this move, see Book::learn().
+ */
+struct BookMove {
+	Move move;
+	uint32_t count;		/* number of games in the PGN */
+	uint32_t wins;
+	uint32_t draws;
+	uint32_t losses;
+
+	unsigned long long weight() const;
+};
+
+/*
+ * All book moves of one position, sorted by count, descending.
+ */
 class BookEntry {
 	friend class Book;
-	static const unsigned int NR_MOVES = 4;
+	friend class BookBuilder;
+	friend class BookSlot;
 
       private:
-	/* Do not change the order or the type of those members. They are
-	 * written to the book in binary format. */
-	Hashkey hashkey;		/* is uint64_t */
-	Move move[NR_MOVES];		/* is uint32_t */
-	uint32_t count[NR_MOVES];
+	Hashkey hashkey;
+	std::vector<BookMove> moves;
 
       public:
 	BookEntry();
 	BookEntry(Hashkey _hashkey,
 			std::vector<std::pair<Move, unsigned int> > moves);
 	
-	/* Functions to convert between host and book byte order. */
-	static BookEntry h2b(const BookEntry& h, bool swap_byteorder);
-	static BookEntry b2h(const BookEntry& b, bool swap_byteorder);
-	
       public:
 	Move choose() const;
 	inline bool is_empty() const;
@@ -61,11 +75,75 @@ class BookEntry {
 
 inline bool BookEntry::is_empty() const
 {
-	return move[0] == NO_MOVE;
+	return moves.empty();
 }
 
+/*
+ * A slot of a book with hash table layout, which has room for NR_MOVES
+ * moves of a position.
+ */
+class BookSlot {
+	friend class Book;
+	friend class BookBuilder;
+	static const unsigned int NR_MOVES = 4;
+
+      private:
+	/* Do not change the order or the type of those members. They are
+	 * written to the book in binary format. */
+	Hashkey hashkey;		/* is uint64_t */
+	Move move[NR_MOVES];		/* is uint32_t */
+	uint32_t count[NR_MOVES];
+
+      public:
+	BookSlot();
+	BookSlot(const BookEntry & entry);
+
+	/* Functions to convert between host and book byte order. */
+	static BookSlot h2b(const BookSlot& h, bool swap_byteorder);
+	static BookSlot b2h(const BookSlot& b, bool swap_byteorder);
+
+      public:
+	BookEntry to_entry() const;
+
+	bool is_empty() const
+	{ return move[0] == NO_MOVE; }
+};
+
+/*
+ * A record of a book with sorted layout holds a single move, so a
+ * position can have any number of moves. The records of a position are
+ * adjacent and sorted by count, descending.
+ */
+class BookRecord {
+	friend class Book;
+	friend class BookBuilder;
+
+      private:
+	/* Do not change the order or the type of those members. They are
+	 * written to the book in binary format. */
+	Hashkey hashkey;		/* is uint64_t */
+	Move move;			/* is uint32_t */
+	uint32_t count;
+	uint32_t wins;
+	uint32_t draws;
+	uint32_t losses;
+	uint32_t reserved;
+
+      public:
+	BookRecord();
+	BookRecord(Hashkey _hashkey, const BookMove & bm);
+
+	/* Functions to convert between host and book byte order. */
+	static BookRecord h2b(const BookRecord& h, bool swap_byteorder);
+	static BookRecord b2h(const BookRecord& b, bool swap_byteorder);
+
+      public:
+	BookMove to_move() const;
+};
+
 class BookHeader {
 	friend class Book;
+	friend class BookBuilder;
 
       private:
 	/* Do not change the order or the type of those members. They are
@@ -73,10 +151,14 @@ class BookHeader {
 	uint32_t size;
 	uint32_t magic;
 
+	/* s_magic is a hash table of BookSlots, s_magic_sorted is a list
+	 * of BookRecords sorted by hash key, see Book::lookup() */
 #if defined(HOICHESS)
 	static const uint32_t s_magic = 0xdaabaffeL;
+	static const uint32_t s_magic_sorted = 0xdaabb1feL;
 #elif defined(HOIXIANGQI)
 	static const uint32_t s_magic = 0x6a8dda83L;
+	static const uint32_t s_magic_sorted = 0x6a8ddc85L;
 #else
 # error "neither HOICHESS nor HOIXIANGQI defined"
 #endif
@@ -90,33 +172,85 @@ class BookHeader {
 };
 
 class Book {
+	friend class BookBuilder;
+
+      public:
+	/* Layout of the book file. FORMAT_HASH and FORMAT_SORTED are
+	 * distinguished by the magic number in the header. Polyglot books
+	 * have no header and are recognized by the .bin extension. */
+	enum Format {
+		FORMAT_HASH,
+		FORMAT_SORTED,
+#ifdef HOICHESS
+		FORMAT_POLYGLOT,
+#endif
+	};
+
       private:
 	FILE * fp;
 	bool swap_byteorder;
-	BookHeader header;
+	Format format;
+	BookHeader header;		/* size is the number of entries
+					 * for Polyglot books */
+
+	/* opened for learning, see learn() */
+	bool writable;
+
+	/* the book file mapped into memory, NULL if read via fp */
+	char * map;
+	size_t map_size;
 	
       public:
-	Book(const char * filename, bool * ret);
+	Book(const char * filename, bool * ret, bool writable = false);
 	Book(const char * filename, unsigned long size);
 	~Book();
 
       public:
 	bool lookup(const Board & board, BookEntry * entry) const;
 	bool put(const BookEntry & entry);
+	bool learn(const Board & board, Move mov, int score);
 
-	static void create_from_pgn(const char * bookfile,
+	bool can_learn() const
+	{ return writable && format == FORMAT_SORTED; }
+
+	static bool create_from_pgn(const char * bookfile,
 			const char * pgnfile,
 			unsigned int depth,
-			unsigned int min_move_count);
+			unsigned int min_move_count,
+			size_t memory,
+			unsigned int nthreads = 1,
+			Format format = FORMAT_HASH);
+#ifdef HOICHESS
+	static bool is_polyglot_file(const char * filename);
+#endif
 
       private:
 	unsigned long hashfunc(Hashkey hashkey, unsigned int i) const;
+	static unsigned long hashfunc(Hashkey hashkey, unsigned int i,
+			unsigned long size);
 	static std::vector<std::pair<Move, unsigned int> > group_moves(
 			std::list<Move> moves, unsigned int min_move_count);
+	static std::vector<std::pair<Move, unsigned int> > select_moves(
+			const std::vector<std::pair<Move, unsigned int> > &
+			counts, unsigned int min_move_count);
+	bool find_sorted(Hashkey hashkey, unsigned long * slot) const;
+	unsigned long first_sorted(Hashkey hashkey, unsigned long slot) const;
+#ifdef HOICHESS
+	bool lookup_polyglot(const Board & board, BookEntry * entry) const;
+	void read_polyglot_entry(unsigned long slot,
+			PolyglotEntry * entry) const;
+#endif
+	void map_file();
 	void read_header();
 	void write_header();
-	BookEntry read_entry(unsigned long slot) const;
-	void write_entry(unsigned long slot, const BookEntry & entry);
+	size_t entry_size() const;
+	void read_at(unsigned long pos, void * buf, size_t len) const;
+	void write_at(unsigned long pos, const void * buf, size_t len);
+	Hashkey read_key(unsigned long slot) const;
+	BookSlot read_slot(unsigned long slot) const;
+	void write_slot(unsigned long slot, const BookSlot & entry);
+	BookRecord read_record(unsigned long slot) const;
+	void write_record(unsigned long slot, const BookRecord & record);
 };
 
 #endif // BOOK_H
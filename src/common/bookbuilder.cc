@@ -0,0 +1,450 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <list>
+#include <vector>
+
+#include "common.h"
+#include "bookbuilder.h"
+
+
+/*****************************************************************************
+ *
+ * Member functions of class BookBuilder.
+ *
+ *****************************************************************************/
+
+BookBuilder::BookBuilder(unsigned int depth, unsigned int min_move_count,
+		size_t memory, Book::Format format)
+	: sorter(memory)
+{
+	this->depth = depth;
+	this->min_move_count = min_move_count;
+	this->memory = memory;
+	this->format = format;
+
+	games = 0;
+}
+
+/*
+ * Add the positions and moves of one game. Like the old builder, the
+ * first depth+1 moves are taken, or all moves if depth is 0.
+ */
+void BookBuilder::add_game(const Board & opening,
+		const std::list<Move> & moves)
+{
+	Board board = opening;
+	unsigned int i = 0;
+	for (std::list<Move>::const_iterator it = moves.begin();
+			it != moves.end();
+			it++) {
+		ASSERT(it->is_valid(board));
+		ASSERT(it->is_legal(board));
+
+		struct record rec;
+		rec.hashkey = board.get_hashkey();
+#ifdef HOICHESS
+		if (format == Book::FORMAT_POLYGLOT) {
+			rec.hashkey = Polyglot::key(board);
+		}
+#endif
+		rec.move = *it;
+		sorter.put(rec);
+
+		i++;
+		if (i > depth && depth > 0)
+			break;
+
+		board.make_move(*it);
+	}
+
+	games++;
+}
+
+/*
+ * Like add_game(), but the parser has already replayed the moves, so
+ * the hash keys are taken from the PGN. Polyglot keys are not, so those
+ * games are replayed again.
+ */
+void BookBuilder::consume(const PGN & pgn)
+{
+#ifdef HOICHESS
+	if (format == Book::FORMAT_POLYGLOT) {
+		add_game(pgn.get_opening(), pgn.get_moves());
+		return;
+	}
+#endif
+
+	const std::list<Move> & moves = pgn.get_moves();
+	const std::vector<Hashkey> & hashkeys = pgn.get_hashkeys();
+	ASSERT(hashkeys.size() == moves.size());
+
+	unsigned int i = 0;
+	for (std::list<Move>::const_iterator it = moves.begin();
+			it != moves.end();
+			it++) {
+		struct record rec;
+		rec.hashkey = hashkeys[i];
+		rec.move = *it;
+		sorter.put(rec);
+
+		i++;
+		if (i > depth && depth > 0)
+			break;
+	}
+
+	games++;
+}
+
+/*
+ * Merge all records, group the moves of each position, and write the
+ * moves that are kept to fp as BookRecords, in hash key order and by
+ * count within a position. Returns the number of records and stores
+ * the number of positions with at least one move in *nr_entries.
+ * Identical moves of a position are adjacent in the sorted records, so
+ * they are counted on the fly.
+ */
+unsigned long BookBuilder::write_entries(FILE * fp, unsigned long * nr_entries)
+{
+	sorter.finish();
+
+	unsigned long positions = 0;
+	unsigned long nr_records = 0;
+	*nr_entries = 0;
+
+	std::vector<std::pair<Move, unsigned int> > counts;
+	struct record rec;
+	bool more = sorter.get(&rec);
+	while (more) {
+		const Hashkey hashkey = rec.hashkey;
+		counts.clear();
+		do {
+			if (counts.empty() || counts.back().first != rec.move) {
+				counts.push_back(std::pair<Move, unsigned int>(
+							rec.move, 0));
+			}
+			counts.back().second++;
+			more = sorter.get(&rec);
+		} while (more && rec.hashkey == hashkey);
+		positions++;
+
+		BookEntry entry(hashkey, Book::select_moves(counts,
+					min_move_count));
+		if (entry.is_empty()) {
+			continue;
+		}
+		for (unsigned int i=0; i<entry.nr_moves(); i++) {
+			BookRecord record(hashkey, entry.moves[i]);
+			if (fwrite(&record, sizeof(record), 1, fp) != 1) {
+				perror("BookBuilder: fwrite() failed");
+				exit(EXIT_FAILURE);
+			}
+		}
+		nr_records += entry.nr_moves();
+		(*nr_entries)++;
+	}
+
+	/* Free the buffer and the runs before the book is written. */
+	sorter.clear();
+
+	printf("Total number of different positions in games: %lu\n",
+			positions);
+	printf("Average number of moves per position: %.2f\n",
+			*nr_entries ? (float) nr_records / *nr_entries : 0.0);
+
+	return nr_records;
+}
+
+/*
+ * Read the records of the next position, which are adjacent in fp, into
+ * entry. *next is the first record of the position and is replaced by
+ * the first record of the following one. Returns false if there are no
+ * more records.
+ */
+bool BookBuilder::read_entry(FILE * fp, BookRecord * next, bool * more,
+		BookEntry * entry)
+{
+	if (!*more) {
+		return false;
+	}
+
+	*entry = BookEntry();
+	entry->hashkey = next->hashkey;
+	do {
+		entry->moves.push_back(next->to_move());
+		if (fread(next, sizeof(*next), 1, fp) != 1) {
+			if (ferror(fp)) {
+				perror("BookBuilder: fread() failed");
+				exit(EXIT_FAILURE);
+			}
+			*more = false;
+		}
+	} while (*more && next->hashkey == entry->hashkey);
+
+	return true;
+}
+
+/*
+ * Lay out the hash table of the book. The records are grouped into
+ * slots, and each slot is placed with the same probe sequence as
+ * Book::put(), using a bitmap of occupied slots, which takes one bit per
+ * slot. The placed slots are sorted by number and then written in
+ * order, with empty slots in the gaps.
+ */
+bool BookBuilder::write_table(FILE * records, unsigned long nr_entries,
+		const char * bookfile)
+{
+	/* Add some extra space to reduce hash collisions. Book::hashfunc()
+	 * needs at least two slots. */
+	unsigned long size = (unsigned long) (nr_entries * 1.1);
+	if (size < 2) {
+		size = 2;
+	}
+	printf("Creating opening book with %lu entries.\n", size);
+
+	ExternalSort<struct placed_slot, placed_slot_less> slots(memory);
+	std::vector<bool> used(size);
+	unsigned long written = 0, collisions = 0;
+
+	rewind(records);
+	BookRecord next;
+	bool more = (fread(&next, sizeof(next), 1, records) == 1);
+	BookEntry group;
+	while (read_entry(records, &next, &more, &group)) {
+		struct placed_slot ps;
+		ps.entry = BookSlot(group);
+
+		/* same probe sequence as Book::put(), there are no
+		 * duplicate keys */
+		unsigned int i;
+		for (i=0; i<size; i++) {
+			ps.slot = Book::hashfunc(ps.entry.hashkey, i, size);
+			if (!used[ps.slot]) {
+				used[ps.slot] = true;
+				break;
+			}
+		}
+		if (i < size) {
+			slots.put(ps);
+			written++;
+		} else {
+			collisions++;
+		}
+	}
+	std::vector<bool>().swap(used);
+	slots.finish();
+
+	FILE * fp = fopen(bookfile, "wb");
+	if (!fp) {
+		printf("Cannot open %s for writing: %s\n",
+				bookfile, strerror(errno));
+		return false;
+	}
+
+	BookHeader header;
+	header.size = size;
+	if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+		printf("Cannot write %s: %s\n", bookfile, strerror(errno));
+		fclose(fp);
+		return false;
+	}
+
+	const BookSlot empty = BookSlot::h2b(BookSlot(), false);
+	struct placed_slot ps;
+	bool have = slots.get(&ps);
+	for (unsigned long s = 0; s < size; s++) {
+		BookSlot entry = empty;
+		if (have && ps.slot == s) {
+			entry = BookSlot::h2b(ps.entry, false);
+			have = slots.get(&ps);
+		}
+		if (fwrite(&entry, sizeof(entry), 1, fp) != 1) {
+			printf("Cannot write %s: %s\n",
+					bookfile, strerror(errno));
+			fclose(fp);
+			return false;
+		}
+	}
+
+	if (fclose(fp) != 0) {
+		printf("Cannot write %s: %s\n", bookfile, strerror(errno));
+		return false;
+	}
+
+	printf("%lu entries written, %lu irresolvable collisions\n",
+			written, collisions);
+	return true;
+}
+
+/*
+ * Write the records, which are already in hash key order, as a book
+ * with sorted layout.
+ */
+bool BookBuilder::write_sorted(FILE * records, unsigned long nr_records,
+		const char * bookfile)
+{
+	printf("Creating sorted opening book with %lu records.\n",
+			nr_records);
+
+	FILE * fp = fopen(bookfile, "wb");
+	if (!fp) {
+		printf("Cannot open %s for writing: %s\n",
+				bookfile, strerror(errno));
+		return false;
+	}
+
+	BookHeader header;
+	header.size = nr_records;
+	header.magic = BookHeader::s_magic_sorted;
+	if (fwrite(&header, sizeof(header), 1, fp) != 1) {
+		printf("Cannot write %s: %s\n", bookfile, strerror(errno));
+		fclose(fp);
+		return false;
+	}
+
+	rewind(records);
+	BookRecord record;
+	for (unsigned long n = 0; n < nr_records; n++) {
+		if (fread(&record, sizeof(record), 1, records) != 1) {
+			perror("BookBuilder: fread() failed");
+			exit(EXIT_FAILURE);
+		}
+		record = BookRecord::h2b(record, false);
+		if (fwrite(&record, sizeof(record), 1, fp) != 1) {
+			printf("Cannot write %s: %s\n",
+					bookfile, strerror(errno));
+			fclose(fp);
+			return false;
+		}
+	}
+
+	if (fclose(fp) != 0) {
+		printf("Cannot write %s: %s\n", bookfile, strerror(errno));
+		return false;
+	}
+
+	printf("%lu records written\n", nr_records);
+	return true;
+}
+
+#ifdef HOICHESS
+/*
+ * Write the records, which are already in key order, as a Polyglot
+ * book. The move counts become the weights, scaled down if they do
+ * not fit into 16 bits.
+ */
+bool BookBuilder::write_polyglot(FILE * records, unsigned long nr_records,
+		const char * bookfile)
+{
+	printf("Creating Polyglot opening book.\n");
+
+	FILE * fp = fopen(bookfile, "wb");
+	if (!fp) {
+		printf("Cannot open %s for writing: %s\n",
+				bookfile, strerror(errno));
+		return false;
+	}
+
+	rewind(records);
+	BookRecord record;
+	Hashkey hashkey = NULLHASHKEY;
+	uint32_t max_count = 0;
+	for (unsigned long n = 0; n < nr_records; n++) {
+		if (fread(&record, sizeof(record), 1, records) != 1) {
+			perror("BookBuilder: fread() failed");
+			exit(EXIT_FAILURE);
+		}
+
+		/* moves are sorted by count, descending */
+		if (n == 0 || record.hashkey != hashkey) {
+			hashkey = record.hashkey;
+			max_count = record.count;
+		}
+
+		PolyglotEntry pe;
+		pe.key = record.hashkey;
+		pe.move = Polyglot::encode_move(record.move);
+		pe.weight = record.count;
+		if (max_count > 0xffff) {
+			pe.weight = MAX(1, (unsigned long long)
+					record.count * 0xffff / max_count);
+		}
+		pe.learn = 0;
+
+		unsigned char buf[Polyglot::ENTRY_SIZE];
+		Polyglot::pack(pe, buf);
+		if (fwrite(buf, sizeof(buf), 1, fp) != 1) {
+			printf("Cannot write %s: %s\n",
+					bookfile, strerror(errno));
+			fclose(fp);
+			return false;
+		}
+	}
+
+	if (fclose(fp) != 0) {
+		printf("Cannot write %s: %s\n", bookfile, strerror(errno));
+		return false;
+	}
+
+	printf("%lu entries written\n", nr_records);
+	return true;
+}
+#endif
+
+/*
+ * Write the book from all games added so far.
+ */
+bool BookBuilder::write(const char * bookfile)
+{
+	printf("Sorting %llu moves in %lu run%s...\n", sorter.size(),
+			(unsigned long) sorter.nr_runs(),
+			(sorter.nr_runs() == 1) ? "" : "s");
+	fflush(stdout);
+
+	FILE * records = tmpfile();
+	if (!records) {
+		perror("BookBuilder: tmpfile() failed");
+		exit(EXIT_FAILURE);
+	}
+
+	unsigned long nr_entries;
+	const unsigned long nr_records = write_entries(records, &nr_entries);
+	printf("Opening book will contain %lu positions.\n", nr_entries);
+
+	bool ret;
+	switch (format) {
+	case Book::FORMAT_SORTED:
+		ret = write_sorted(records, nr_records, bookfile);
+		break;
+#ifdef HOICHESS
+	case Book::FORMAT_POLYGLOT:
+		ret = write_polyglot(records, nr_records, bookfile);
+		break;
+#endif
+	default:
+		ret = write_table(records, nr_entries, bookfile);
+		break;
+	}
+	fclose(records);
+	return ret;
+}
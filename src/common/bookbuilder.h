@@ -0,0 +1,129 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef BOOKBUILDER_H
+#define BOOKBUILDER_H
+
+#include "common.h"
+#include "board.h"
+#include "book.h"
+#include "extsort.h"
+#include "move.h"
+#include "pgnpipeline.h"
+
+#include <stdio.h>
+
+#include <list>
+#include <vector>
+
+
+/*
+ * Builds an opening book with bounded memory.
+ *
+ * add_game() emits one (hash key, move) record per book move into an
+ * ExternalSort. write() reads them back in order, counts the moves of
+ * each position like Book::group_moves(), and lays out the hash table of
+ * the book: the slot of each position is computed in one pass, exactly
+ * like a sequence of Book::put() calls in hash key order would do, and
+ * the slots are sorted by number with another ExternalSort and written
+ * sequentially. So the result is the same as that of the old builder.
+ *
+ * With the sorted layout, one record per move is written in hash key
+ * order without empty slots instead, see Book::find_sorted(), so there
+ * is no limit on the number of moves of a position. A Polyglot book is
+ * keyed by Polyglot::key() and gets one entry per move as well.
+ *
+ * As a PGNConsumer, it takes the games read by a PGNPipeline.
+ */
+class BookBuilder : public PGNConsumer {
+      public:
+	/* default for the memory argument of the constructor */
+	static const size_t DEFAULT_MEMORY = 64 * 1024 * 1024;
+
+      private:
+	struct record {
+		Hashkey hashkey;
+		Move move;
+	};
+
+	class record_less {
+	      public:
+		inline bool operator()(const struct record & a,
+				const struct record & b) const
+		{
+			if (a.hashkey != b.hashkey) {
+				return a.hashkey < b.hashkey;
+			}
+			return Move::strict_weak_ordering()(a.move, b.move);
+		}
+	};
+
+	/* a slot of the hash table together with its number */
+	struct placed_slot {
+		unsigned long slot;
+		BookSlot entry;
+	};
+
+	class placed_slot_less {
+	      public:
+		inline bool operator()(const struct placed_slot & a,
+				const struct placed_slot & b) const
+		{
+			return a.slot < b.slot;
+		}
+	};
+
+      private:
+	unsigned int depth;
+	unsigned int min_move_count;
+	size_t memory;
+	Book::Format format;
+
+	ExternalSort<struct record, record_less> sorter;
+
+	/* statistics */
+	unsigned long games;
+
+      public:
+	BookBuilder(unsigned int depth, unsigned int min_move_count,
+			size_t memory = DEFAULT_MEMORY,
+			Book::Format format = Book::FORMAT_HASH);
+
+      public:
+	void add_game(const Board & opening, const std::list<Move> & moves);
+	virtual void consume(const PGN & pgn);
+	bool write(const char * bookfile);
+
+	unsigned long get_games() const
+	{ return games; }
+
+      private:
+	unsigned long write_entries(FILE * fp, unsigned long * nr_entries);
+	static bool read_entry(FILE * fp, BookRecord * next, bool * more,
+			BookEntry * entry);
+	bool write_table(FILE * records, unsigned long nr_entries,
+			const char * bookfile);
+	bool write_sorted(FILE * records, unsigned long nr_records,
+			const char * bookfile);
+#ifdef HOICHESS
+	bool write_polyglot(FILE * records, unsigned long nr_records,
+			const char * bookfile);
+#endif
+};
+
+#endif // BOOKBUILDER_H
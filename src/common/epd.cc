@@ -20,6 +20,7 @@
 #include "common.h"
 #include "epd.h"
 #include "game.h"
+#include "moveparser.h"
 #include "util.h"
 
 #include <errno.h>
@@ -101,25 +102,37 @@ std::string EPD::get1(const std::string & opcode) const
 }
 
 /*
- * Get a list of all operands for an the 'bm' opcode converted to Moves.
+ * Get a list of all operands for the 'bm' or 'am' opcode converted to
+ * Moves.
  */
 std::list<Move> EPD::get_bm() const
 {
-	std::list<std::string> bms_str = get("bm");
+	return get_moves("bm");
+}
+
+std::list<Move> EPD::get_am() const
+{
+	return get_moves("am");
+}
+
+std::list<Move> EPD::get_moves(const std::string & opcode) const
+{
+	std::list<std::string> moves_str = get(opcode);
 	Board board(get_fen().c_str());
-	std::list<Move> bms;
+	std::list<Move> moves;
 
-	for (std::list<std::string>::iterator it = bms_str.begin();
-			it != bms_str.end(); it++) {
-		Move m = board.parse_move(*it);
+	for (std::list<std::string>::iterator it = moves_str.begin();
+			it != moves_str.end(); it++) {
+		Move m = MoveParser::parse(board, *it);
 		if (!m) {
-			WARN("get_bm(): illegal move: %s", it->c_str());
+			WARN("get_%s(): illegal move: %s", opcode.c_str(),
+					it->c_str());
 			continue;
 		}
-		bms.push_back(m);
+		moves.push_back(m);
 	}
 
-	return bms;
+	return moves;
 }
 
 
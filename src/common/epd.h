@@ -44,8 +44,10 @@ class EPD {
 	std::list<std::string> get(const std::string & opcode) const;
 	std::string get1(const std::string & opcode) const;
 	std::list<Move> get_bm() const;
+	std::list<Move> get_am() const;
 
       private:
+	std::list<Move> get_moves(const std::string & opcode) const;
 	void parse(const char * p);
 	const char * parse_operand(const char * p, const std::string & opcode);
 	const char * parse_opcode(const char * p);
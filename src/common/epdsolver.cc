@@ -0,0 +1,499 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "epdsolver.h"
+#include "epd.h"
+#ifdef WITH_THREAD
+# include "parallelsearch.h"
+# include "queue.h"
+# include "thread.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <map>
+
+
+#ifdef WITH_THREAD
+struct EPDSolver::queues {
+	Queue<struct position *> todo;	/* NULL tells a worker to quit */
+	Queue<struct position *> done;
+};
+#endif
+
+/*
+ * Solve the positions one after another with search, which is not
+ * deleted. Its thinking output is printed as usual.
+ */
+EPDSolver::EPDSolver(Search * search, const Clock & clock,
+		unsigned int maxdepth)
+{
+	njobs = 1;
+	nthreads = 1;
+	own_searches = false;
+	construct(clock, maxdepth);
+
+	struct job * job = new struct job;
+	job->solver = this;
+	job->search = search;
+	job->search->set_result_log(&job->log, false);
+	jobs.push_back(job);
+}
+
+EPDSolver::EPDSolver(Shell * shell, unsigned int njobs,
+		unsigned int nthreads, size_t hashsize, size_t pawnhashsize,
+		size_t evalcachesize, const Clock & clock,
+		unsigned int maxdepth)
+{
+#ifndef WITH_THREAD
+	njobs = 1;
+	nthreads = 1;
+#endif
+	if (njobs == 0) {
+		njobs = 1;
+	}
+	if (nthreads == 0) {
+		nthreads = 1;
+	}
+	this->njobs = njobs;
+	this->nthreads = nthreads;
+	own_searches = true;
+	construct(clock, maxdepth);
+
+	for (unsigned int j=0; j<njobs; j++) {
+		struct job * job = new struct job;
+		job->solver = this;
+#ifdef WITH_THREAD
+		if (nthreads > 1) {
+			job->search = new ParallelSearch(shell, nthreads);
+		} else
+#endif
+		{
+			job->search = new Search(shell);
+		}
+		job->search->set_hash_size(hashsize / njobs);
+		job->search->set_pawnhash_size(pawnhashsize / njobs);
+		job->search->set_evalcache_size(evalcachesize / njobs);
+		job->search->set_result_log(&job->log);
+		jobs.push_back(job);
+	}
+}
+
+void EPDSolver::construct(const Clock & clock, unsigned int maxdepth)
+{
+	this->clock = clock;
+	this->maxdepth = maxdepth;
+	q = NULL;
+	stop = false;
+
+	right = 0;
+	wrong = 0;
+	skipped = 0;
+	found = 0;
+	stable = 0;
+	found_csecs = 0;
+	stable_csecs = 0;
+	search_csecs = 0;
+	search_nodes = 0;
+}
+
+EPDSolver::~EPDSolver()
+{
+	for (size_t j=0; j<jobs.size(); j++) {
+		if (own_searches) {
+			delete jobs[j]->search;
+		} else {
+			jobs[j]->search->set_result_log(NULL);
+		}
+		delete jobs[j];
+	}
+}
+
+/*
+ * Stop all searches. The positions that are not started yet are not
+ * searched anymore.
+ */
+void EPDSolver::interrupt()
+{
+	stop = true;
+	for (size_t j=0; j<jobs.size(); j++) {
+		jobs[j]->search->interrupt();
+	}
+}
+
+/*
+ * Solve all positions in fp, up to the end of the file or a line
+ * containing only ".", and print the results.
+ */
+void EPDSolver::run(FILE * fp)
+{
+	if (njobs > 1) {
+		printf("Solving with %u jobs, %u thread%s each\n", njobs,
+				nthreads, (nthreads == 1) ? "" : "s");
+	}
+
+	struct timeval tv_start, tv_end;
+	gettimeofday(&tv_start, NULL);
+
+#ifdef WITH_THREAD
+	struct queues queues;
+	std::vector<Thread *> threads;
+	if (njobs > 1) {
+		q = &queues;
+		for (unsigned int j=0; j<njobs; j++) {
+			Thread * thread = new Thread(worker_main);
+			thread->start(jobs[j]);
+			threads.push_back(thread);
+		}
+	}
+#endif
+
+	/* Positions finished out of order wait here. A position counts
+	 * as in flight from reading until it has been reported, so the
+	 * pending ones are bounded as well; queued counts those given to
+	 * the jobs and not yet returned. */
+	std::map<unsigned long, struct position *> pending;
+	unsigned long next_seq = 0, next_report = 0;
+	unsigned int in_flight = 0;
+	const unsigned int max_in_flight = 2 * njobs;
+#ifdef WITH_THREAD
+	unsigned int queued = 0;
+#endif
+	bool more = true;
+
+	for (;;) {
+		while (more && !stop && in_flight < max_in_flight) {
+			struct position * pos = read_position(fp, next_seq);
+			if (!pos) {
+				more = false;
+				break;
+			}
+			next_seq++;
+#ifdef WITH_THREAD
+			if (q) {
+				in_flight++;
+				if (pos->bms.empty() && pos->ams.empty()) {
+					pending[pos->seq] = pos;
+				} else {
+					queued++;
+					q->todo.put(pos);
+				}
+				continue;
+			}
+#endif
+			/* Only one job: solve it right here, so that the
+			 * thinking output follows the position. */
+			print_position(pos);
+			if (!pos->bms.empty() || !pos->ams.empty()) {
+				printf("\n");
+				pos->board.print_small();
+				printf("\n");
+				printf("Thinking...\n");
+				solve(jobs[0], pos);
+			}
+			report(pos);
+			delete pos;
+			next_report++;
+		}
+
+		std::map<unsigned long, struct position *>::iterator it;
+		while ((it = pending.find(next_report)) != pending.end()) {
+			print_position(it->second);
+			report(it->second);
+			delete it->second;
+			pending.erase(it);
+			next_report++;
+			in_flight--;
+		}
+
+		if (in_flight == 0 && (!more || stop)) {
+			break;
+		}
+#ifdef WITH_THREAD
+		if (queued > 0) {
+			struct position * pos = q->done.get();
+			queued--;
+			pending[pos->seq] = pos;
+		}
+#endif
+	}
+	ASSERT(pending.empty());
+
+#ifdef WITH_THREAD
+	for (size_t j=0; j<threads.size(); j++) {
+		q->todo.put(NULL);
+	}
+	for (size_t j=0; j<threads.size(); j++) {
+		threads[j]->wait();
+		delete threads[j];
+	}
+	q = NULL;
+#endif
+
+	gettimeofday(&tv_end, NULL);
+	const unsigned long wall_csecs = (tv_end.tv_sec - tv_start.tv_sec)
+		* 100 + (tv_end.tv_usec - tv_start.tv_usec) / 10000;
+	const unsigned int total = right + wrong;
+
+	printf("==================================================\n");
+	printf("Correct: %u of %u, skipped: %u\n", right, total, skipped);
+	if (found > 0) {
+		printf("Solution first found in %u positions,"
+				" after %.2f s on average\n", found,
+				(double) found_csecs / found / 100);
+	}
+	if (stable > 0) {
+		printf("Solution stable in %u positions,"
+				" after %.2f s on average\n", stable,
+				(double) stable_csecs / stable / 100);
+	}
+	printf("Wall time: %.1f s, search time: %.1f s (%.1fx),"
+			" %llu nodes\n",
+			wall_csecs / 100.0, search_csecs / 100.0,
+			wall_csecs > 0 ? (double) search_csecs / wall_csecs
+			: 0.0, search_nodes);
+
+	/* total right skipped found stable found_csecs stable_csecs
+	 * search_csecs search_nodes wall_csecs */
+	printf("SOLVE_SUMMARY %u %u %u %u %u %llu %llu %llu %llu %lu\n",
+			total, right, skipped, found, stable,
+			found_csecs, stable_csecs, search_csecs,
+			search_nodes, wall_csecs);
+	printf("SOLVE_DONE %u %u\n", total, right);
+}
+
+/*
+ * Read the next position. Returns NULL at the end of the input.
+ */
+struct EPDSolver::position * EPDSolver::read_position(FILE * fp,
+		unsigned long seq)
+{
+	char buf[1024];
+	if (fgets(buf, sizeof(buf), fp) == NULL) {
+		return NULL;
+	}
+
+	/* Strip trailing \n and \r */
+	size_t len = strlen(buf);
+	while (len > 0 && (buf[len-1] == '\n' || buf[len-1] == '\r')) {
+		buf[--len] = '\0';
+	}
+	if (strcmp(buf, ".") == 0) {
+		return NULL;
+	}
+
+	EPD epd(buf);
+	struct position * pos = new struct position;
+	pos->seq = seq;
+	pos->id = epd.get1("id");
+	pos->fen = epd.get_fen();
+	pos->board = Board(pos->fen.c_str());
+	pos->bms = epd.get_bm();
+	pos->ams = epd.get_am();
+	pos->searched = false;
+	pos->mov = NO_MOVE;
+	pos->correct = false;
+	pos->depth = 0;
+	pos->csecs = 0;
+	pos->nodes = 0;
+	pos->found.csecs = -1;
+	pos->found.nodes = 0;
+	pos->found.depth = 0;
+	pos->stable = pos->found;
+	return pos;
+}
+
+/*
+ * Search a position with the Search of job. The first and the stable
+ * solution are taken from the completed iterations in the log.
+ */
+void EPDSolver::solve(struct job * job, struct position * pos)
+{
+	if (stop) {
+		return;
+	}
+
+	Search * search = job->search;
+	search->clear_hash();
+	search->clear_pawnhash();
+	search->clear_evalcache();
+	search->clear_history();
+	search->set_solution(pos->bms, pos->ams);
+	job->log.clear();
+
+	/* Like the solve command, every search gets a fresh copy of the
+	 * clock. */
+	Clock c = clock;
+	c.stop();
+	c.turn_back();
+	c.start();
+
+	pos->mov = search->start(pos->board, c, Search::MOVE, maxdepth);
+	pos->searched = true;
+	pos->csecs = Clock::to_cs(c.get_elapsed_time());
+	pos->nodes = search->get_nodes_fullwidth()
+		+ search->get_nodes_quiesce();
+
+	for (size_t i=0; i<job->log.size(); i++) {
+		const struct Search::searchresult & sr = job->log[i];
+		if (sr.type != Search::searchresult::DEPTH) {
+			continue;
+		}
+		pos->depth = sr.depth;
+
+		struct milestone m;
+		m.csecs = sr.csecs;
+		m.nodes = sr.nodes_total;
+		m.depth = sr.depth;
+		if (!search->is_solution(sr.best)) {
+			pos->stable.csecs = -1;
+			continue;
+		}
+		if (pos->found.csecs < 0) {
+			pos->found = m;
+		}
+		if (pos->stable.csecs < 0) {
+			pos->stable = m;
+		}
+	}
+
+	pos->correct = search->is_solution(pos->mov);
+	if (!pos->correct) {
+		pos->stable.csecs = -1;
+	}
+	search->set_solution(std::list<Move>(), std::list<Move>());
+}
+
+/*
+ * Print a position with its best moves and moves to avoid.
+ */
+void EPDSolver::print_position(const struct position * pos) const
+{
+	printf("--------------------------------------------------\n");
+	printf("[%s] %s\n", pos->id.c_str(), pos->fen.c_str());
+
+	if (pos->bms.empty() && pos->ams.empty()) {
+		printf("No best move associated to this position,"
+				" skipping.\n");
+		return;
+	}
+
+	if (!pos->bms.empty()) {
+		printf("[%s] best move:", pos->id.c_str());
+		for (std::list<Move>::const_iterator it = pos->bms.begin();
+				it != pos->bms.end(); it++) {
+			printf(" %s", it->san(pos->board).c_str());
+		}
+		printf("\n");
+	}
+	if (!pos->ams.empty()) {
+		printf("[%s] avoid move:", pos->id.c_str());
+		for (std::list<Move>::const_iterator it = pos->ams.begin();
+				it != pos->ams.end(); it++) {
+			printf(" %s", it->san(pos->board).c_str());
+		}
+		printf("\n");
+	}
+}
+
+/*
+ * Print the result of a position and add it to the statistics.
+ */
+void EPDSolver::report(const struct position * pos)
+{
+	if (pos->bms.empty() && pos->ams.empty()) {
+		skipped++;
+		return;
+	} else if (!pos->searched) {
+		printf("Not searched, excluding position from result\n");
+		return;
+	} else if (!pos->mov) {
+		printf("Warning: search returned NO_MOVE"
+				", excluding position from result\n");
+		return;
+	}
+
+	if (pos->correct) {
+		right++;
+	} else {
+		wrong++;
+	}
+	search_csecs += pos->csecs;
+	search_nodes += pos->nodes;
+
+	printf("My move: %s (%s), depth %u, %.2f s, %llu nodes\n",
+			pos->mov.san(pos->board).c_str(),
+			pos->correct ? "correct" : "incorrect",
+			pos->depth, pos->csecs / 100.0, pos->nodes);
+	if (pos->found.csecs >= 0) {
+		printf("First found at depth %u after %.2f s, %llu nodes\n",
+				pos->found.depth, pos->found.csecs / 100.0,
+				pos->found.nodes);
+		found++;
+		found_csecs += pos->found.csecs;
+	}
+	if (pos->stable.csecs >= 0) {
+		printf("Stable from depth %u after %.2f s, %llu nodes\n",
+				pos->stable.depth, pos->stable.csecs / 100.0,
+				pos->stable.nodes);
+		stable++;
+		stable_csecs += pos->stable.csecs;
+	}
+
+	const unsigned int total = right + wrong;
+	printf("Correct: %u of %u (%u%%), skipped: %u\n",
+			right, total, 100 * right / total, skipped);
+	printf("SOLVE %u %u %s %u %s\n",
+			total, right,
+			pos->mov.san(pos->board).c_str(), pos->correct,
+			pos->id.c_str());
+
+	/* correct, then depth, csecs and nodes of the whole search, up
+	 * to the first and up to the stable solution (-1 if none) */
+	printf("SOLVE_STATS %u %u %lu %llu", pos->correct,
+			pos->depth, pos->csecs, pos->nodes);
+	const struct milestone * ms[2] = { &pos->found, &pos->stable };
+	for (int i=0; i<2; i++) {
+		if (ms[i]->csecs >= 0) {
+			printf(" %u %ld %llu", ms[i]->depth, ms[i]->csecs,
+					ms[i]->nodes);
+		} else {
+			printf(" -1 -1 -1");
+		}
+	}
+	printf(" %s\n", pos->id.c_str());
+}
+
+#ifdef WITH_THREAD
+void * EPDSolver::worker_main(void * arg) /* static */
+{
+	struct job * job = (struct job *) arg;
+	EPDSolver * solver = job->solver;
+
+	struct position * pos;
+	while ((pos = solver->q->todo.get()) != NULL) {
+		solver->solve(job, pos);
+		solver->q->done.put(pos);
+	}
+	return arg;
+}
+#endif
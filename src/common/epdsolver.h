@@ -0,0 +1,140 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef EPDSOLVER_H
+#define EPDSOLVER_H
+
+#include "common.h"
+#include "board.h"
+#include "clock.h"
+#include "move.h"
+#include "search.h"
+
+#include <stdio.h>
+
+#include <list>
+#include <string>
+#include <vector>
+
+/* forward declarations */
+class Shell;
+
+
+/*
+ * Solves the positions of an EPD test suite.
+ *
+ * With one job, the positions are searched one after another by the
+ * given Search, with the usual thinking output. With several jobs, each
+ * job has its own Search, a ParallelSearch if it gets more than one
+ * thread, and its own share of the hash table, pawn hash table and
+ * evaluation cache, so the jobs do not interfere with each other. The
+ * calling thread reads the positions and hands them to the jobs through
+ * a queue, like PGNPipeline. The results are printed in input order as
+ * soon as all positions before them are done.
+ *
+ * A position is solved by a move that is one of its bm moves, if any,
+ * and none of its am moves, see Search::is_solution(). For each
+ * position, time, nodes and depth are reported up to the first
+ * iteration with a solution as best move, and up to the iteration from
+ * which on the best move stayed a solution. The option
+ * search_solve_stable_iterations ends the search early.
+ *
+ * Without thread support, there is only one job.
+ */
+class EPDSolver {
+      private:
+	/* time, nodes and depth at the end of an iteration */
+	struct milestone {
+		long csecs;		/* -1 if not reached */
+		unsigned long long nodes;
+		unsigned int depth;
+	};
+
+	struct position {
+		unsigned long seq;
+		std::string id;
+		std::string fen;
+		Board board;
+		std::list<Move> bms;
+		std::list<Move> ams;
+
+		/* result */
+		bool searched;
+		Move mov;
+		bool correct;
+		unsigned int depth;
+		unsigned long csecs;
+		unsigned long long nodes;
+		struct milestone found;		/* first solution */
+		struct milestone stable;	/* solution from here on */
+	};
+
+	struct job {
+		EPDSolver * solver;
+		Search * search;
+		std::vector<struct Search::searchresult> log;
+	};
+
+	struct queues;
+
+      private:
+	unsigned int njobs;
+	unsigned int nthreads;		/* per job */
+	bool own_searches;
+	std::vector<struct job *> jobs;
+	Clock clock;
+	unsigned int maxdepth;
+	struct queues * q;
+	volatile bool stop;
+
+	/* statistics */
+	unsigned int right;
+	unsigned int wrong;
+	unsigned int skipped;
+	unsigned int found;
+	unsigned int stable;
+	unsigned long long found_csecs;
+	unsigned long long stable_csecs;
+	unsigned long long search_csecs;
+	unsigned long long search_nodes;
+
+      public:
+	EPDSolver(Search * search, const Clock & clock,
+			unsigned int maxdepth);
+	EPDSolver(Shell * shell, unsigned int njobs, unsigned int nthreads,
+			size_t hashsize, size_t pawnhashsize,
+			size_t evalcachesize, const Clock & clock,
+			unsigned int maxdepth);
+	~EPDSolver();
+
+      private:
+	void construct(const Clock & clock, unsigned int maxdepth);
+
+      public:
+	void run(FILE * fp);
+	void interrupt();
+
+      private:
+	struct position * read_position(FILE * fp, unsigned long seq);
+	void solve(struct job * job, struct position * pos);
+	void print_position(const struct position * pos) const;
+	void report(const struct position * pos);
+	static void * worker_main(void * arg);
+};
+
+#endif // EPDSOLVER_H
@@ -21,18 +21,52 @@
 #include "eval.h"
 #include "board.h"
 
+#include <errno.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sstream>
+#include <vector>
+
+
+/*
+ * Cheap time stamp for profiling: the CPU's time stamp counter on x86,
+ * microseconds elsewhere.
+ */
+static inline unsigned long long get_ticks()
+{
+#if defined(__i386__) || defined(__x86_64__)
+	unsigned int lo, hi;
+	__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((unsigned long long) hi << 32) | lo;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (unsigned long long) tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
 
 Evaluator::Evaluator()
 {
 	pawnhashtable = NULL;
 	evalcache = NULL;
+	materialtable = new MaterialTable(MATERIALTABLE_SIZE);
+	material = NULL;
+	shared_pawnhashtable = false;
+	shared_evalcache = false;
+	profile = false;
 	reset_statistics();
 }
 
 Evaluator::~Evaluator()
 {
-	delete pawnhashtable;
-	delete evalcache;
+	if (!shared_pawnhashtable) {
+		delete pawnhashtable;
+	}
+	if (!shared_evalcache) {
+		delete evalcache;
+	}
+	delete materialtable;
 }
 
 
@@ -69,13 +103,23 @@ int Evaluator::eval(const Board & board, int alpha, int beta, Color _myside)
 
 	
 	/*
-	 * material 
+	 * material, looked up by the material signature, and piece-square
+	 * tables, both updated incrementally by class Board
 	 */
 	
-	score = material_balance(board.get_material(side),
-				 board.get_material(xside));
-	if (score >= beta + EVAL_CUTOFF_MATERIAL
-			|| score <= alpha - EVAL_CUTOFF_MATERIAL) {
+	probe_material(board);
+	if (material->endgame) {
+		stat_endgame_evals++;
+		score = material->endgame(board, material->strong);
+		return (side == material->strong) ? score : -score;
+	}
+
+	score = material->get_imbalance(side)
+		+ taper(psq_score(board, side) - psq_score(board, xside));
+	if (material->is_normal()
+			&& (score >= beta + EVAL_CUTOFF_MATERIAL
+				|| score <= alpha - EVAL_CUTOFF_MATERIAL)) {
+		stat_lazy_cutoffs++;
 		return score;
 	}
 	
@@ -84,11 +128,21 @@ int Evaluator::eval(const Board & board, int alpha, int beta, Color _myside)
 	 * do normal evaluation 
 	 */
 	
-	if (evalcache && evalcache->probe(board, &score)) {
-		return score;
+	if (evalcache) {
+		stat_evalcache_probes++;
+		if (evalcache->probe(board, &score)) {
+			stat_evalcache_hits++;
+			return score;
+		}
 	}
 	
-	setup(&board);
+	if (profile) {
+		const unsigned long long t = get_ticks();
+		setup(&board);
+		prof_ticks_setup += get_ticks() - t;
+	} else {
+		setup(&board);
+	}
 
 	
 	/*
@@ -97,17 +151,14 @@ int Evaluator::eval(const Board & board, int alpha, int beta, Color _myside)
 	{
 		stat_evals_phase1++;
 		
-		/* call plugins */
-		int score1 = 0;
-		for (int i=0; plugins[i].name != NULL; i++) {
-			ASSERT_DEBUG(plugins[i].func != NULL);
-			score1 += (this->*plugins[i].func)(side)
-				- (this->*plugins[i].func)(xside);
-		}
+		/* call plugins, sum up midgame/endgame pairs and
+		 * interpolate once */
+		const int score1 = taper(call_plugins(plugins, 0, side));
 		score += score1;
 #ifdef EVAL_CUTOFF_PHASE1
 		if (score1 > EVAL_CUTOFF_PHASE1
 				|| score1 < -EVAL_CUTOFF_PHASE1) {
+			stat_phase1_cutoffs++;
 			goto done;
 		}
 #endif
@@ -121,13 +172,7 @@ int Evaluator::eval(const Board & board, int alpha, int beta, Color _myside)
 		stat_evals_phase2++;
 
 		/* call plugins2 */
-		int score2 = 0;
-		for (int i=0; plugins2[i].name != NULL; i++) {
-			ASSERT_DEBUG(plugins2[i].func != NULL);
-			score2 += (this->*plugins2[i].func)(side)
-				- (this->*plugins2[i].func)(xside);
-		}
-		score += score2;
+		score += taper(call_plugins(plugins2, 1, side));
 	}
 #endif
 
@@ -138,6 +183,10 @@ int Evaluator::eval(const Board & board, int alpha, int beta, Color _myside)
 done:
 	finish();
 
+	if (!material->is_normal()) {
+		score = material->scale_score(score, side);
+	}
+
 	if (evalcache) {
 		evalcache->put(board, score);
 	}
@@ -145,9 +194,88 @@ done:
 	return score;
 }
 
+/*
+ * Call all plugins of one stage (0 for plugins[], 1 for plugins2[]) for
+ * side and its opponent, and return the sum of the packed scores.
+ */
+int Evaluator::call_plugins(const struct score_plugin * p,
+		unsigned int stage, Color side)
+{
+	const Color xside = XSIDE(side);
+	int packed = 0;
+
+	if (!profile) {
+		for (int i=0; p[i].name != NULL; i++) {
+			ASSERT_DEBUG(p[i].func[side] != NULL);
+			packed += (this->*p[i].func[side])()
+				- (this->*p[i].func[xside])();
+		}
+		return packed;
+	}
+
+	const unsigned long long t0 = get_ticks();
+	unsigned long long t = t0;
+	for (int i=0; p[i].name != NULL; i++) {
+		ASSERT_DEBUG(p[i].func[side] != NULL);
+		ASSERT_DEBUG(i < MAX_PLUGINS);
+		packed += (this->*p[i].func[side])()
+			- (this->*p[i].func[xside])();
+
+		const unsigned long long t1 = get_ticks();
+		prof_calls[stage][i]++;
+		prof_ticks[stage][i] += t1 - t;
+		t = t1;
+	}
+	prof_ticks_phase[stage] += t - t0;
+
+	return packed;
+}
+
+/*
+ * Look up the material table entry of the board, computing it if
+ * necessary, and set phase and phase weight from it.
+ */
+void Evaluator::probe_material(const Board & board)
+{
+	const Hashkey key = board.get_materialkey();
+	bool found;
+
+	MaterialEntry * e = materialtable->lookup(key, &found);
+	stat_material_probes++;
+	if (found) {
+		stat_material_hits++;
+	} else {
+		compute_material(key, e);
+	}
+
+	material = e;
+	phase = e->phase;
+	phase_weight = e->phase_weight;
+}
+
+/*
+ * Piece-square score of side as a midgame/endgame pair.
+ */
+int Evaluator::psq_score(const Board & board, Color side)
+{
+	return SCORE(board.psq_mg[side], board.psq_eg[side]);
+}
+
+/*
+ * Interpolate a midgame/endgame pair by the phase weight of the
+ * current position.
+ */
+int Evaluator::taper(int score) const
+{
+	return (SCORE_MG(score) * phase_weight
+			+ SCORE_EG(score) * (PHASE_WEIGHT_MAX - phase_weight))
+		/ PHASE_WEIGHT_MAX;
+}
+
 void Evaluator::print_eval(const Board & board, Color _myside, FILE * fp)
 {
 	myside = _myside;
+	probe_material(board);
 	setup(&board);
 	
 #if 0
@@ -171,19 +299,26 @@ void Evaluator::print_eval(const Board & board, Color _myside, FILE * fp)
 	fprintf(fp, INFO_PRFX "eval_material_difference=%d\n",
 			board.material[WHITE] - board.material[BLACK]);
 	fprintf(fp, INFO_PRFX "eval_material_balance=%d\n",
-			 material_balance(board.material[WHITE],
-				 	  board.material[BLACK]));
-	fprintf(fp, INFO_PRFX "eval_phase=%u eval_isdraw=%d\n",
-			phase, is_draw(board));
+			material->get_imbalance(WHITE));
+	fprintf(fp, INFO_PRFX "eval_scale_white=%d eval_scale_black=%d"
+				" eval_endgame=%d\n",
+			material->scale[WHITE], material->scale[BLACK],
+			material->endgame != NULL);
+	fprintf(fp, INFO_PRFX "eval_phase=%u eval_phase_weight=%d"
+				" eval_isdraw=%d\n",
+			phase, phase_weight, is_draw(board));
+	fprintf(fp, INFO_PRFX "eval_psq_white=%d eval_psq_black=%d\n",
+			taper(psq_score(board, WHITE)),
+			taper(psq_score(board, BLACK)));
 #endif
 
 #if 0
 	fprintf(fp, "scoring plugins:\n");
 #endif
 	for (int i=0; plugins[i].name != NULL; i++) {
-		ASSERT(plugins[i].func != NULL);
-		int score_white = (this->*plugins[i].func)(WHITE);
-		int score_black = (this->*plugins[i].func)(BLACK);
+		ASSERT(plugins[i].func[WHITE] != NULL);
+		int score_white = taper((this->*plugins[i].func[WHITE])());
+		int score_black = taper((this->*plugins[i].func[BLACK])());
 
 #if 0
 		fprintf(fp, "\t%s: %d/%d\n", plugins[i].name,
@@ -199,9 +334,9 @@ void Evaluator::print_eval(const Board & board, Color _myside, FILE * fp)
 	fprintf(fp, "scoring plugins2:\n");
 #endif
 	for (int i=0; plugins2[i].name != NULL; i++) {
-		ASSERT(plugins2[i].func != NULL);
-		int score_white = (this->*plugins2[i].func)(WHITE);
-		int score_black = (this->*plugins2[i].func)(BLACK);
+		ASSERT(plugins2[i].func[WHITE] != NULL);
+		int score_white = taper((this->*plugins2[i].func[WHITE])());
+		int score_black = taper((this->*plugins2[i].func[BLACK])());
 
 #if 0
 		fprintf(fp, "\t%s: %d/%d\n", plugins2[i].name,
@@ -228,13 +363,23 @@ void Evaluator::reset_statistics()
 	stat_evals = 0;
 	stat_evals_phase1 = 0;
 	stat_evals_phase2 = 0;
-
-	if (pawnhashtable) {
-		pawnhashtable->reset_statistics();
-	}
-	
-	if (evalcache) {
-		evalcache->reset_statistics();
+	stat_pawnhash_probes = 0;
+	stat_pawnhash_hits = 0;
+	stat_evalcache_probes = 0;
+	stat_evalcache_hits = 0;
+	stat_material_probes = 0;
+	stat_material_hits = 0;
+	stat_endgame_evals = 0;
+	stat_lazy_cutoffs = 0;
+	stat_phase1_cutoffs = 0;
+
+	prof_ticks_setup = 0;
+	for (unsigned int stage = 0; stage < 2; stage++) {
+		prof_ticks_phase[stage] = 0;
+		for (unsigned int i = 0; i < MAX_PLUGINS; i++) {
+			prof_calls[stage][i] = 0;
+			prof_ticks[stage][i] = 0;
+		}
 	}
 }
 
@@ -248,26 +393,133 @@ void Evaluator::print_statistics(FILE * fp) const
 			stat_evals, stat_evals_phase1, stat_evals_phase2);
 #endif
 
+	/* Probes and hits are counted here rather than in the tables,
+	 * because a table may be shared by several threads. */
 	if (pawnhashtable) {
-		pawnhashtable->print_statistics(fp);
+		fprintf(fp, INFO_PRFX "pawnhash_probes=%lu pawnhash_hits=%lu"
+					" pawnhash_shared=%d\n",
+				stat_pawnhash_probes, stat_pawnhash_hits,
+				shared_pawnhashtable);
 	}
 	
 	if (evalcache) {
-		evalcache->print_statistics(fp);
+		fprintf(fp, INFO_PRFX "evalcache_probes=%lu evalcache_hits=%lu"
+					" evalcache_shared=%d\n",
+				stat_evalcache_probes, stat_evalcache_hits,
+				shared_evalcache);
 	}
+
+	fprintf(fp, INFO_PRFX "materialtable_probes=%lu materialtable_hits=%lu"
+				" endgame_evals=%lu\n",
+			stat_material_probes, stat_material_hits,
+			stat_endgame_evals);
+
+	print_profile(fp);
+}
+
+/*
+ * Enable or disable per-plugin profiling. Profiling costs two time stamp
+ * reads per plugin call, so it is off by default.
+ */
+void Evaluator::set_profile(bool enable)
+{
+	profile = enable;
+}
+
+/*
+ * Print lazy evaluation cutoff rates and, if profiling was enabled,
+ * the time spent in each plugin.
+ */
+void Evaluator::print_profile(FILE * fp) const
+{
+	fprintf(fp, INFO_PRFX "evals_lazy_cutoff=%lu (%.1f%%)"
+				" evals_phase1_cutoff=%lu (%.1f%%)\n",
+			stat_lazy_cutoffs,
+			stat_evals ? 100.0 * stat_lazy_cutoffs / stat_evals
+				: 0.0,
+			stat_phase1_cutoffs,
+			stat_evals_phase1 ? 100.0 * stat_phase1_cutoffs
+				/ stat_evals_phase1 : 0.0);
+
+	if (!profile && prof_ticks_phase[0] == 0) {
+		return;
+	}
+
+	const unsigned long long total = prof_ticks_setup
+		+ prof_ticks_phase[0] + prof_ticks_phase[1];
+	fprintf(fp, INFO_PRFX "evalprofile_ticks_total=%llu"
+				" evalprofile_ticks_setup=%llu (%.1f%%)\n",
+			total, prof_ticks_setup,
+			total ? 100.0 * prof_ticks_setup / total : 0.0);
+
+	for (unsigned int stage = 0; stage < 2; stage++) {
+		const struct score_plugin * p =
+			(stage == 0) ? plugins : plugins2;
+		const char * prfx = (stage == 0) ? "plugin" : "plugin2";
+
+		fprintf(fp, INFO_PRFX "evalprofile_phase%u_calls=%lu"
+					" evalprofile_phase%u_ticks=%llu"
+					" (%.1f%%)\n",
+				stage + 1, (stage == 0) ? stat_evals_phase1
+						: stat_evals_phase2,
+				stage + 1, prof_ticks_phase[stage],
+				total ? 100.0 * prof_ticks_phase[stage] / total
+					: 0.0);
+
+		for (int i=0; p[i].name != NULL && i < MAX_PLUGINS; i++) {
+			const unsigned long calls = prof_calls[stage][i];
+			const unsigned long long ticks = prof_ticks[stage][i];
+			fprintf(fp, INFO_PRFX "evalprofile_%s_%s_calls=%lu"
+					" evalprofile_%s_%s_ticks=%llu"
+					" (%.1f%%, %.1f/call)\n",
+					prfx, p[i].name, calls,
+					prfx, p[i].name, ticks,
+					total ? 100.0 * ticks / total : 0.0,
+					calls ? (double) ticks / calls : 0.0);
+		}
+	}
+}
+
+void Evaluator::get_cache_statistics(unsigned long * pawnhash_probes,
+		unsigned long * pawnhash_hits,
+		unsigned long * evalcache_probes,
+		unsigned long * evalcache_hits) const
+{
+	*pawnhash_probes = stat_pawnhash_probes;
+	*pawnhash_hits = stat_pawnhash_hits;
+	*evalcache_probes = stat_evalcache_probes;
+	*evalcache_hits = stat_evalcache_hits;
 }
 
 
 void Evaluator::set_pawnhash_size(size_t bytes)
 {
-	if (bytes > 0) {
+	if (!shared_pawnhashtable) {
 		delete pawnhashtable;
+	}
+
+	if (bytes > 0) {
 		pawnhashtable = new PawnHashTable(bytes);
 		pawnhashtable->print_info();
 	} else {
-		delete pawnhashtable;
 		pawnhashtable = NULL;
 	}
+
+	shared_pawnhashtable = false;
+}
+
+/*
+ * Use a pawn hash table owned by somebody else, possibly shared with
+ * other threads.
+ */
+void Evaluator::set_pawnhash_table(PawnHashTable * table)
+{
+	if (!shared_pawnhashtable) {
+		delete pawnhashtable;
+	}
+
+	pawnhashtable = table;
+	shared_pawnhashtable = true;
 }
 	
 void Evaluator::clear_pawnhash()
@@ -279,14 +531,32 @@ void Evaluator::clear_pawnhash()
 
 void Evaluator::set_evalcache_size(size_t bytes)
 {
-	if (bytes > 0) {
+	if (!shared_evalcache) {
 		delete evalcache;
+	}
+
+	if (bytes > 0) {
 		evalcache = new EvaluationCache(bytes);
 		evalcache->print_info();
 	} else {
-		delete evalcache;
 		evalcache = NULL;
 	}
+
+	shared_evalcache = false;
+}
+
+/*
+ * Use an evaluation cache owned by somebody else, possibly shared with
+ * other threads.
+ */
+void Evaluator::set_evalcache_table(EvaluationCache * cache)
+{
+	if (!shared_evalcache) {
+		delete evalcache;
+	}
+
+	evalcache = cache;
+	shared_evalcache = true;
 }
 
 void Evaluator::clear_evalcache()
@@ -296,3 +566,142 @@ void Evaluator::clear_evalcache()
 	}
 }
 
+
+/*****************************************************************************
+ *
+ * Tunable parameters.
+ *
+ *****************************************************************************/
+
+const struct eval_param * Evaluator::find_param(const char * name)
+{
+	for (const struct eval_param * p = params; p->name; p++) {
+		if (strcmp(p->name, name) == 0) {
+			return p;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Print all parameters, one per line, in the format read by
+ * load_params(). Packed values are printed as midgame and endgame
+ * value.
+ */
+void Evaluator::print_params(FILE * fp)
+{
+	for (const struct eval_param * p = params; p->name; p++) {
+		fprintf(fp, "%s", p->name);
+		for (unsigned int i=0; i<p->count; i++) {
+			if (p->packed) {
+				fprintf(fp, " %d %d", SCORE_MG(p->values[i]),
+						SCORE_EG(p->values[i]));
+			} else {
+				fprintf(fp, " %d", p->values[i]);
+			}
+		}
+		fprintf(fp, "\n");
+	}
+}
+
+bool Evaluator::save_params(const char * filename)
+{
+	FILE * fp = fopen(filename, "w");
+	if (fp == NULL) {
+		printf("Cannot open %s: %s\n", filename, strerror(errno));
+		return false;
+	}
+	print_params(fp);
+	if (fclose(fp) != 0) {
+		printf("Cannot write %s: %s\n", filename, strerror(errno));
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Read parameters written by print_params(). Parameters not
+ * mentioned in the file keep their value. Nothing is changed if the
+ * file contains an error.
+ */
+bool Evaluator::load_params(const char * filename)
+{
+	FILE * fp = fopen(filename, "r");
+	if (fp == NULL) {
+		printf("Cannot open %s: %s\n", filename, strerror(errno));
+		return false;
+	}
+
+	std::vector<std::pair<const struct eval_param *, std::vector<int> > >
+		values;
+
+	char buf[8192];
+	unsigned int lineno = 0;
+	bool ok = true;
+	while (ok && fgets(buf, sizeof(buf), fp) != NULL) {
+		lineno++;
+		std::istringstream ss(buf);
+		std::string name;
+		if (!(ss >> name) || name[0] == '#') {
+			continue;
+		}
+
+		const struct eval_param * p = find_param(name.c_str());
+		if (p == NULL) {
+			printf("%s:%u: unknown parameter: %s\n",
+					filename, lineno, name.c_str());
+			ok = false;
+			break;
+		}
+
+		std::vector<int> v;
+		std::string tok;
+		while (ss >> tok) {
+			char * endptr;
+			long x = strtol(tok.c_str(), &endptr, 10);
+			if (*endptr != '\0' || x < -32768 || x > 32767) {
+				printf("%s:%u: illegal value: %s\n",
+						filename, lineno, tok.c_str());
+				ok = false;
+				break;
+			}
+			v.push_back(x);
+		}
+
+		const size_t n = p->count * (p->packed ? 2 : 1);
+		if (ok && v.size() != n) {
+			printf("%s:%u: %s needs %lu values, got %lu\n",
+					filename, lineno, name.c_str(),
+					(unsigned long) n,
+					(unsigned long) v.size());
+			ok = false;
+		}
+		values.push_back(std::make_pair(p, v));
+	}
+	fclose(fp);
+
+	if (!ok) {
+		return false;
+	}
+
+	for (size_t i=0; i<values.size(); i++) {
+		const struct eval_param * p = values[i].first;
+		const std::vector<int> & v = values[i].second;
+		for (unsigned int j=0; j<p->count; j++) {
+			p->values[j] = p->packed ? SCORE(v[2*j], v[2*j+1])
+				: v[j];
+		}
+	}
+	params_changed();
+
+	return true;
+}
+
+/*
+ * Must be called after parameters have been changed. Boards that
+ * already exist must then be updated with Board::update_psq().
+ */
+void Evaluator::params_changed()
+{
+	init();
+}
@@ -35,8 +35,6 @@ EvaluationCache::EvaluationCache(size_t bytes)
 	for (unsigned long i = 0; i < cache_size; i++) {
 		cache[i].score = INT_MIN;
 	}
-
-	reset_statistics();
 }
 
 EvaluationCache::~EvaluationCache()
@@ -51,37 +49,38 @@ void EvaluationCache::clear()
 	for (unsigned long i = 0; i < cache_size; i++) {
 		cache[i].score = INT_MIN;
 	}
-
-	reset_statistics();
 }
 
 bool EvaluationCache::put(const Board & board, int score)
 {
 	const Hashkey hashkey = board.get_hashkey_noside();
 	const unsigned long key = hashkey % cache_size;
+	const int s = (board.get_side() == WHITE) ? score : -score;
 
-	cache[key].hashkey = hashkey;
-	cache[key].score = (board.get_side() == WHITE) ? score : -score;
+	cache[key].check = hashkey ^ (uint32_t) s;
+	cache[key].score = s;
 	return true;
 }
 
 bool EvaluationCache::probe(const Board & board, int * score)
 {
 	ASSERT(score != NULL);
-	stat_probes++;
 	
 	const Hashkey hashkey = board.get_hashkey_noside();
 	const unsigned long key = hashkey % cache_size;
 
-	if (cache[key].score == INT_MIN) {
+	/* Read each field once, the slot may be overwritten by another
+	 * thread meanwhile. */
+	const int s = cache[key].score;
+	const Hashkey check = cache[key].check;
+
+	if (s == INT_MIN) {
 		return false;
-	} else if (cache[key].hashkey != hashkey) {
+	} else if ((check ^ (uint32_t) s) != hashkey) {
 		return false;
 	}
 
-	*score = (board.get_side() == WHITE)
-		? cache[key].score : -cache[key].score;
-	stat_hits++;
+	*score = (board.get_side() == WHITE) ? s : -s;
 	return true;
 }
 
@@ -92,15 +91,3 @@ void EvaluationCache::print_info(FILE * fp) const
 			cache_size,
 			(unsigned long) (cache_size * sizeof(cacheentry)));
 }
-
-void EvaluationCache::print_statistics(FILE * fp) const
-{
-	fprintf(fp, INFO_PRFX "evalcache_probes=%lu evalcache_hits=%lu\n",
-			stat_probes, stat_hits);
-}
-
-void EvaluationCache::reset_statistics()
-{
-	stat_probes = 0;
-	stat_hits = 0;
-}
@@ -26,9 +26,13 @@
 class EvaluationCache
 {
       private:
-	/* A cache slot is empty if score == INT_MIN. */
+	/* A cache slot is empty if score == INT_MIN. The hash key is
+	 * stored XORed with the score, so that an entry which was
+	 * written concurrently by another thread fails verification
+	 * instead of returning a wrong score. This way, one cache can
+	 * be shared by several threads without locking. */
 	struct cacheentry {
-		Hashkey hashkey;
+		Hashkey check;
 		int score;
 	};
 	
@@ -36,9 +40,6 @@ class EvaluationCache
 	unsigned long cache_size;
 	struct cacheentry * cache;
 	
-	unsigned long stat_probes;
-	unsigned long stat_hits;
-
       public:
 	EvaluationCache(size_t bytes);
 	~EvaluationCache();
@@ -49,8 +50,6 @@ class EvaluationCache
 	bool probe(const Board & board, int * score);	
 
 	void print_info(FILE * fp = stdout) const;
-	void print_statistics(FILE * fp = stdout) const;
-	void reset_statistics();
 };
 
 #endif // EVALCACHE_H
@@ -0,0 +1,291 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include "common.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <queue>
+#include <vector>
+
+
+/*
+ * Sorts more records than fit into memory.
+ *
+ * put() collects the records in a buffer of at most `memory' bytes.
+ * Whenever the buffer is full, it is sorted and written to a temporary
+ * file as a run. Runs are merged in tiers: whenever there are MAX_MERGE
+ * runs of the same level, they are merged into one run of the next
+ * level, so only a few files are open at any time and the total merge
+ * work is O(n log n). finish() sorts or writes out the rest, and get()
+ * then returns all records in order, merging the remaining runs on the
+ * fly. If everything fit into the buffer, no file is written at all.
+ *
+ * T is written to the files as it is, so it must be a plain struct.
+ * Less is a strict weak ordering of T.
+ */
+template <typename T, typename Less>
+class ExternalSort {
+      public:
+	/* number of runs of the same level merged into one */
+	static const unsigned int MAX_MERGE = 64;
+
+      private:
+	struct head {
+		T rec;
+		size_t src;
+	};
+
+	/* std::priority_queue keeps the greatest element on top */
+	class head_greater {
+	      public:
+		inline bool operator()(const struct head & a,
+				const struct head & b) const
+		{
+			return Less()(b.rec, a.rec);
+		}
+	};
+
+	std::vector<T> buffer;
+	size_t max_records;
+	std::vector<FILE *> runs;
+	std::vector<unsigned int> run_levels;	/* number of merges */
+	unsigned long long records;
+
+	/* state of get() */
+	bool finished;
+	size_t buffer_pos;
+	std::priority_queue<struct head, std::vector<struct head>,
+		head_greater> heap;
+
+      public:
+	ExternalSort(size_t memory);
+	~ExternalSort();
+
+      public:
+	void put(const T & rec);
+	void finish();
+	bool get(T * rec);
+	void clear();
+
+	unsigned long long size() const
+	{ return records; }
+	size_t nr_runs() const
+	{ return runs.size() + !buffer.empty(); }
+
+      private:
+	void flush_run();
+	FILE * merge_runs(size_t first, size_t count);
+	void push(size_t src);
+};
+
+
+template <typename T, typename Less>
+ExternalSort<T, Less>::ExternalSort(size_t memory)
+{
+	max_records = memory / sizeof(T);
+	if (max_records == 0) {
+		max_records = 1;
+	}
+	records = 0;
+	finished = false;
+	buffer_pos = 0;
+}
+
+template <typename T, typename Less>
+ExternalSort<T, Less>::~ExternalSort()
+{
+	clear();
+}
+
+template <typename T, typename Less>
+void ExternalSort<T, Less>::put(const T & rec)
+{
+	ASSERT(!finished);
+	if (buffer.size() == max_records) {
+		flush_run();
+	}
+	buffer.push_back(rec);
+	records++;
+}
+
+/*
+ * No more records will be put. Prepare get().
+ */
+template <typename T, typename Less>
+void ExternalSort<T, Less>::finish()
+{
+	ASSERT(!finished);
+	finished = true;
+
+	if (runs.empty()) {
+		std::sort(buffer.begin(), buffer.end(), Less());
+		buffer_pos = 0;
+		return;
+	}
+
+	/* Release the buffer, so that the caller has the memory limit
+	 * available again while the runs are merged. */
+	flush_run();
+	std::vector<T>().swap(buffer);
+	for (size_t i=0; i<runs.size(); i++) {
+		rewind(runs[i]);
+		push(i);
+	}
+}
+
+/*
+ * Return the next record in order. Returns false if there are no more
+ * records.
+ */
+template <typename T, typename Less>
+bool ExternalSort<T, Less>::get(T * rec)
+{
+	ASSERT(finished);
+
+	if (runs.empty()) {
+		if (buffer_pos == buffer.size()) {
+			return false;
+		}
+		*rec = buffer[buffer_pos++];
+		return true;
+	}
+
+	if (heap.empty()) {
+		return false;
+	}
+	const struct head h = heap.top();
+	heap.pop();
+	*rec = h.rec;
+	push(h.src);
+	return true;
+}
+
+/*
+ * Drop all records and free the memory and the temporary files. The
+ * sorter can be used again afterwards.
+ */
+template <typename T, typename Less>
+void ExternalSort<T, Less>::clear()
+{
+	for (size_t i=0; i<runs.size(); i++) {
+		fclose(runs[i]);
+	}
+	runs.clear();
+	run_levels.clear();
+	std::vector<T>().swap(buffer);
+	heap = std::priority_queue<struct head, std::vector<struct head>,
+		head_greater>();
+	records = 0;
+	finished = false;
+	buffer_pos = 0;
+}
+
+/*
+ * Sort the buffer and write it to a temporary file as a new run.
+ */
+template <typename T, typename Less>
+void ExternalSort<T, Less>::flush_run()
+{
+	if (buffer.empty()) {
+		return;
+	}
+
+	std::sort(buffer.begin(), buffer.end(), Less());
+
+	FILE * fp = tmpfile();
+	if (!fp) {
+		perror("ExternalSort: tmpfile() failed");
+		exit(EXIT_FAILURE);
+	}
+	if (fwrite(&buffer[0], sizeof(T), buffer.size(), fp)
+			!= buffer.size()) {
+		perror("ExternalSort: fwrite() failed");
+		exit(EXIT_FAILURE);
+	}
+	runs.push_back(fp);
+	run_levels.push_back(0);
+	buffer.clear();
+
+	while (runs.size() >= MAX_MERGE) {
+		const size_t first = runs.size() - MAX_MERGE;
+		const unsigned int level = run_levels.back();
+		if (run_levels[first] != level) {
+			break;
+		}
+		FILE * merged = merge_runs(first, MAX_MERGE);
+		runs.resize(first);
+		run_levels.resize(first);
+		runs.push_back(merged);
+		run_levels.push_back(level + 1);
+	}
+}
+
+/*
+ * Merge count runs, starting at runs[first], into a new run, and close
+ * them.
+ */
+template <typename T, typename Less>
+FILE * ExternalSort<T, Less>::merge_runs(size_t first, size_t count)
+{
+	FILE * out = tmpfile();
+	if (!out) {
+		perror("ExternalSort: tmpfile() failed");
+		exit(EXIT_FAILURE);
+	}
+
+	ExternalSort<T, Less> merger(sizeof(T));
+	merger.runs.assign(runs.begin() + first, runs.begin() + first + count);
+	merger.run_levels.assign(count, 0);
+	merger.finished = true;
+	for (size_t i=0; i<count; i++) {
+		rewind(merger.runs[i]);
+		merger.push(i);
+	}
+
+	T rec;
+	while (merger.get(&rec)) {
+		if (fwrite(&rec, sizeof(rec), 1, out) != 1) {
+			perror("ExternalSort: fwrite() failed");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* merger closes the runs */
+	return out;
+}
+
+template <typename T, typename Less>
+void ExternalSort<T, Less>::push(size_t src)
+{
+	struct head h;
+	if (fread(&h.rec, sizeof(h.rec), 1, runs[src]) == 1) {
+		h.src = src;
+		heap.push(h);
+	} else if (ferror(runs[src])) {
+		perror("ExternalSort: fread() failed");
+		exit(EXIT_FAILURE);
+	}
+}
+
+#endif // EXTSORT_H
@@ -415,6 +415,24 @@ void Game::check_result()
 	}
 }
 
+/*
+ * Recompute the piece-square sums of all boards, after the evaluation
+ * parameters have been changed.
+ */
+void Game::update_psq()
+{
+	initial_board.update_psq();
+	current_board.update_psq();
+	for (std::list<GameEntry>::iterator it = entries.begin();
+			it != entries.end(); it++) {
+		it->update_psq();
+	}
+	for (std::list<GameEntry>::iterator it = undone_entries.begin();
+			it != undone_entries.end(); it++) {
+		it->update_psq();
+	}
+}
+
 void Game::print(FILE * fp) const
 {
 	fprintf(fp, "Positions in game history: %d\n", (int) entries.size());
@@ -61,6 +61,9 @@ class GameEntry
 
 	unsigned int get_flags() const
 	{ return flags; }
+
+	void update_psq()
+	{ board.update_psq(); }
 };
 
 class Game
@@ -128,6 +131,7 @@ class Game
 
 	int repetitions(const Board & board) const;
 	int last_bookmove() const;
+	void update_psq();
 
       private:
 	void check_result();
@@ -0,0 +1,447 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "gamedb.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+
+/*****************************************************************************
+ *
+ * Member functions of class GameDB.
+ *
+ *****************************************************************************/
+
+/*
+ * Open a game database for reading.
+ */
+GameDB::GameDB(const char * filename, bool * ret)
+{
+	nr_games = 0;
+	index_offset = 0;
+
+	if (!file.open(filename)) {
+		*ret = false;
+		return;
+	} else if (file.get_size() < HEADER_SIZE) {
+		printf("%s seems to be no game database\n", filename);
+		*ret = false;
+		return;
+	}
+
+	const unsigned char * data = file.get_data();
+	const size_t data_size = file.get_size();
+
+	const uint32_t magic = MappedFile::get_uint(data, 4);
+	const uint32_t version = MappedFile::get_uint(data + 4, 4);
+	nr_games = MappedFile::get_uint(data + 8, 8);
+	index_offset = MappedFile::get_uint(data + 16, 8);
+
+	if (magic != s_magic) {
+		printf("%s seems to be no game database"
+				" (magic = 0x%0lx, should be 0x%0lx)\n",
+				filename, (unsigned long) magic,
+				(unsigned long) s_magic);
+		*ret = false;
+		return;
+	} else if (version != FORMAT_VERSION) {
+		printf("%s: unsupported game database version %lu\n",
+				filename, (unsigned long) version);
+		*ret = false;
+		return;
+	} else if (index_offset < HEADER_SIZE || index_offset > data_size
+			|| (data_size - index_offset) / 8 < nr_games) {
+		printf("%s is truncated\n", filename);
+		*ret = false;
+		return;
+	}
+
+	*ret = true;
+}
+
+/*
+ * Find the tags and the moves of game i (counting from 0) in the file.
+ * Returns false if the game is corrupt.
+ */
+bool GameDB::locate(unsigned long i, const char ** tags, uint32_t * taglen,
+		const unsigned char ** moves, unsigned int * nr_moves) const
+{
+	if (i >= nr_games) {
+		return false;
+	}
+
+	const uint64_t off = MappedFile::get_uint(
+			file.get_data() + index_offset + 8 * i, 8);
+	if (off < HEADER_SIZE || off + 4 > index_offset) {
+		return false;
+	}
+	const unsigned char * p = file.get_data() + off;
+	const unsigned char * const end = file.get_data() + index_offset;
+
+	*taglen = MappedFile::get_uint(p, 4);
+	p += 4;
+	if ((uint64_t) (end - p) < (uint64_t) *taglen + 2) {
+		return false;
+	}
+	*tags = (const char *) p;
+	p += *taglen;
+
+	*nr_moves = MappedFile::get_uint(p, 2);
+	p += 2;
+	if ((uint64_t) (end - p) < 2 * (uint64_t) *nr_moves) {
+		return false;
+	}
+	*moves = p;
+
+	return true;
+}
+
+/*
+ * Read game i (counting from 0) into pgn. The moves are replayed to get
+ * the hash keys, like PGN::parse() does. Tags other than FEN are only
+ * stored if with_tags is true. If max_moves is not 0, only the first
+ * max_moves moves are read. Returns false if the game is corrupt.
+ */
+bool GameDB::read(unsigned long i, PGN * pgn, bool with_tags,
+		unsigned int max_moves) const
+{
+	const char * t;
+	uint32_t taglen;
+	const unsigned char * p;
+	unsigned int nr_moves;
+	if (!locate(i, &t, &taglen, &p, &nr_moves)) {
+		return false;
+	}
+
+	pgn->tags.clear();
+	pgn->moves.clear();
+	pgn->hashkeys.clear();
+
+	std::string fen;
+	const char * const tend = t + taglen;
+	while (t < tend) {
+		const char * val = (const char *) memchr(t, '\0', tend - t);
+		if (!val) {
+			return false;
+		}
+		val++;
+		const char * next = (const char *) memchr(val, '\0',
+				tend - val);
+		if (!next) {
+			return false;
+		}
+		if (strcmp(t, "FEN") == 0) {
+			fen = val;
+		}
+		if (with_tags) {
+			pgn->tags[t] = val;
+		}
+		t = next + 1;
+	}
+
+	if (max_moves > 0 && nr_moves > max_moves) {
+		nr_moves = max_moves;
+	}
+
+	if (!fen.empty()) {
+		if (!pgn->opening.parse_fen(fen)) {
+			return false;
+		}
+	} else {
+		static const Board standard(opening_fen());
+		pgn->opening = standard;
+	}
+
+	Board board = pgn->opening;
+	for (unsigned int k=0; k<nr_moves; k++) {
+		const Move mov = decode_move(board,
+				MappedFile::get_uint(p + 2 * k, 2));
+		if (mov == NO_MOVE) {
+			return false;
+		}
+		pgn->moves.push_back(mov);
+		pgn->hashkeys.push_back(board.get_hashkey());
+		board.make_move(mov);
+	}
+
+	return true;
+}
+
+/*
+ * A move is stored as
+ *
+ *	bits  0 -  6	from square
+ *	bits  7 - 13	to square
+ *	bits 14 - 15	piece a pawn promotes to, minus KNIGHT (chess only)
+ *
+ * The other properties of the move follow from the position, like for
+ * a move in coordinate notation.
+ */
+unsigned int GameDB::encode_move(Move mov) /* static */
+{
+	unsigned int code = mov.from() | (mov.to() << 7);
+#ifdef HOICHESS
+	if (mov.is_promotion()) {
+		code |= (mov.promote_to() - KNIGHT) << 14;
+	}
+#endif
+	return code;
+}
+
+/*
+ * Return the move with the given code in the position, or NO_MOVE if
+ * it is not a legal move there.
+ */
+Move GameDB::decode_move(const Board & board, unsigned int code) /* static */
+{
+	const Square from = (Square) (code & 0x7f);
+	const Square to = (Square) ((code >> 7) & 0x7f);
+	if (from >= BOARDSIZE || to >= BOARDSIZE
+			|| board.color_at(from) != board.get_side()) {
+		return NO_MOVE;
+	}
+
+#ifdef HOICHESS
+	const Move mov = Move::autoselect(board, from, to,
+			(Piece) (KNIGHT + (code >> 14)));
+#else
+	const Piece cap_ptype = board.piece_at(to);
+	const Move mov = (cap_ptype != NO_PIECE)
+		? Move::capture(from, to, board.piece_at(from), cap_ptype)
+		: Move::normal(from, to, board.piece_at(from));
+#endif
+	if (!board.is_valid_move(mov) || !board.is_legal_move(mov)) {
+		return NO_MOVE;
+	}
+	return mov;
+}
+
+/*
+ * Pass all games to consumer, without tags and cut off after max_moves
+ * moves (if not 0). Returns the number of games that were passed.
+ */
+unsigned long GameDB::replay_all(PGNConsumer * consumer,
+		bool show_progress, unsigned int max_moves) const
+{
+	unsigned long ok = 0, skipped = 0;
+	PGN pgn;
+	for (unsigned long i=0; i<nr_games; i++) {
+		if (read(i, &pgn, false, max_moves)) {
+			consumer->consume(pgn);
+			ok++;
+		} else {
+			skipped++;
+		}
+
+		if (show_progress && (i+1) % 10000 == 0) {
+			printf("Reading game database: %lu games read, "
+					"%lu games skipped due to errors\r",
+					ok, skipped);
+			fflush(stdout);
+		}
+	}
+
+	printf("Reading game database: %lu games read, "
+			"%lu games skipped due to errors\n",
+			ok, skipped);
+	return ok;
+}
+
+/*
+ * Check if filename starts with the magic number of a game database.
+ */
+bool GameDB::is_gamedb(const char * filename) /* static */
+{
+	FILE * fp = fopen(filename, "rb");
+	if (!fp) {
+		return false;
+	}
+	unsigned char buf[4];
+	const bool ret = (fread(buf, sizeof(buf), 1, fp) == 1
+			&& MappedFile::get_uint(buf, 4) == s_magic);
+	fclose(fp);
+	return ret;
+}
+
+/*
+ * Convert a PGN file to a game database, keeping the order of the games.
+ */
+bool GameDB::create_from_pgn(const char * dbfile, const char * pgnfile,
+		unsigned int nthreads) /* static */
+{
+	GameDBWriter writer;
+	if (!writer.open(dbfile)) {
+		return false;
+	}
+
+	PGNPipeline pipeline(nthreads, true);
+	if (!pipeline.run(pgnfile, &writer, (isatty(1) == 1))) {
+		writer.close();
+		return false;
+	}
+	pipeline.print_statistics();
+
+	if (!writer.close()) {
+		return false;
+	}
+
+	printf("%lu games written to %s, %lu games not representable\n",
+			writer.get_games(), dbfile, writer.get_skipped());
+	return true;
+}
+
+
+/*****************************************************************************
+ *
+ * Member functions of class GameDBWriter.
+ *
+ *****************************************************************************/
+
+GameDBWriter::GameDBWriter()
+{
+	fp = NULL;
+	pos = 0;
+	skipped = 0;
+}
+
+GameDBWriter::~GameDBWriter()
+{
+	if (fp) {
+		fclose(fp);
+	}
+}
+
+bool GameDBWriter::open(const char * filename)
+{
+	ASSERT(fp == NULL);
+
+	this->filename = filename;
+	fp = fopen(filename, "wb");
+	if (!fp) {
+		printf("Cannot open %s for writing: %s\n",
+				filename, strerror(errno));
+		return false;
+	}
+
+	offsets.clear();
+	skipped = 0;
+	pos = 0;
+
+	/* The header is written again by close(). */
+	const std::string header(GameDB::HEADER_SIZE, '\0');
+	return write(header.data(), header.size());
+}
+
+/*
+ * Append a game. Games with more than 65535 moves cannot be stored.
+ */
+bool GameDBWriter::add(const PGN & pgn)
+{
+	ASSERT(fp != NULL);
+
+	const std::list<Move> & moves = pgn.get_moves();
+	if (moves.size() > 0xffff) {
+		skipped++;
+		return false;
+	}
+
+	std::string tags;
+	const std::map<std::string, std::string> & m = pgn.get_tags();
+	for (std::map<std::string, std::string>::const_iterator it = m.begin();
+			it != m.end();
+			it++) {
+		tags += it->first;
+		tags += '\0';
+		tags += it->second;
+		tags += '\0';
+	}
+
+	buf.clear();
+	MappedFile::put_uint(&buf, tags.size(), 4);
+	buf += tags;
+	MappedFile::put_uint(&buf, moves.size(), 2);
+
+	for (std::list<Move>::const_iterator it = moves.begin();
+			it != moves.end();
+			it++) {
+		MappedFile::put_uint(&buf, GameDB::encode_move(*it), 2);
+	}
+
+	offsets.push_back(pos);
+	return write(buf.data(), buf.size());
+}
+
+void GameDBWriter::consume(const PGN & pgn)
+{
+	add(pgn);
+}
+
+/*
+ * Write the index and the header, and close the file.
+ */
+bool GameDBWriter::close()
+{
+	ASSERT(fp != NULL);
+
+	bool ok = true;
+	const uint64_t index_offset = pos;
+	for (size_t i=0; ok && i<offsets.size(); i++) {
+		buf.clear();
+		MappedFile::put_uint(&buf, offsets[i], 8);
+		ok = write(buf.data(), buf.size());
+	}
+
+	if (ok) {
+		buf.clear();
+		MappedFile::put_uint(&buf, GameDB::s_magic, 4);
+		MappedFile::put_uint(&buf, GameDB::FORMAT_VERSION, 4);
+		MappedFile::put_uint(&buf, offsets.size(), 8);
+		MappedFile::put_uint(&buf, index_offset, 8);
+		if (fseek(fp, 0, SEEK_SET) == -1) {
+			perror("GameDBWriter::close(): fseek() failed");
+			exit(EXIT_FAILURE);
+		}
+		ok = write(buf.data(), buf.size());
+	}
+
+	if (fclose(fp) != 0 && ok) {
+		printf("Cannot write %s: %s\n",
+				filename.c_str(), strerror(errno));
+		ok = false;
+	}
+	fp = NULL;
+	return ok;
+}
+
+bool GameDBWriter::write(const void * p, size_t n)
+{
+	if (fwrite(p, 1, n, fp) != n) {
+		printf("Cannot write %s: %s\n",
+				filename.c_str(), strerror(errno));
+		return false;
+	}
+	pos += n;
+	return true;
+}
@@ -0,0 +1,133 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef GAMEDB_H
+#define GAMEDB_H
+
+#include "common.h"
+#include "board.h"
+#include "mappedfile.h"
+#include "pgn.h"
+#include "pgnpipeline.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+
+/*
+ * Compact binary game database.
+ *
+ * All numbers are stored in little endian byte order. The file starts
+ * with a header:
+ *
+ *	uint32	magic
+ *	uint32	version
+ *	uint64	number of games
+ *	uint64	file offset of the index
+ *
+ * followed by the games, each consisting of
+ *
+ *	uint32	length of the tags
+ *	char[]	tags, as "name\0value\0" pairs
+ *	uint16	number of moves
+ *	uint16[] moves, see encode_move()
+ *
+ * and finally the index, one uint64 file offset per game. The opening
+ * position is given by the FEN tag, like in PGN. Replaying a game
+ * needs neither SAN parsing nor move generation.
+ */
+class GameDB {
+      public:
+	static const uint32_t FORMAT_VERSION = 2;
+	static const unsigned int HEADER_SIZE = 24;
+
+#if defined(HOICHESS)
+	static const uint32_t s_magic = 0x62646763L;	/* "cgdb" */
+#elif defined(HOIXIANGQI)
+	static const uint32_t s_magic = 0x62646778L;	/* "xgdb" */
+#else
+# error "neither HOICHESS nor HOIXIANGQI defined"
+#endif
+
+      private:
+	MappedFile file;
+	uint64_t nr_games;
+	uint64_t index_offset;
+
+      public:
+	GameDB(const char * filename, bool * ret);
+
+      public:
+	unsigned long size() const
+	{ return nr_games; }
+
+	bool read(unsigned long i, PGN * pgn, bool with_tags = true,
+			unsigned int max_moves = 0) const;
+	unsigned long replay_all(PGNConsumer * consumer,
+			bool show_progress = false,
+			unsigned int max_moves = 0) const;
+
+	static unsigned int encode_move(Move mov);
+	static Move decode_move(const Board & board, unsigned int code);
+
+	static bool is_gamedb(const char * filename);
+	static bool create_from_pgn(const char * dbfile, const char * pgnfile,
+			unsigned int nthreads = 1);
+
+      private:
+	bool locate(unsigned long i, const char ** tags, uint32_t * taglen,
+			const unsigned char ** moves,
+			unsigned int * nr_moves) const;
+};
+
+/*
+ * Writes a game database. As a PGNConsumer, it takes the games read by
+ * an ordered PGNPipeline.
+ */
+class GameDBWriter : public PGNConsumer {
+      private:
+	FILE * fp;
+	std::string filename;
+	std::vector<uint64_t> offsets;
+	uint64_t pos;
+	std::string buf;
+	unsigned long skipped;
+
+      public:
+	GameDBWriter();
+	~GameDBWriter();
+
+      public:
+	bool open(const char * filename);
+	bool add(const PGN & pgn);
+	virtual void consume(const PGN & pgn);
+	bool close();
+
+	unsigned long get_games() const
+	{ return offsets.size(); }
+
+	unsigned long get_skipped() const
+	{ return skipped; }
+
+      private:
+	bool write(const void * p, size_t n);
+};
+
+#endif // GAMEDB_H
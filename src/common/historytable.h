@@ -20,13 +20,38 @@
 #define HISTORYTABLE_H
 
 #include "basic.h"
+#include "move.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+/* Number of piece types, used to index the continuation history. */
+#define HISTORY_NPIECES (KING+1)
+
+/*
+ * Move ordering statistics for quiet moves of one side:
+ *
+ * - history: indexed by from and to square of a move
+ * - continuation history: indexed by piece and to square of the
+ *   previous (opponent's) move and piece and to square of the move
+ * - counter moves: the last quiet move that caused a cutoff in reply
+ *   to a given previous move, indexed by its from and to square
+ *
+ * History scores are updated with a "gravity" formula, which keeps them
+ * within [-HISTORY_MAX, HISTORY_MAX] and lets new results outweigh old
+ * ones. Moves that were searched without causing a cutoff receive a
+ * negative bonus (malus).
+ */
 class HistoryTable
 {
+      public:
+	enum { HISTORY_MAX = 16384 };
+
       private:
-	unsigned long table[BOARDSIZE][BOARDSIZE];
+	int table[BOARDSIZE][BOARDSIZE];
+	int16_t conttable[HISTORY_NPIECES][BOARDSIZE]
+			[HISTORY_NPIECES][BOARDSIZE];
+	Move countermoves[BOARDSIZE][BOARDSIZE];
 
       public:
 	inline HistoryTable();
@@ -34,8 +59,16 @@ class HistoryTable
 
       public:
 	inline void reset();
-	inline void add(Move mov);
-	inline unsigned long get(Move mov);
+	inline void age();
+	inline void add(Move mov, Move prev, int bonus);
+	inline int get(Move mov) const;
+	inline int get(Move mov, Move prev) const;
+	inline void set_countermove(Move prev, Move mov);
+	inline Move get_countermove(Move prev) const;
+
+      private:
+	static inline void update(int * val, int bonus);
+	static inline bool has_cont(Move prev);
 };
 
 
@@ -50,17 +83,65 @@ inline HistoryTable::~HistoryTable()
 inline void HistoryTable::reset()
 {
 	memset(table, 0, sizeof(table));
+	memset(conttable, 0, sizeof(conttable));
+	for (unsigned int i=0; i<BOARDSIZE; i++) {
+		for (unsigned int j=0; j<BOARDSIZE; j++) {
+			countermoves[i][j] = NO_MOVE;
+		}
+	}
+}
+
+/*
+ * Halve all history scores, so that statistics from earlier searches
+ * still help move ordering but are soon outweighed by new results.
+ */
+inline void HistoryTable::age()
+{
+	for (unsigned int i=0; i<BOARDSIZE; i++) {
+		for (unsigned int j=0; j<BOARDSIZE; j++) {
+			table[i][j] /= 2;
+		}
+	}
+
+	int16_t * p = &conttable[0][0][0][0];
+	int16_t * end = p + sizeof(conttable) / sizeof(int16_t);
+	for (; p < end; p++) {
+		*p /= 2;
+	}
+}
+
+inline void HistoryTable::update(int * val, int bonus)
+{
+	*val += bonus - *val * abs(bonus) / HISTORY_MAX;
+}
+
+inline bool HistoryTable::has_cont(Move prev)
+{
+	return prev && !prev.is_null();
 }
 	
-inline void HistoryTable::add(Move mov)
+/*
+ * Add a bonus (or malus, if negative) for a move played after the
+ * opponent's move prev.
+ */
+inline void HistoryTable::add(Move mov, Move prev, int bonus)
 {
 	ASSERT_DEBUG(mov.from() >= 0  &&  mov.from() < BOARDSIZE);
 	ASSERT_DEBUG(mov.to()   >= 0  &&  mov.to()   < BOARDSIZE);
 
-	table[mov.from()][mov.to()]++;
+	bonus = MAX(-HISTORY_MAX, MIN(bonus, HISTORY_MAX));
+	update(&table[mov.from()][mov.to()], bonus);
+
+	if (has_cont(prev)) {
+		int16_t * p = &conttable[prev.ptype()][prev.to()]
+			[mov.ptype()][mov.to()];
+		int val = *p;
+		update(&val, bonus);
+		*p = val;
+	}
 }
 	
-inline unsigned long HistoryTable::get(Move mov)
+inline int HistoryTable::get(Move mov) const
 {
 	ASSERT_DEBUG(mov.from() >= 0  &&  mov.from() < BOARDSIZE);
 	ASSERT_DEBUG(mov.to()   >= 0  &&  mov.to()   < BOARDSIZE);
@@ -68,4 +149,33 @@ inline unsigned long HistoryTable::get(Move mov)
 	return table[mov.from()][mov.to()];
 }
 
+/*
+ * Combined history and continuation history score.
+ */
+inline int HistoryTable::get(Move mov, Move prev) const
+{
+	int score = get(mov);
+	if (has_cont(prev)) {
+		score += conttable[prev.ptype()][prev.to()]
+			[mov.ptype()][mov.to()];
+	}
+	return score;
+}
+
+inline void HistoryTable::set_countermove(Move prev, Move mov)
+{
+	if (has_cont(prev)) {
+		countermoves[prev.from()][prev.to()] = mov;
+	}
+}
+
+inline Move HistoryTable::get_countermove(Move prev) const
+{
+	if (has_cont(prev)) {
+		return countermoves[prev.from()][prev.to()];
+	} else {
+		return NO_MOVE;
+	}
+}
+
 #endif // HISTORYTABLE_H
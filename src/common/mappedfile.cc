@@ -0,0 +1,127 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "mappedfile.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+#endif
+
+
+MappedFile::MappedFile()
+{
+	fp = NULL;
+	data = NULL;
+	size = 0;
+	mapped = false;
+}
+
+MappedFile::~MappedFile()
+{
+	if (data) {
+#ifdef HAVE_MMAP
+		if (mapped) {
+			munmap((void *) data, size);
+		} else
+#endif
+		{
+			free((void *) data);
+		}
+	}
+	if (fp) {
+		fclose(fp);
+	}
+}
+
+/*
+ * Open filename and make its contents available through get_data().
+ * Returns false if the file cannot be opened. An empty file is opened
+ * successfully, with get_data() returning NULL.
+ */
+bool MappedFile::open(const char * filename)
+{
+	ASSERT(fp == NULL);
+
+	fp = fopen(filename, "rb");
+	if (!fp) {
+		printf("Cannot open %s for reading: %s\n",
+				filename, strerror(errno));
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fileno(fp), &st) == -1) {
+		perror("MappedFile::open(): fstat() failed");
+		exit(EXIT_FAILURE);
+	}
+	size = st.st_size;
+	if (size == 0) {
+		return true;
+	}
+
+#ifdef HAVE_MMAP
+	void * p = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+	if (p != MAP_FAILED) {
+		data = (const unsigned char *) p;
+		mapped = true;
+	}
+#endif
+	if (!data) {
+		unsigned char * buf = (unsigned char *) malloc(size);
+		if (!buf) {
+			perror("MappedFile::open(): malloc() failed");
+			exit(EXIT_FAILURE);
+		}
+		if (fread(buf, 1, size, fp) != size) {
+			perror("MappedFile::open(): fread() failed");
+			exit(EXIT_FAILURE);
+		}
+		data = buf;
+	}
+
+	return true;
+}
+
+/*
+ * Little endian encoding, independent of the host byte order.
+ */
+void MappedFile::put_uint(std::string * buf, uint64_t v,
+		unsigned int bytes) /* static */
+{
+	for (unsigned int i=0; i<bytes; i++) {
+		*buf += (char) ((v >> (8 * i)) & 0xff);
+	}
+}
+
+uint64_t MappedFile::get_uint(const unsigned char * p,
+		unsigned int bytes) /* static */
+{
+	uint64_t v = 0;
+	for (unsigned int i=bytes; i>0; i--) {
+		v = (v << 8) | p[i-1];
+	}
+	return v;
+}
@@ -0,0 +1,61 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include "common.h"
+
+#include <stdio.h>
+
+#include <string>
+
+
+/*
+ * Read-only access to a whole file. The file is mapped into memory if
+ * possible, otherwise it is read completely.
+ *
+ * Also provides the little endian encoding used by the binary file
+ * formats.
+ */
+class MappedFile {
+      private:
+	FILE * fp;
+	const unsigned char * data;
+	size_t size;
+	bool mapped;
+
+      public:
+	MappedFile();
+	~MappedFile();
+
+      public:
+	bool open(const char * filename);
+
+	const unsigned char * get_data() const
+	{ return data; }
+
+	size_t get_size() const
+	{ return size; }
+
+	static void put_uint(std::string * buf, uint64_t v,
+			unsigned int bytes);
+	static uint64_t get_uint(const unsigned char * p, unsigned int bytes);
+};
+
+#endif // MAPPEDFILE_H
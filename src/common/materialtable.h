@@ -0,0 +1,140 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef MATERIALTABLE_H
+#define MATERIALTABLE_H
+
+#include "common.h"
+#include "board.h"
+
+
+/* Specialized evaluation of an endgame, returns the score from the
+ * point of view of the stronger side. */
+typedef int (* endgame_func)(const Board & board, Color strong);
+
+/*****************************************************************************
+ *
+ * Class MaterialEntry
+ *
+ *****************************************************************************/
+
+/*
+ * Everything the evaluation derives from the material signature alone,
+ * see Board::get_materialkey(). Filled by Evaluator::compute_material().
+ */
+class MaterialEntry
+{
+	friend class MaterialTable;
+
+      public:
+	/* draw scaling, applied to the score of the side that is ahead */
+	enum { SCALE_NORMAL = 64 };
+
+      private:
+	Hashkey key;
+	bool valid;
+
+      public:
+	int imbalance;		// material balance from white's view
+	unsigned int phase;	// see Evaluator::get_phase()
+	int phase_weight;	// see Evaluator::get_phase_weight()
+	uint8_t scale[2];	// 0 (draw) ... SCALE_NORMAL
+	endgame_func endgame;	// NULL if no specialized evaluation
+	Color strong;		// side that endgame is called for
+
+      public:
+	MaterialEntry()
+	{ valid = false; }
+
+      public:
+	inline bool is_normal() const;
+	inline int get_imbalance(Color side) const;
+	inline int scale_score(int score, Color side) const;
+};
+
+/*
+ * True if neither scaling nor a specialized evaluation applies.
+ */
+inline bool MaterialEntry::is_normal() const
+{
+	return endgame == NULL
+		&& scale[WHITE] == SCALE_NORMAL
+		&& scale[BLACK] == SCALE_NORMAL;
+}
+
+inline int MaterialEntry::get_imbalance(Color side) const
+{
+	return (side == WHITE) ? imbalance : -imbalance;
+}
+
+/*
+ * Scale a score from the point of view of side by the draw scaling
+ * factor of the side it favours.
+ */
+inline int MaterialEntry::scale_score(int score, Color side) const
+{
+	const Color favoured = (score > 0) ? side : XSIDE(side);
+	return score * scale[favoured] / SCALE_NORMAL;
+}
+
+/*****************************************************************************
+ *
+ * Class MaterialTable
+ *
+ *****************************************************************************/
+
+/*
+ * Small direct-mapped table indexed by the material signature. There are
+ * only a few hundred signatures in a typical search, so it is private to
+ * each Evaluator and needs no protection against concurrent writes.
+ */
+class MaterialTable
+{
+      private:
+	unsigned long table_size;
+	MaterialEntry * table;
+
+      public:
+	MaterialTable(unsigned long entries);
+	~MaterialTable();
+
+      public:
+	inline MaterialEntry * lookup(Hashkey key, bool * found);
+};
+
+/*
+ * Return the slot for key. If it holds another signature, it is claimed
+ * for key and *found is false; the caller must then fill it in.
+ */
+inline MaterialEntry * MaterialTable::lookup(Hashkey key, bool * found)
+{
+	/* The counts are packed into the low bits of the signature, so
+	 * mix them before reducing to the table size. */
+	const unsigned long idx = (unsigned long)
+		((key * 0x9e3779b97f4a7c15ULL) >> 40) % table_size;
+	MaterialEntry * e = &table[idx];
+
+	*found = (e->valid && e->key == key);
+	if (!*found) {
+		e->key = key;
+		e->valid = true;
+	}
+	return e;
+}
+
+#endif // MATERIALTABLE_H
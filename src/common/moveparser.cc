@@ -0,0 +1,312 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "moveparser.h"
+#include "basic.h"
+#include "movelist.h"
+
+#include <ctype.h>
+#include <string.h>
+
+
+signed char MoveParser::file_of[256];
+signed char MoveParser::rank_of[256];
+signed char MoveParser::piece_of[256];
+signed char MoveParser::promote_of[256];
+bool MoveParser::suffix[256];
+
+/*
+ * Build the character tables. Called by init().
+ */
+void MoveParser::init() /* static */
+{
+	memset(file_of, -1, sizeof(file_of));
+	memset(rank_of, -1, sizeof(rank_of));
+	memset(piece_of, -1, sizeof(piece_of));
+	memset(promote_of, -1, sizeof(promote_of));
+	memset(suffix, 0, sizeof(suffix));
+
+	for (unsigned int i=0; i<sizeof(file_char); i++) {
+		file_of[(unsigned char) file_char[i]] = i;
+	}
+	for (unsigned int i=0; i<sizeof(rank_char); i++) {
+		rank_of[(unsigned char) rank_char[i]] = i;
+	}
+	for (unsigned int i=0; i<sizeof(piece_char); i++) {
+		piece_of[(unsigned char) piece_char[i]] = i;
+	}
+#ifdef HOICHESS
+	/* lower case promotion piece in coordinate notation, e.g. e7e8q */
+	for (Piece ptype=KNIGHT; ptype<=QUEEN; ptype++) {
+		promote_of[tolower(piece_char[ptype])] = ptype;
+	}
+#endif
+
+	suffix[(unsigned char) '+'] = true;
+	suffix[(unsigned char) '#'] = true;
+	suffix[(unsigned char) '!'] = true;
+	suffix[(unsigned char) '?'] = true;
+}
+
+/*
+ * Parse a move in SAN or coordinate notation. Returns NO_MOVE if the
+ * input is invalid, illegal or ambiguous.
+ */
+Move MoveParser::parse(const Board & board, const char * str) /* static */
+{
+	struct token tok;
+	if (!tokenize(str, &tok)) {
+		return NO_MOVE;
+	}
+	return find(board, tok);
+}
+
+bool MoveParser::tokenize(const char * str, struct token * tok) /* static */
+{
+	tok->ptype = NO_PIECE;
+	tok->from_file = -1;
+	tok->from_rank = -1;
+	tok->to = NO_SQUARE;
+	tok->promote = NO_PIECE;
+	tok->castle = 0;
+
+	size_t len = strlen(str);
+	while (len > 0 && suffix[(unsigned char) str[len-1]]) {
+		len--;
+	}
+	if (len < 2) {
+		return false;
+	}
+
+	const unsigned char * p = (const unsigned char *) str;
+	const unsigned char * end = p + len;
+
+#ifdef HOICHESS
+	if (len == 3 && (strncmp(str, "O-O", 3) == 0
+				|| strncmp(str, "0-0", 3) == 0)) {
+		tok->castle = 1;
+		return true;
+	} else if (len == 5 && (strncmp(str, "O-O-O", 5) == 0
+				|| strncmp(str, "0-0-0", 5) == 0)) {
+		tok->castle = 2;
+		return true;
+	}
+
+	/* e8=Q, e8Q or e7e8q */
+	if (len >= 3 && (piece_of[end[-1]] >= 0 || promote_of[end[-1]] >= 0)
+			&& (end[-2] == '=' || rank_of[end[-2]] >= 0)) {
+		tok->promote = (piece_of[end[-1]] >= 0)
+			? piece_of[end[-1]] : promote_of[end[-1]];
+		end--;
+		if (end[-1] == '=') {
+			end--;
+		}
+	}
+#endif
+
+	if (piece_of[*p] >= 0) {
+		tok->ptype = piece_of[*p];
+		p++;
+	}
+
+	/* Destination square, then optional 'x' or '-' and the parts of
+	 * the origin square that are given. */
+	if (end - p < 2 || file_of[end[-2]] < 0 || rank_of[end[-1]] < 0) {
+		return false;
+	}
+	tok->to = SQUARE(rank_of[end[-1]], file_of[end[-2]]);
+	end -= 2;
+	if (end > p && (end[-1] == 'x' || end[-1] == '-' || end[-1] == ':')) {
+		end--;
+	}
+	if (end > p && rank_of[end[-1]] >= 0) {
+		tok->from_rank = rank_of[end[-1]];
+		end--;
+	}
+	if (end > p && file_of[end[-1]] >= 0) {
+		tok->from_file = file_of[end[-1]];
+		end--;
+	}
+	if (end != p) {
+		return false;
+	}
+
+	/* A move without piece letter is a pawn move, unless it is in
+	 * coordinate notation. */
+	if (tok->ptype == NO_PIECE
+			&& (tok->from_file < 0 || tok->from_rank < 0)) {
+		tok->ptype = PAWN;
+	}
+
+	return true;
+}
+
+/*
+ * Check the move from `from' to the destination. If it is legal, store
+ * it in *found. Returns false if *found was already set (ambiguous).
+ */
+bool MoveParser::try_move(const Board & board, const struct token & tok,
+		Square from, Move * found) /* static */
+{
+	const Piece ptype = board.piece_at(from);
+	if (ptype == NO_PIECE || board.color_at(from) != board.get_side()
+			|| (tok.ptype != NO_PIECE && ptype != tok.ptype)) {
+		return true;
+	}
+
+#ifdef HOICHESS
+	const Move mov = Move::autoselect(board, from, tok.to, tok.promote);
+	if (mov.is_promotion() ? tok.promote == NO_PIECE
+			: tok.promote != NO_PIECE) {
+		return true;
+	}
+#else
+	const Piece cap_ptype = board.piece_at(tok.to);
+	const Move mov = (cap_ptype != NO_PIECE)
+		? Move::capture(from, tok.to, ptype, cap_ptype)
+		: Move::normal(from, tok.to, ptype);
+#endif
+
+	if (!board.is_valid_move(mov) || !board.is_legal_move(mov)) {
+		return true;
+	} else if (*found) {
+		return false;
+	}
+
+	*found = mov;
+	return true;
+}
+
+#if defined(HOICHESS)
+
+Move MoveParser::find(const Board & board, const struct token & tok) /* static */
+{
+	const Color side = board.get_side();
+	Move found = NO_MOVE;
+
+	if (tok.castle) {
+		const Square from = (side == WHITE) ? E1 : E8;
+		const Square to = from + ((tok.castle == 1) ? 2 : -2);
+		const Move mov = Move::castle(from, to);
+		if (board.is_valid_move(mov) && board.is_legal_move(mov)) {
+			return mov;
+		}
+		return NO_MOVE;
+	} else if (tok.from_file >= 0 && tok.from_rank >= 0) {
+		try_move(board, tok, SQUARE(tok.from_rank, tok.from_file),
+				&found);
+		return found;
+	}
+
+	/* origin squares from the attack tables */
+	const Square to = tok.to;
+	Bitboard from_bb;
+	switch (tok.ptype) {
+	case PAWN:
+		from_bb = Bitboard::pawn_capt_bb[XSIDE(side)][to];
+		if (side == WHITE && to >= A3) {
+			from_bb.setbit(to - 8);
+			if (RNK(to) == RANK4) {
+				from_bb.setbit(to - 16);
+			}
+		} else if (side == BLACK && to <= H6) {
+			from_bb.setbit(to + 8);
+			if (RNK(to) == RANK5) {
+				from_bb.setbit(to + 16);
+			}
+		}
+		from_bb &= board.get_pawns(side);
+		break;
+	case KNIGHT:
+		from_bb = board.knight_attacks(to) & board.get_knights(side);
+		break;
+	case BISHOP:
+		from_bb = board.bishop_attacks(to) & board.get_bishops(side);
+		break;
+	case ROOK:
+		from_bb = board.rook_attacks(to) & board.get_rooks(side);
+		break;
+	case QUEEN:
+		from_bb = board.queen_attacks(to) & board.get_queens(side);
+		break;
+	case KING:
+		from_bb = board.king_attacks(to) & board.get_kings(side);
+		break;
+	default:
+		return NO_MOVE;
+	}
+
+	if (tok.from_file >= 0) {
+		from_bb &= Bitboard::file[tok.from_file];
+	}
+	if (tok.from_rank >= 0) {
+		from_bb &= Bitboard::rank[tok.from_rank];
+	}
+
+	while (from_bb) {
+		const Square from = from_bb.firstbit();
+		from_bb.clearbit(from);
+		if (!try_move(board, tok, from, &found)) {
+			return NO_MOVE;
+		}
+	}
+
+	return found;
+}
+
+#elif defined(HOIXIANGQI)
+
+Move MoveParser::find(const Board & board, const struct token & tok) /* static */
+{
+	Move found = NO_MOVE;
+
+	if (tok.from_file >= 0 && tok.from_rank >= 0) {
+		try_move(board, tok, SQUARE(tok.from_rank, tok.from_file),
+				&found);
+		return found;
+	}
+
+	/* Only moves that can match need to be generated. */
+	Movelist movelist;
+	if (board.piece_at(tok.to) != NO_PIECE) {
+		board.generate_captures(&movelist);
+	} else {
+		board.generate_noncaptures(&movelist);
+	}
+
+	for (unsigned int i=0; i<movelist.size(); i++) {
+		const Square from = movelist[i].from();
+		if (movelist[i].to() != tok.to) {
+			continue;
+		} else if (tok.from_file >= 0 && FIL(from) != tok.from_file) {
+			continue;
+		} else if (tok.from_rank >= 0 && RNK(from) != tok.from_rank) {
+			continue;
+		} else if (!try_move(board, tok, from, &found)) {
+			return NO_MOVE;
+		}
+	}
+
+	return found;
+}
+
+#else
+# error "neither HOICHESS nor HOIXIANGQI defined"
+#endif
@@ -0,0 +1,76 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef MOVEPARSER_H
+#define MOVEPARSER_H
+
+#include "common.h"
+#include "board.h"
+#include "move.h"
+
+#include <string>
+
+
+/*
+ * Fast move parser for bulk imports.
+ *
+ * The input is split into piece, origin file and rank, destination and
+ * promotion piece by looking up each character in tables built from
+ * piece_char[], file_char[] and rank_char[]; no strings are allocated.
+ * The origin squares that fit these tokens are then taken from the
+ * attack tables of the board (in HoiChess) or, if the origin is not
+ * given completely, from the generated captures or non-captures
+ * (in HoiXiangqi). Only these candidate moves are checked for validity
+ * and legality.
+ *
+ * SAN (with or without 'x', '+', '#' and superfluous disambiguation)
+ * and coordinate notation are accepted, in HoiChess also "0-0" and
+ * promotions without '='. Ambiguous input gives NO_MOVE.
+ */
+class MoveParser {
+      private:
+	struct token {
+		Piece ptype;		/* NO_PIECE if unknown */
+		int from_file;		/* -1 if not given */
+		int from_rank;		/* -1 if not given */
+		Square to;
+		Piece promote;
+		int castle;		/* 0, 1 = short, 2 = long */
+	};
+
+	static signed char file_of[256];
+	static signed char rank_of[256];
+	static signed char piece_of[256];
+	static signed char promote_of[256];
+	static bool suffix[256];
+
+      public:
+	static void init();
+
+	static Move parse(const Board & board, const char * str);
+	static Move parse(const Board & board, const std::string & str)
+	{ return parse(board, str.c_str()); }
+
+      private:
+	static bool tokenize(const char * str, struct token * tok);
+	static Move find(const Board & board, const struct token & tok);
+	static bool try_move(const Board & board, const struct token & tok,
+			Square from, Move * found);
+};
+
+#endif // MOVEPARSER_H
@@ -36,6 +36,7 @@
 
 Node::Node()
 {
+	_allocator = NULL;
 	parent = NULL;
 	root = NULL;
 
@@ -46,10 +47,13 @@ Node::Node()
 	
 Node::Node(const Board& _board)
 {
+	_allocator = NULL;
 	parent = NULL;
 	root = NULL;
 
 	board = _board;
+	incheck = board.in_check();
+	material = board.material_difference();
 
 	historytable = NULL;
 	pvline.nmoves = 0;
@@ -231,6 +235,9 @@ void Node::score_moves()
 	if (type == ROOT)
 		return;
 
+	Move countermove = historytable ?
+		historytable->get_countermove(played_move) : NO_MOVE;
+
 	for (unsigned int i=current_move_no+1; i<movelist.size(); i++) {
 		int score = 0;
 		Move mov = movelist[i];
@@ -269,9 +276,10 @@ void Node::score_moves()
 			/* non-captures */
 			if (mov == killer1 || mov == killer2) {
 				score = 700000;
-			}
-			if (historytable) {
-				score += MIN(historytable->get(mov), 100000);
+			} else if (mov == countermove) {
+				score = 650000;
+			} else if (historytable) {
+				score = historytable->get(mov, played_move);
 			}
 		}
 		movelist.set_score(i, score);
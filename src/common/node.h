@@ -143,6 +143,7 @@ class Node {
 
 	inline void set_historytable(HistoryTable * ht);
 	inline void add_killer(Move mov);
+	inline bool is_killer(Move mov) const;
 	inline Move get_played_move() const;
 
       public:
@@ -268,6 +269,11 @@ inline void Node::add_killer(Move mov)
 	}
 }
 
+inline bool Node::is_killer(Move mov) const
+{
+	return (mov == killer1 || mov == killer2);
+}
+
 inline Move Node::get_played_move() const
 {
 	return played_move;
@@ -43,6 +43,8 @@ ParallelSearch::ParallelSearch(Shell * shell, unsigned int nthreads)
 	}
 
 	shared_hashtable = NULL;
+	shared_pawnhashtable = NULL;
+	shared_evalcache = NULL;
 }
 
 ParallelSearch::~ParallelSearch()
@@ -53,6 +55,8 @@ ParallelSearch::~ParallelSearch()
 	}
 
 	delete shared_hashtable;
+	delete shared_pawnhashtable;
+	delete shared_evalcache;
 }
 
 /*****************************************************************************
@@ -240,6 +244,8 @@ int ParallelSearch::parallel_search(Node * node, unsigned int ply,
 	int score;
 	int bestscore = -INFTY;
 	int moves = 0;
+	Move quiets[SEARCH_MAX_QUIETS]; /* quiet moves searched so far */
+	unsigned int nquiets = 0;
 
 	nodes_fullwidth++;
 	
@@ -251,22 +257,9 @@ int ParallelSearch::parallel_search(Node * node, unsigned int ply,
 		return score;
 	}
 
-	/* Null-move forward pruning */
-	bool null_ok = !(node->get_parent()->get_played_move().is_null())
-		    && !(Evaluator::get_phase(node->get_board())
-				   == Evaluator::ENDGAME);
-	if (!node->in_check() && null_ok) {
-		Node * child = node->make_move(Move::null(), &nodealloc);
-		score = -search(child, ply+1, depth-2-1, 0, -beta, -beta+1);
-		child->free();
-		if (score >= beta) {
-			stat_nullcut++;
-			if (failsoft) {
-				return score;
-			} else {
-				return beta; /* fail hard */
-			}
-		}
+	/* Static null-move and null-move forward pruning */
+	if (null_move_prune(node, ply, depth, alpha, beta, &score)) {
+		return score;
 	}
 
 	/*
@@ -307,6 +300,10 @@ int ParallelSearch::parallel_search(Node * node, unsigned int ply,
 				score, alpha, beta);
 	}
 
+	if (is_quiet_move(mov)) {
+		quiets[nquiets++] = mov;
+	}
+
 	check_time(true, false);
 	if (stop) {
 		child->free();
@@ -432,6 +429,10 @@ int ParallelSearch::parallel_search(Node * node, unsigned int ply,
 			continue;
 		}
 
+		if (is_quiet_move(slave_mov) && nquiets < SEARCH_MAX_QUIETS) {
+			quiets[nquiets++] = slave_mov;
+		}
+
 		/* check for alpha not possible because alpha may have been
 		 * improved since the slave was started */
 		if (!failsoft && score > beta && !stop) {
@@ -491,7 +492,9 @@ done:
 		store_hashtable(node, depth, save_alpha, beta, alpha);
 	}
 	
-	add_history(node);
+	if (bestscore > save_alpha) {
+		add_history(node, depth, quiets, nquiets);
+	}
 	add_killer(node);
 
 	stat_moves_sum += moves;
@@ -629,17 +632,41 @@ void ParallelSearch::clear_hash()
 
 void ParallelSearch::set_pawnhash_size(size_t bytes)
 {
-	/* We distribute the given size equally among all slaves.
-	 * Of course, the master does not get a pawn hash. */
+	/* Of course, the master does not get a pawn hash. */
 	unsigned int nslaves = slaves.size();
-	size_t bytes1 = bytes / nslaves;
-	for (unsigned int i=0; i<nslaves; i++) {
-		slaves[i].search->set_pawnhash_size(bytes1);
+
+	if (SHOPT(search_parallel_shared_pawnhash) && bytes > 0) {
+		/* One table of the full size for all slaves. Entries are
+		 * verified on probe, so no locking is necessary. The old
+		 * table is deleted only after the slaves have released
+		 * it. */
+		PawnHashTable * old = shared_pawnhashtable;
+		shared_pawnhashtable = new PawnHashTable(bytes);
+		shared_pawnhashtable->print_info();
+		for (unsigned int i=0; i<nslaves; i++) {
+			slaves[i].search->set_pawnhash_table(
+					shared_pawnhashtable);
+		}
+		delete old;
+	} else {
+		/* We distribute the given size equally among all
+		 * slaves. */
+		size_t bytes1 = bytes / nslaves;
+		for (unsigned int i=0; i<nslaves; i++) {
+			slaves[i].search->set_pawnhash_size(bytes1);
+		}
+		delete shared_pawnhashtable;
+		shared_pawnhashtable = NULL;
 	}
 }
 
 void ParallelSearch::clear_pawnhash()
 {
+	if (shared_pawnhashtable) {
+		shared_pawnhashtable->clear();
+		return;
+	}
+
 	unsigned int nslaves = slaves.size();
 	for (unsigned int i=0; i<nslaves; i++) {
 		slaves[i].search->clear_pawnhash();
@@ -648,23 +675,62 @@ void ParallelSearch::clear_pawnhash()
 
 void ParallelSearch::set_evalcache_size(size_t bytes)
 {
-	/* We distribute the given size equally among all slaves.
-	 * Of course, the master does not get an evaluation cache. */
+	/* Of course, the master does not get an evaluation cache. */
 	unsigned int nslaves = slaves.size();
-	size_t bytes1 = bytes / nslaves;
-	for (unsigned int i=0; i<nslaves; i++) {
-		slaves[i].search->set_evalcache_size(bytes1);
+
+	if (SHOPT(search_parallel_shared_evalcache) && bytes > 0) {
+		/* see set_pawnhash_size() */
+		EvaluationCache * old = shared_evalcache;
+		shared_evalcache = new EvaluationCache(bytes);
+		shared_evalcache->print_info();
+		for (unsigned int i=0; i<nslaves; i++) {
+			slaves[i].search->set_evalcache_table(
+					shared_evalcache);
+		}
+		delete old;
+	} else {
+		/* We distribute the given size equally among all
+		 * slaves. */
+		size_t bytes1 = bytes / nslaves;
+		for (unsigned int i=0; i<nslaves; i++) {
+			slaves[i].search->set_evalcache_size(bytes1);
+		}
+		delete shared_evalcache;
+		shared_evalcache = NULL;
 	}
 }
 
 void ParallelSearch::clear_evalcache()
 {
+	if (shared_evalcache) {
+		shared_evalcache->clear();
+		return;
+	}
+
 	unsigned int nslaves = slaves.size();
 	for (unsigned int i=0; i<nslaves; i++) {
 		slaves[i].search->clear_evalcache();
 	}
 }
 
+void ParallelSearch::age_history()
+{
+	Search::age_history();
+	unsigned int nslaves = slaves.size();
+	for (unsigned int i=0; i<nslaves; i++) {
+		slaves[i].search->age_history();
+	}
+}
+
+void ParallelSearch::clear_history()
+{
+	Search::clear_history();
+	unsigned int nslaves = slaves.size();
+	for (unsigned int i=0; i<nslaves; i++) {
+		slaves[i].search->clear_history();
+	}
+}
+
 /*****************************************************************************
  *
  * Search statistics.
@@ -685,9 +751,46 @@ void ParallelSearch::print_statistics()
 			slaves[i].search->print_statistics();		
 		}
 	}
+
+	/* Hit statistics of the shared tables, summed up over all
+	 * slaves. */
+	if (shared_pawnhashtable || shared_evalcache) {
+		unsigned long pawnhash_probes = 0, pawnhash_hits = 0;
+		unsigned long evalcache_probes = 0, evalcache_hits = 0;
+		for (unsigned int i=0; i<slaves.size(); i++) {
+			unsigned long pp, ph, ep, eh;
+			slaves[i].search->get_cache_statistics(&pp, &ph,
+					&ep, &eh);
+			pawnhash_probes += pp;
+			pawnhash_hits += ph;
+			evalcache_probes += ep;
+			evalcache_hits += eh;
+		}
+		printf(INFO_PRFX "--- shared tables ---\n");
+		if (shared_pawnhashtable) {
+			printf(INFO_PRFX "shared_pawnhash_probes=%lu"
+					" shared_pawnhash_hits=%lu\n",
+					pawnhash_probes, pawnhash_hits);
+		}
+		if (shared_evalcache) {
+			printf(INFO_PRFX "shared_evalcache_probes=%lu"
+					" shared_evalcache_hits=%lu\n",
+					evalcache_probes, evalcache_hits);
+		}
+	}
 	printf(INFO_PRFX "==================================\n");
 }
 
+void ParallelSearch::print_evalprofile()
+{
+	printf(INFO_PRFX "--- master ---\n");
+	Search::print_evalprofile();
+	for (unsigned int i=0; i<slaves.size(); i++) {
+		printf(INFO_PRFX "--- slave %u ---\n", i);
+		slaves[i].search->print_evalprofile();
+	}
+}
+
 void ParallelSearch::reset_statistics()
 {
 	Search::reset_statistics();
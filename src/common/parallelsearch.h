@@ -43,6 +43,8 @@ class ParallelSearch : public Search
 	std::vector<struct slave> slaves;
       private:
 	HashTable * shared_hashtable;
+	PawnHashTable * shared_pawnhashtable;
+	EvaluationCache * shared_evalcache;
 
       private:
 	Queue<unsigned int> ready_queue; /* stores slave index */
@@ -83,10 +85,13 @@ class ParallelSearch : public Search
 	virtual void clear_pawnhash();
 	virtual void set_evalcache_size(size_t bytes);
 	virtual void clear_evalcache();
+	virtual void age_history();
+	virtual void clear_history();
 
       public:
 	virtual void print_statistics();
 	virtual void reset_statistics();
+	virtual void print_evalprofile();
 };
 
 #endif // PARALLELSEARCH_H
@@ -38,8 +38,6 @@ PawnHashTable::PawnHashTable(size_t bytes)
 	}
 
 	table = new PawnHashEntry[table_size];
-
-	reset_statistics();
 }
 
 PawnHashTable::~PawnHashTable()
@@ -51,32 +49,33 @@ void PawnHashTable::clear()
 {
 	delete[] table;
 	table = new PawnHashEntry[table_size];
-
-	reset_statistics();
 }
 
 bool PawnHashTable::put(const PawnHashEntry & entry)
 {
 	const unsigned long key = entry.hashkey % table_size;
 
-	table[key] = entry;
+	PawnHashEntry e = entry;
+	e.hashkey ^= entry.checksum();
+	table[key] = e;
 	return true;
 }
 
 bool PawnHashTable::probe(Hashkey hashkey, PawnHashEntry * entry)
 {
-	stat_probes++;
-
 	const unsigned long key = hashkey % table_size;
-	const PawnHashEntry & e = table[key];
+
+	/* Work on a copy, the slot may be overwritten by another thread
+	 * meanwhile. */
+	PawnHashEntry e = table[key];
 	
-	if (e.phase == -1 || e.hashkey != hashkey) {
+	if (e.phase == -1 || (e.hashkey ^ e.checksum()) != hashkey) {
 		entry->phase = -1;
 		return false;
 	}
 
+	e.hashkey = hashkey;
 	*entry = e;
-	stat_hits++;
 	return true;
 }
 
@@ -87,17 +86,3 @@ void PawnHashTable::print_info(FILE * fp) const
 			table_size,
 			(unsigned long) (table_size * sizeof(PawnHashEntry)));
 }
-
-void PawnHashTable::print_statistics(FILE * fp) const
-{
-	fprintf(fp, INFO_PRFX "pawnhash_probes=%lu"
-			" pawnhash_hits=%lu pawnhash_hits2=%lu\n",
-			stat_probes, stat_hits, stat_hits2);
-}
-
-void PawnHashTable::reset_statistics()
-{
-	stat_probes = 0;
-	stat_hits = 0;
-	stat_hits2 = 0;
-}
@@ -37,8 +37,8 @@ class PawnHashEntry
 
       private:
 	Hashkey hashkey;
-	int phase;
-	int score[2];
+	int phase;		// phase when stored, -1 if empty
+	int score[2];		// midgame/endgame pairs, see SCORE()
 #ifdef HOICHESS
 	Bitboard passed[2];
 #endif // HOICHESS
@@ -60,6 +60,9 @@ class PawnHashEntry
 	inline Bitboard get_passed(Color side) const;
 	inline void set_passed(Color side, Bitboard bb);
 #endif // HOICHESS
+
+      private:
+	inline Hashkey checksum() const;
 };
 
 inline PawnHashEntry::PawnHashEntry()
@@ -108,6 +111,23 @@ inline void PawnHashEntry::set_score(Color side, int score)
 	this->score[side] = score;
 }
 
+/*
+ * Checksum over the entry's data. PawnHashTable stores the hash key XORed
+ * with it, so that entries written concurrently by another thread fail
+ * verification. See also EvaluationCache.
+ */
+inline Hashkey PawnHashEntry::checksum() const
+{
+	Hashkey sum = (Hashkey) (uint32_t) score[WHITE]
+		| ((Hashkey) (uint32_t) score[BLACK] << 32);
+	sum ^= (Hashkey) (uint32_t) phase << 16;
+#ifdef HOICHESS
+	const uint64_t pb = passed[BLACK];
+	sum ^= (uint64_t) passed[WHITE] ^ ((pb << 32) | (pb >> 32));
+#endif // HOICHESS
+	return sum;
+}
+
 #ifdef HOICHESS
 inline Bitboard PawnHashEntry::get_passed(Color side) const
 {
@@ -132,10 +152,6 @@ class PawnHashTable
 	unsigned long table_size;
 	PawnHashEntry * table;
 
-	unsigned long stat_probes;
-	unsigned long stat_hits;
-	unsigned long stat_hits2;
-
       public:
 	PawnHashTable(size_t bytes);
 	~PawnHashTable();
@@ -144,16 +160,8 @@ class PawnHashTable
 	void clear();
 	bool put(const PawnHashEntry & entry);
 	bool probe(Hashkey hashkey, PawnHashEntry * entry);	
-	inline void incr_hits2();
 
 	void print_info(FILE * fp = stdout) const;
-	void print_statistics(FILE * fp = stdout) const;
-	void reset_statistics();
 };
 
-inline void PawnHashTable::incr_hits2()
-{
-	stat_hits2++;
-}
-
 #endif // HASHPAWN_H
@@ -19,6 +19,7 @@
 
 #include "common.h"
 #include "game.h"
+#include "moveparser.h"
 #include "pgn.h"
 #include "util.h"
 
@@ -33,20 +34,57 @@
 //#define DEBUG_PGN_PARSE_2
 
 
+/*
+ * Like fgets().
+ */
+char * PGNInput::gets(char * buf, size_t bufsize)
+{
+	if (fp) {
+		return fgets(buf, bufsize, fp);
+	}
+
+	ASSERT(bufsize > 1);
+	if (p == end) {
+		at_eof = true;
+		return NULL;
+	}
+
+	char * q = buf;
+	while (p != end && q != buf + bufsize-1) {
+		if ((*q++ = *p++) == '\n') {
+			break;
+		}
+	}
+	*q = '\0';
+	return buf;
+}
+
+
 PGN::PGN()
 {
 }
 
+std::string PGN::get_tag(const std::string & tag) const
+{
+	std::map<std::string, std::string>::const_iterator it = tags.find(tag);
+	return (it != tags.end()) ? it->second : "";
+}
+
 bool PGN::parse(FILE * fp)
 {
 	ASSERT(fp != NULL);
+	PGNInput in(fp);
+	return parse(in);
+}
 
+bool PGN::parse(PGNInput & in)
+{
 	char buf[1024];
 	char * strtok_r_buf;
 
 	/* First, dischard everything up to the next tag */
-	while (!feof(fp)) {
-		if (fgets(buf, sizeof(buf), fp) == NULL) {
+	while (!in.eof()) {
+		if (in.gets(buf, sizeof(buf)) == NULL) {
 			return false;
 		}
 
@@ -57,7 +95,7 @@ bool PGN::parse(FILE * fp)
 
 	/* Read all tags until the next empty line.
 	 * One tag line is already in buf. */
-	while (!feof(fp)) {
+	while (!in.eof()) {
 #ifdef DEBUG_PGN_PARSE_1
 		printf("%s", buf);
 #endif		
@@ -106,7 +144,7 @@ bool PGN::parse(FILE * fp)
 		tags[tag] = val;
 
 		/* Read next tag line */
-		if (fgets(buf, sizeof(buf), fp) == NULL) {
+		if (in.gets(buf, sizeof(buf)) == NULL) {
 			return false;
 		}
 	}
@@ -127,8 +165,8 @@ bool PGN::parse(FILE * fp)
 	 */
 	Board board = opening;
 	std::string tok;
-	while (!feof(fp)) {
-		char * p = get_movetext_token(fp, buf, sizeof(buf));
+	while (!in.eof()) {
+		char * p = get_movetext_token(in, buf, sizeof(buf));
 		if (!p || !*p) {
 			continue;
 		}
@@ -169,7 +207,7 @@ bool PGN::parse(FILE * fp)
 			printf("move: %s\n", tok.c_str());
 #endif
 			
-			Move mov = board.parse_move_1(tok);
+			Move mov = MoveParser::parse(board, tok);
 			if (!mov) {
 				if (debug) {
 					/* TODO Perhaps we should print some
@@ -181,6 +219,7 @@ bool PGN::parse(FILE * fp)
 				return false;
 			}
 			moves.push_back(mov);
+			hashkeys.push_back(board.get_hashkey());
 			board.make_move(mov);
 		}
 	}
@@ -191,12 +230,18 @@ bool PGN::parse(FILE * fp)
 char * PGN::get_movetext_token(FILE * fp, char * buf, size_t bufsize)
 {
 	ASSERT(fp != NULL);
+	PGNInput in(fp);
+	return get_movetext_token(in, buf, bufsize);
+}
+
+char * PGN::get_movetext_token(PGNInput & in, char * buf, size_t bufsize)
+{
 	char * p = buf;
 
 	bool comment = false;
 		
-	while (!feof(fp) && p != buf + bufsize-1) {
-		int c = fgetc(fp);
+	while (!in.eof() && p != buf + bufsize-1) {
+		int c = in.getc();
 		if (c == EOF) {
 			break;
 		} else if (c == '\n' || c == '\r') {
@@ -23,16 +23,64 @@
 #include "board.h"
 #include "move.h"
 
+#include <stdio.h>
+
 #include <map>
 #include <list>
 #include <string>
+#include <vector>
+
+
+/*
+ * Input of PGN::parse(), either a stdio stream or a buffer in memory,
+ * e.g. a chunk of a file parsed by PGNPipeline. eof() behaves like
+ * feof(), i.e. it becomes true only after a read hit the end.
+ */
+class PGNInput {
+      private:
+	FILE * fp;
+	const char * p;
+	const char * end;
+	bool at_eof;
 
+      public:
+	PGNInput(FILE * _fp)
+		: fp(_fp), p(NULL), end(NULL), at_eof(false) {}
+	PGNInput(const char * buf, size_t len)
+		: fp(NULL), p(buf), end(buf + len), at_eof(false) {}
+
+      public:
+	inline bool eof() const;
+	inline int getc();
+	char * gets(char * buf, size_t bufsize);
+};
+
+inline bool PGNInput::eof() const
+{
+	return fp ? feof(fp) : at_eof;
+}
+
+inline int PGNInput::getc()
+{
+	if (fp) {
+		return fgetc(fp);
+	} else if (p == end) {
+		at_eof = true;
+		return EOF;
+	} else {
+		return (unsigned char) *p++;
+	}
+}
 
 class PGN {
+	friend class GameDB;
+
       private:
 	Board opening;
 	std::map<std::string, std::string> tags;
 	std::list<Move> moves;
+	std::vector<Hashkey> hashkeys;	/* of the position before each
+					 * move */
 
       public:
 	PGN();
@@ -42,12 +90,23 @@ class PGN {
 	Board get_opening() const
 	{ return opening; }
 
-	std::list<Move> get_moves() const
+	const std::list<Move> & get_moves() const
 	{ return moves; }
 
+	const std::vector<Hashkey> & get_hashkeys() const
+	{ return hashkeys; }
+
+	const std::map<std::string, std::string> & get_tags() const
+	{ return tags; }
+
+	std::string get_tag(const std::string & tag) const;
+
 	bool parse(FILE * fp);
+	bool parse(PGNInput & in);
 
 	static char * get_movetext_token(FILE * fp, char * buf, size_t bufsize);
+	static char * get_movetext_token(PGNInput & in, char * buf,
+			size_t bufsize);
 	static std::list<PGN> parse_all(FILE * fp);
 	static std::list<PGN> parse_all(const char * filename);
 };
@@ -0,0 +1,312 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "pgnpipeline.h"
+#ifdef WITH_THREAD
+# include "queue.h"
+# include "thread.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <map>
+
+
+#ifdef WITH_THREAD
+struct PGNPipeline::queues {
+	Queue<struct chunk *> todo;	/* NULL tells a worker to quit */
+	Queue<struct chunk *> done;
+};
+#endif
+
+/*
+ * Return the position of the last game boundary in s, i.e. of a '['
+ * at the beginning of a line that follows an empty line, or
+ * std::string::npos if there is none.
+ */
+static size_t find_boundary(const std::string & s)
+{
+	size_t pos = s.size();
+	while (pos > 0) {
+		pos = s.rfind("\n[", pos - 1);
+		if (pos == std::string::npos) {
+			break;
+		}
+
+		/* is the line before empty, except for whitespace? */
+		size_t i = pos;
+		while (i > 0 && (s[i-1] == '\r' || s[i-1] == ' '
+					|| s[i-1] == '\t')) {
+			i--;
+		}
+		if (i > 0 && s[i-1] == '\n') {
+			return pos + 1;
+		}
+	}
+	return std::string::npos;
+}
+
+
+/*****************************************************************************
+ *
+ * Member functions of class PGNPipeline.
+ *
+ *****************************************************************************/
+
+PGNPipeline::PGNPipeline(unsigned int nthreads, bool ordered,
+		size_t chunk_size)
+{
+#ifdef WITH_THREAD
+	this->nthreads = (nthreads > 0) ? nthreads : 1;
+#else
+	this->nthreads = 1;
+#endif
+	this->ordered = ordered;
+	this->chunk_size = (chunk_size > 0) ? chunk_size : 1;
+
+	games = 0;
+	skipped = 0;
+	bytes = 0;
+	usecs = 0;
+}
+
+/*
+ * Read all games from filename and pass them to consumer. Returns false
+ * if the file cannot be opened.
+ */
+bool PGNPipeline::run(const char * filename, PGNConsumer * consumer,
+		bool show_progress)
+{
+	FILE * fp = fopen(filename, "r");
+	if (!fp) {
+		printf("Cannot open %s for reading: %s\n",
+				filename, strerror(errno));
+		return false;
+	}
+
+	games = 0;
+	skipped = 0;
+	bytes = 0;
+
+	struct timeval tv_start, tv_end;
+	gettimeofday(&tv_start, NULL);
+
+	std::string carry;
+
+	if (nthreads == 1) {
+		for (unsigned long seq = 0; ; seq++) {
+			struct chunk * c = new struct chunk;
+			c->seq = seq;
+			if (!read_chunk(fp, &carry, c)) {
+				delete c;
+				break;
+			}
+			parse_chunk(c);
+			deliver(c, consumer, show_progress);
+		}
+	}
+#ifdef WITH_THREAD
+	else {
+		struct queues q;
+		std::vector<Thread *> threads;
+		for (unsigned int t=0; t<nthreads; t++) {
+			Thread * thread = new Thread(worker_main);
+			thread->start(&q);
+			threads.push_back(thread);
+		}
+
+		/* Chunks finished out of order wait here if ordered. A
+		 * chunk counts as in flight from reading until it has been
+		 * delivered, so the pending ones are bounded as well. The
+		 * next one to deliver has always been read, so there is
+		 * room for it. */
+		std::map<unsigned long, struct chunk *> pending;
+		unsigned long next_seq = 0, next_deliver = 0;
+		unsigned int in_flight = 0;
+		const unsigned int max_in_flight = 2 * nthreads;
+		bool more = true;
+
+		for (;;) {
+			while (more && in_flight < max_in_flight) {
+				struct chunk * c = new struct chunk;
+				c->seq = next_seq;
+				if (!read_chunk(fp, &carry, c)) {
+					delete c;
+					more = false;
+					break;
+				}
+				next_seq++;
+				in_flight++;
+				q.todo.put(c);
+			}
+			if (in_flight == 0) {
+				break;
+			}
+
+			struct chunk * c = q.done.get();
+			if (!ordered) {
+				deliver(c, consumer, show_progress);
+				in_flight--;
+				continue;
+			}
+
+			pending[c->seq] = c;
+			std::map<unsigned long, struct chunk *>::iterator it;
+			while ((it = pending.find(next_deliver))
+					!= pending.end()) {
+				deliver(it->second, consumer, show_progress);
+				pending.erase(it);
+				next_deliver++;
+				in_flight--;
+			}
+		}
+		ASSERT(pending.empty());
+
+		for (size_t t=0; t<threads.size(); t++) {
+			q.todo.put(NULL);
+		}
+		for (size_t t=0; t<threads.size(); t++) {
+			threads[t]->wait();
+			delete threads[t];
+		}
+	}
+#endif
+
+	fclose(fp);
+
+	gettimeofday(&tv_end, NULL);
+	usecs = (tv_end.tv_sec - tv_start.tv_sec) * 1000000ULL
+		+ tv_end.tv_usec - tv_start.tv_usec;
+
+	if (show_progress) {
+		printf("\n");
+	}
+	return true;
+}
+
+void PGNPipeline::print_statistics(FILE * fp) const
+{
+	const double secs = usecs / 1000000.0;
+	fprintf(fp, "Reading PGN: %lu games read, "
+			"%lu games skipped due to errors\n",
+			games, skipped);
+	fprintf(fp, "%.1f MB in %.2f s with %u thread%s, "
+			"%.0f games/s, %.1f MB/s\n",
+			bytes / 1048576.0, secs,
+			nthreads, (nthreads == 1) ? "" : "s",
+			secs > 0 ? games / secs : 0.0,
+			secs > 0 ? bytes / 1048576.0 / secs : 0.0);
+}
+
+/*
+ * Read the next chunk of about chunk_size bytes, ending at a game
+ * boundary. Text after the boundary is kept in carry for the next
+ * chunk. A single game longer than chunk_size makes the chunk grow
+ * until its end is found. Returns false at the end of the file.
+ */
+bool PGNPipeline::read_chunk(FILE * fp, std::string * carry,
+		struct chunk * c)
+{
+	c->text.swap(*carry);
+	carry->clear();
+	c->skipped = 0;
+
+	std::vector<char> buf(chunk_size);
+	for (;;) {
+		const size_t n = fread(&buf[0], 1, buf.size(), fp);
+		if (n == 0) {
+			if (ferror(fp)) {
+				perror("PGNPipeline: fread() failed");
+				exit(EXIT_FAILURE);
+			}
+			/* end of file, take the rest */
+			return !c->text.empty();
+		}
+		c->text.append(&buf[0], n);
+		bytes += n;
+
+		const size_t pos = find_boundary(c->text);
+		if (pos != std::string::npos) {
+			carry->assign(c->text, pos, std::string::npos);
+			c->text.resize(pos);
+			return true;
+		}
+	}
+}
+
+/*
+ * Hand the games of a parsed chunk to the consumer and free it.
+ */
+void PGNPipeline::deliver(struct chunk * c, PGNConsumer * consumer,
+		bool show_progress)
+{
+	for (size_t i=0; i<c->games.size(); i++) {
+		consumer->consume(c->games[i]);
+	}
+
+	games += c->games.size();
+	skipped += c->skipped;
+	delete c;
+
+	if (show_progress) {
+		printf("Reading PGN: %lu games read, "
+				"%lu games skipped due to errors\r",
+				games, skipped);
+		fflush(stdout);
+	}
+}
+
+/*
+ * Parse all games of a chunk. The text is not needed afterwards.
+ */
+void PGNPipeline::parse_chunk(struct chunk * c) /* static */
+{
+	PGNInput in(c->text.data(), c->text.size());
+	while (!in.eof()) {
+		c->games.push_back(PGN());
+		if (!c->games.back().parse(in)) {
+			c->games.pop_back();
+			if (!in.eof()) {
+				c->skipped++;
+			}
+		}
+	}
+
+	std::string().swap(c->text);
+}
+
+#ifdef WITH_THREAD
+void * PGNPipeline::worker_main(void * arg) /* static */
+{
+	struct queues * q = (struct queues *) arg;
+	for (;;) {
+		struct chunk * c = q->todo.get();
+		if (!c) {
+			break;
+		}
+		parse_chunk(c);
+		q->done.put(c);
+	}
+	return NULL;
+}
+#endif
@@ -0,0 +1,105 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef PGNPIPELINE_H
+#define PGNPIPELINE_H
+
+#include "common.h"
+#include "pgn.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+
+/*
+ * Receives the games read by PGNPipeline::run(). consume() is always
+ * called from the thread that called run(), one game at a time, so it
+ * needs no locking.
+ */
+class PGNConsumer {
+      public:
+	virtual ~PGNConsumer() {}
+	virtual void consume(const PGN & pgn) = 0;
+};
+
+/*
+ * Parallel reading of PGN files.
+ *
+ * The calling thread reads the file in chunks that end at a game
+ * boundary (an empty line followed by a tag line). Worker threads parse
+ * the chunks and replay the moves (see PGN::parse()), and the calling
+ * thread hands the games to the consumer, either in file order or in
+ * the order the chunks are finished. At most a few chunks per thread
+ * are in flight, so memory does not grow with the size of the file.
+ *
+ * Without thread support, or with one thread, the chunks are parsed
+ * by the calling thread.
+ */
+class PGNPipeline {
+      public:
+	/* default size of a chunk */
+	static const size_t DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+      private:
+	struct chunk {
+		unsigned long seq;
+		std::string text;
+		std::vector<PGN> games;
+		unsigned long skipped;
+	};
+
+	struct queues;
+
+      private:
+	unsigned int nthreads;
+	bool ordered;
+	size_t chunk_size;
+
+	/* statistics of the last run() */
+	unsigned long games;
+	unsigned long skipped;
+	unsigned long long bytes;
+	unsigned long long usecs;
+
+      public:
+	PGNPipeline(unsigned int nthreads, bool ordered,
+			size_t chunk_size = DEFAULT_CHUNK_SIZE);
+
+      public:
+	bool run(const char * filename, PGNConsumer * consumer,
+			bool show_progress = false);
+
+	unsigned long get_games() const
+	{ return games; }
+
+	unsigned long get_skipped() const
+	{ return skipped; }
+
+	void print_statistics(FILE * fp = stdout) const;
+
+      private:
+	bool read_chunk(FILE * fp, std::string * carry, struct chunk * c);
+	void deliver(struct chunk * c, PGNConsumer * consumer,
+			bool show_progress);
+	static void parse_chunk(struct chunk * c);
+	static void * worker_main(void * arg);
+};
+
+#endif // PGNPIPELINE_H
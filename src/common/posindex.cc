@@ -0,0 +1,318 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "posindex.h"
+#include "extsort.h"
+#include "pgn.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <set>
+
+
+/*
+ * Open a position index for reading.
+ */
+PositionIndex::PositionIndex(const char * filename, bool * ret)
+{
+	nr_entries = 0;
+	nr_games = 0;
+
+	if (!file.open(filename)) {
+		*ret = false;
+		return;
+	} else if (file.get_size() < HEADER_SIZE) {
+		printf("%s seems to be no position index\n", filename);
+		*ret = false;
+		return;
+	}
+
+	const unsigned char * data = file.get_data();
+	const size_t data_size = file.get_size();
+
+	const uint32_t magic = MappedFile::get_uint(data, 4);
+	const uint32_t version = MappedFile::get_uint(data + 4, 4);
+	nr_entries = MappedFile::get_uint(data + 8, 8);
+	nr_games = MappedFile::get_uint(data + 16, 8);
+
+	if (magic != s_magic) {
+		printf("%s seems to be no position index"
+				" (magic = 0x%0lx, should be 0x%0lx)\n",
+				filename, (unsigned long) magic,
+				(unsigned long) s_magic);
+		*ret = false;
+		return;
+	} else if (version != FORMAT_VERSION) {
+		printf("%s: unsupported position index version %lu\n",
+				filename, (unsigned long) version);
+		*ret = false;
+		return;
+	} else if ((data_size - HEADER_SIZE) / ENTRY_SIZE < nr_entries) {
+		printf("%s is truncated\n", filename);
+		*ret = false;
+		return;
+	}
+
+	*ret = true;
+}
+
+void PositionIndex::read_entry(unsigned long i,
+		PositionIndexEntry * entry) const
+{
+	const unsigned char * p = entry_data(i);
+	entry->hashkey = MappedFile::get_uint(p, 8);
+	entry->game = MappedFile::get_uint(p + 8, 4);
+	entry->ply = MappedFile::get_uint(p + 12, 2);
+	entry->move = MappedFile::get_uint(p + 14, 2);
+	entry->result = p[16];
+}
+
+/*
+ * Find all occurrences of a position by binary search. The entries are
+ * appended in order of game and ply. Returns the number of entries
+ * found.
+ */
+unsigned long PositionIndex::find(Hashkey hashkey,
+		std::vector<PositionIndexEntry> * entries) const
+{
+	/* lower bound */
+	unsigned long lo = 0, hi = nr_entries;
+	while (lo < hi) {
+		const unsigned long mid = lo + (hi - lo) / 2;
+		const Hashkey key = MappedFile::get_uint(entry_data(mid), 8);
+		if (key < hashkey) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	unsigned long n = 0;
+	PositionIndexEntry entry;
+	for (unsigned long i=lo; i<nr_entries; i++) {
+		read_entry(i, &entry);
+		if (entry.hashkey != hashkey) {
+			break;
+		}
+		entries->push_back(entry);
+		n++;
+	}
+	return n;
+}
+
+/*
+ * Print the moves played in the position with the number of games and
+ * the results from the point of view of the side to move, most frequent
+ * move first.
+ */
+void PositionIndex::print_statistics(const Board & board,
+		const std::vector<PositionIndexEntry> & entries) const
+{
+	struct stats {
+		unsigned long games;
+		unsigned long results[4];
+	};
+	std::map<unsigned int, struct stats> moves;
+
+	/* A position may occur several times in one game. Count each game
+	 * only once per move. The entries of one game are adjacent. */
+	std::set<unsigned int> game_moves;
+	for (std::vector<PositionIndexEntry>::const_iterator it
+			= entries.begin(); it != entries.end(); it++) {
+		if (it != entries.begin() && it->game != (it-1)->game) {
+			game_moves.clear();
+		}
+		if (!game_moves.insert(it->move).second) {
+			continue;
+		}
+
+		/* new elements are zero-initialized */
+		struct stats & s = moves[it->move];
+		s.games++;
+		s.results[it->result & 3]++;
+	}
+
+	std::vector<std::pair<unsigned long, unsigned int> > order;
+	for (std::map<unsigned int, struct stats>::const_iterator it
+			= moves.begin(); it != moves.end(); it++) {
+		order.push_back(std::make_pair(it->second.games, it->first));
+	}
+	std::sort(order.rbegin(), order.rend());
+
+	const unsigned int win = (board.get_side() == WHITE)
+		? RESULT_WHITE : RESULT_BLACK;
+	const unsigned int loss = (board.get_side() == WHITE)
+		? RESULT_BLACK : RESULT_WHITE;
+
+	printf(" Move       Games     Win    Draw    Loss   Score\n");
+	for (size_t i=0; i<order.size(); i++) {
+		const unsigned int m = order[i].second;
+		const struct stats & s = moves[m];
+
+		std::string san;
+		Move mov;
+		if (m == NO_INDEX_MOVE) {
+			san = "(end)";
+		} else if ((mov = GameDB::decode_move(board, m)) != NO_MOVE) {
+			san = mov.san(board);
+		} else {
+			/* hash collision */
+			san = "?";
+		}
+
+		const unsigned long known = s.results[win]
+			+ s.results[RESULT_DRAW] + s.results[loss];
+		printf(" %-8s %7lu %7lu %7lu %7lu", san.c_str(), s.games,
+				s.results[win], s.results[RESULT_DRAW],
+				s.results[loss]);
+		if (known > 0) {
+			printf("  %5.1f%%\n", 100.0 * (s.results[win]
+					+ 0.5 * s.results[RESULT_DRAW])
+					/ known);
+		} else {
+			printf("       -\n");
+		}
+	}
+}
+
+unsigned int PositionIndex::encode_result(
+		const std::string & result) /* static */
+{
+	if (result == "1-0") {
+		return RESULT_WHITE;
+	} else if (result == "0-1") {
+		return RESULT_BLACK;
+	} else if (result == "1/2-1/2") {
+		return RESULT_DRAW;
+	} else {
+		return RESULT_UNKNOWN;
+	}
+}
+
+/*
+ * Index all positions of a game database. The entries are sorted with
+ * an ExternalSort that keeps at most `memory' bytes of them in memory.
+ */
+bool PositionIndex::create(const char * indexfile, const char * dbfile,
+		size_t memory) /* static */
+{
+	bool ok;
+	GameDB db(dbfile, &ok);
+	if (!ok) {
+		return false;
+	} else if (db.size() > 0xffffffffUL) {
+		printf("%s has too many games for a position index\n", dbfile);
+		return false;
+	}
+
+	struct timeval tv_start, tv_now;
+	gettimeofday(&tv_start, NULL);
+
+	ExternalSort<PositionIndexEntry, std::less<PositionIndexEntry> >
+		entries(memory);
+	unsigned long skipped = 0;
+	PGN pgn;
+	for (unsigned long i=0; i<db.size(); i++) {
+		if (!db.read(i, &pgn)) {
+			skipped++;
+			continue;
+		}
+
+		PositionIndexEntry entry;
+		entry.game = i;
+		entry.result = encode_result(pgn.get_tags().count("Result")
+				? pgn.get_tags().find("Result")->second : "");
+
+		Board board = pgn.get_opening();
+		const std::list<Move> & moves = pgn.get_moves();
+		std::list<Move>::const_iterator it = moves.begin();
+		for (unsigned int k=0; ; k++) {
+			entry.hashkey = board.get_hashkey();
+			entry.ply = k;
+			if (it == moves.end()) {
+				entry.move = NO_INDEX_MOVE;
+				entries.put(entry);
+				break;
+			}
+			entry.move = GameDB::encode_move(*it);
+			entries.put(entry);
+			board.make_move(*it++);
+		}
+	}
+
+	entries.finish();
+
+	FILE * fp = fopen(indexfile, "wb");
+	if (!fp) {
+		printf("Cannot open %s for writing: %s\n",
+				indexfile, strerror(errno));
+		return false;
+	}
+
+	std::string buf;
+	MappedFile::put_uint(&buf, s_magic, 4);
+	MappedFile::put_uint(&buf, FORMAT_VERSION, 4);
+	MappedFile::put_uint(&buf, entries.size(), 8);
+	MappedFile::put_uint(&buf, db.size(), 8);
+	PositionIndexEntry entry;
+	while (entries.get(&entry)) {
+		MappedFile::put_uint(&buf, entry.hashkey, 8);
+		MappedFile::put_uint(&buf, entry.game, 4);
+		MappedFile::put_uint(&buf, entry.ply, 2);
+		MappedFile::put_uint(&buf, entry.move, 2);
+		buf += (char) entry.result;
+		if (buf.size() >= 65536) {
+			if (fwrite(buf.data(), 1, buf.size(), fp)
+					!= buf.size()) {
+				printf("Cannot write %s: %s\n",
+						indexfile, strerror(errno));
+				fclose(fp);
+				return false;
+			}
+			buf.clear();
+		}
+	}
+	if (!buf.empty() && fwrite(buf.data(), 1, buf.size(), fp)
+			!= buf.size()) {
+		printf("Cannot write %s: %s\n", indexfile, strerror(errno));
+		fclose(fp);
+		return false;
+	}
+	if (fclose(fp) != 0) {
+		printf("Cannot write %s: %s\n", indexfile, strerror(errno));
+		return false;
+	}
+
+	gettimeofday(&tv_now, NULL);
+	const double secs = (tv_now.tv_sec - tv_start.tv_sec)
+		+ (tv_now.tv_usec - tv_start.tv_usec) / 1000000.0;
+	printf("%lu positions from %lu games indexed in %.1f s,"
+			" %lu games skipped due to errors\n",
+			(unsigned long) entries.size(), db.size() - skipped,
+			secs, skipped);
+	return true;
+}
@@ -0,0 +1,129 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef POSINDEX_H
+#define POSINDEX_H
+
+#include "common.h"
+#include "board.h"
+#include "gamedb.h"
+#include "mappedfile.h"
+
+#include <stdio.h>
+
+#include <vector>
+
+
+/*
+ * One occurrence of a position in a game database.
+ */
+struct PositionIndexEntry {
+	Hashkey hashkey;
+	uint32_t game;		/* game number in the database */
+	uint16_t ply;		/* position is reached after ply moves */
+	uint16_t move;		/* next move, encoded like in GameDB */
+	uint8_t result;
+
+	bool operator<(const PositionIndexEntry & e) const
+	{
+		if (hashkey != e.hashkey) {
+			return hashkey < e.hashkey;
+		} else if (game != e.game) {
+			return game < e.game;
+		} else {
+			return ply < e.ply;
+		}
+	}
+};
+
+/*
+ * Index of all positions in a game database, to find the games that
+ * reach a given position without replaying the database.
+ *
+ * The file has a header
+ *
+ *	uint32	magic
+ *	uint32	version
+ *	uint64	number of entries
+ *	uint64	number of games in the database
+ *
+ * followed by the entries sorted by hash key, game and ply, each as
+ *
+ *	uint64	hash key
+ *	uint32	game
+ *	uint16	ply
+ *	uint16	next move, see GameDB::encode_move(), NO_INDEX_MOVE for
+ *		the final position
+ *	uint8	result of the game
+ *
+ * in little endian byte order. Since the next move is stored, the
+ * statistics for a position can be computed from the index alone.
+ */
+class PositionIndex {
+      public:
+	static const uint32_t FORMAT_VERSION = 2;
+	static const unsigned int HEADER_SIZE = 24;
+	static const unsigned int ENTRY_SIZE = 17;
+	static const uint16_t NO_INDEX_MOVE = 0xffff;
+
+	/* default for the memory argument of create() */
+	static const size_t DEFAULT_MEMORY = 64 * 1024 * 1024;
+
+	enum { RESULT_UNKNOWN = 0, RESULT_WHITE = 1, RESULT_BLACK = 2,
+		RESULT_DRAW = 3 };
+
+#if defined(HOICHESS)
+	static const uint32_t s_magic = 0x78697063L;	/* "cpix" */
+#elif defined(HOIXIANGQI)
+	static const uint32_t s_magic = 0x78697078L;	/* "xpix" */
+#else
+# error "neither HOICHESS nor HOIXIANGQI defined"
+#endif
+
+      private:
+	MappedFile file;
+	uint64_t nr_entries;
+	uint64_t nr_games;
+
+      public:
+	PositionIndex(const char * filename, bool * ret);
+
+      public:
+	unsigned long size() const
+	{ return nr_entries; }
+
+	unsigned long get_nr_games() const
+	{ return nr_games; }
+
+	unsigned long find(Hashkey hashkey,
+			std::vector<PositionIndexEntry> * entries) const;
+	void print_statistics(const Board & board,
+			const std::vector<PositionIndexEntry> & entries) const;
+
+	static bool create(const char * indexfile, const char * dbfile,
+			size_t memory = DEFAULT_MEMORY);
+
+      private:
+	const unsigned char * entry_data(unsigned long i) const
+	{ return file.get_data() + HEADER_SIZE + ENTRY_SIZE * i; }
+
+	void read_entry(unsigned long i, PositionIndexEntry * entry) const;
+	static unsigned int encode_result(const std::string & result);
+};
+
+#endif // POSINDEX_H
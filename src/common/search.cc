@@ -24,10 +24,14 @@
 # include "parallelsearch.h"
 #endif
 
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
+
 
 #define SHOPT(x) (shell->get_option_##x())
 
@@ -43,6 +47,10 @@ Search::Search(Shell * shell)
 	this->shell = shell;
 
 	evaluator = new Evaluator();
+#ifdef HOICHESS
+	nnue = NULL;
+	nnue_stack = NULL;
+#endif
 	hashtable = NULL;
 	shared_hashtable = false;
 	histtable[WHITE] = new HistoryTable();
@@ -56,10 +64,15 @@ Search::Search(Shell * shell)
 
 #ifdef WITH_THREAD
 	thread = NULL;
+	timer_thread = NULL;
+	timer_running = false;
 #endif
 
+	result_log = NULL;
+	quiet = false;
 	stop = false;
 	timecheck_interval_nodes = 100;
+	null_verify_ply = UINT_MAX;
 }
 
 Search::~Search()
@@ -70,6 +83,9 @@ Search::~Search()
 	}
 	delete histtable[WHITE];
 	delete histtable[BLACK]; 
+#ifdef HOICHESS
+	delete[] nnue_stack;
+#endif
 }
 
 
@@ -122,6 +138,100 @@ Move Search::start(const Board & board, const Clock & clock, int mode,
 	return start(&game, game.get_clock(), mode, NO_COLOR, maxdepth);
 }
 
+/*
+ * Static evaluation and quiescence search score of each board, both
+ * from the side to move's point of view. Only this object's evaluator
+ * and hash table are used, so run this on a separate Search object to
+ * leave the tables of the engine's search untouched. Several objects
+ * can be used in parallel.
+ */
+void Search::evaluate_batch(const Board * boards, size_t n,
+		struct evalresult * results)
+{
+	Clock noclock;
+	noclock.start();
+
+	clock = &noclock;
+	game = NULL;
+	mode = ANALYZE;
+	slave = true; /* no thinking output */
+	myside = NO_COLOR;
+	stop = false;
+
+	last_timecheck_csecs = 0;
+	next_timecheck_nodes = timecheck_interval_nodes;
+	next_update_csecs = 0;
+
+	evaluator->set_profile(false);
+#ifdef HOICHESS
+	init_nnue();
+#endif
+
+	for (size_t i=0; i<n; i++) {
+		Node node(boards[i]);
+		results[i].eval = static_eval(&node, 0, -INFTY, INFTY);
+		results[i].quiesce = quiescence_search(&node, 0,
+				-INFTY, INFTY);
+	}
+
+	noclock.stop();
+	clock = NULL;
+}
+
+struct evaluate_batch_job {
+	Search * search;
+	const Board * boards;
+	size_t n;
+	struct Search::evalresult * results;
+};
+
+static void * evaluate_batch_thread_main(void * arg)
+{
+	struct evaluate_batch_job * job = (struct evaluate_batch_job *) arg;
+	job->search->evaluate_batch(job->boards, job->n, job->results);
+	return arg;
+}
+
+/*
+ * Run evaluate_batch() on nsearches Search objects in parallel, each
+ * evaluating one slice of the boards. Without thread support, the
+ * slices are evaluated one after another.
+ */
+void Search::evaluate_batch_parallel(Search * const * searches,
+		unsigned int nsearches, const Board * boards, size_t n,
+		struct evalresult * results) /* static */
+{
+	ASSERT(nsearches > 0);
+
+	std::vector<struct evaluate_batch_job> jobs(nsearches);
+	const size_t slice = (n + nsearches - 1) / nsearches;
+	for (unsigned int t=0; t<nsearches; t++) {
+		const size_t first = MIN(t * slice, n);
+		jobs[t].search = searches[t];
+		jobs[t].boards = boards + first;
+		jobs[t].n = MIN(slice, n - first);
+		jobs[t].results = results + first;
+	}
+
+#ifdef WITH_THREAD
+	std::vector<Thread *> threads;
+	for (unsigned int t=1; t<nsearches; t++) {
+		Thread * thread = new Thread(evaluate_batch_thread_main);
+		thread->start(&jobs[t]);
+		threads.push_back(thread);
+	}
+	evaluate_batch_thread_main(&jobs[0]);
+	for (size_t t=0; t<threads.size(); t++) {
+		threads[t]->wait();
+		delete threads[t];
+	}
+#else
+	for (unsigned int t=0; t<nsearches; t++) {
+		evaluate_batch_thread_main(&jobs[t]);
+	}
+#endif
+}
+
 #ifdef WITH_THREAD
 void Search::start_thread(const Game * _game, Clock * _clock,
 		int _mode, Color _myside, unsigned int _maxdepth)
@@ -275,6 +385,79 @@ void * Search::thread_main(void * arg)
 	return args;
 }
 
+void Search::start_timer()
+{
+	ASSERT(!timer_thread);
+	timer_quit = false;
+	timer_tick = false;
+	timer_limit = clock->get_limit();
+	timer_running = true;
+	timer_thread = new Thread(timer_thread_main);
+	timer_thread->start((void *) this);
+}
+
+void Search::stop_timer()
+{
+	ASSERT(timer_thread);
+	timer_quit = true;
+	timer_queue.put(0);
+	timer_thread->wait();
+	delete timer_thread;
+	timer_thread = NULL;
+	timer_queue.clear();
+	timer_running = false;
+}
+
+void * Search::timer_thread_main(void * arg)
+{
+	Search * self = (Search *) arg;
+	self->timer_main();
+	return NULL;
+}
+
+/*
+ * Main loop of the timer thread. Wakes up at the update interval, or
+ * more often when time extensions need to be checked, and exactly at
+ * the end of the allocated time. The limit is read again each time,
+ * since it may be extended by the search. It is taken from timer_limit,
+ * not from the clock, which is only changed by the search thread.
+ */
+void Search::timer_main()
+{
+	const unsigned long long MS = 1000;
+
+	unsigned long long interval_us =
+		SHOPT(search_update_interval_csecs) * 10 * MS;
+	if (mode == MOVE && !clock->is_exact()
+			&& SHOPT(search_extend_time_iteration_enable)) {
+		interval_us = MIN(interval_us,
+			SHOPT(search_timecheck_interval_csecs_max) * 10 * MS);
+	}
+	interval_us = MAX(interval_us, MS);
+
+	while (!timer_quit) {
+		unsigned long long sleep_us = interval_us;
+
+		if (mode == MOVE) {
+			Clock::val_t remain = timer_limit
+				- clock->get_elapsed_time();
+			if (remain <= 0) {
+				/* Keep interrupting until the search
+				 * terminates, in case the parallel search
+				 * has started a slave meanwhile. */
+				interrupt();
+				sleep_us = MS;
+			} else if ((unsigned long long) remain * MS
+					< sleep_us) {
+				sleep_us = remain * MS;
+			}
+		}
+
+		timer_queue.wait(sleep_us);
+		timer_tick = true;
+	}
+}
+
 void * Search::slave_thread_main(void * arg)
 {
 	struct slave_thread_args * args = (struct slave_thread_args *) arg;
@@ -305,6 +488,45 @@ void Search::interrupt()
 	stop = true;
 }
 
+/*
+ * Collect the search results in log. With quiet, nothing is printed, so
+ * that several searches can run at once, see class EPDSolver. NULL
+ * restores normal output.
+ */
+void Search::set_result_log(std::vector<struct searchresult> * log,
+		bool quiet)
+{
+	result_log = log;
+	this->quiet = (log != NULL) && quiet;
+}
+
+/*
+ * Set the solution of a test position. If the option
+ * search_solve_stable_iterations is not 0, the search stops when the
+ * best move has been a solution for that many iterations in a row.
+ * Empty lists clear the solution.
+ */
+void Search::set_solution(const std::list<Move> & bm,
+		const std::list<Move> & am)
+{
+	solution_bm = bm;
+	solution_am = am;
+}
+
+/*
+ * A move solves the position if it is one of the bm moves, if any, and
+ * none of the am moves.
+ */
+bool Search::is_solution(Move mov) const
+{
+	if (!solution_bm.empty() && std::find(solution_bm.begin(),
+				solution_bm.end(), mov) == solution_bm.end()) {
+		return false;
+	}
+	return std::find(solution_am.begin(), solution_am.end(), mov)
+		== solution_am.end();
+}
+
 
 /*****************************************************************************
  * 
@@ -328,9 +550,14 @@ Move Search::main()
 	next_update_csecs = 0;
 
 	reset_statistics();
+	evaluator->set_profile(SHOPT(search_eval_profile));
+#ifdef HOICHESS
+	init_nnue();
+#endif
 
-	histtable[WHITE]->reset();
-	histtable[BLACK]->reset();
+	age_history();
+
+	init_lmr_table();
 
 	/* Convert the game entries into a list of node. The
 	 * last one will be the root node of the search tree. */
@@ -371,9 +598,21 @@ Move Search::main()
 
 	print_header();
 
+#ifdef WITH_THREAD
+	if (SHOPT(search_timer_thread)) {
+		start_timer();
+	}
+#endif
+
 	Move best = iterate(maxdepth);
 
-	if (verbose) {
+#ifdef WITH_THREAD
+	if (timer_running) {
+		stop_timer();
+	}
+#endif
+
+	if (verbose && !quiet) {
 		print_statistics();
 	}
 	
@@ -410,14 +649,24 @@ int Search::slave_main(const struct slave_search_args& search_args)
 	next_update_csecs = 0;
 
 	/* statistics are reset by ParallelSearch::reset_statistics() */
+	evaluator->set_profile(SHOPT(search_eval_profile));
+#ifdef HOICHESS
+	init_nnue();
+#endif
 
 	/* for non-parallel and master search, these are reset in
 	 * iterate(), so for slaves, it must be done here */
 	maxplyreached_fullwidth = 0;
 	maxplyreached_quiesce = 0;
 
-	histtable[WHITE]->reset();
-	histtable[BLACK]->reset();
+	/* The master's timer thread interrupts slaves when time is over,
+	 * so slaves do not need to check the clock. */
+	timer_running = SHOPT(search_timer_thread);
+
+	/* History tables are kept across slave searches. They are aged
+	 * at the start of each search by the master. */
+
+	init_lmr_table();
 
 	/* There is no direct root node for a slave search. */
 	rootnode = NULL;
@@ -441,9 +690,6 @@ int Search::slave_main(const struct slave_search_args& search_args)
  *
  *****************************************************************************/
 
-/* Aspiration window for iterative deepening */
-#define WINDOW	50
-
 /* Shortcut */
 #define failsoft (shell->get_option_search_failsoft())
 
@@ -453,6 +699,20 @@ Move Search::iterate(unsigned int depth)
 	int score = 0;
 	int alpha = -INFTY;
 	int beta = INFTY;
+
+	/* Aspiration window: distance of alpha and beta from the score
+	 * of the previous iteration. Each side is widened separately
+	 * when the search fails on that side. */
+	int delta_low = 0;
+	int delta_high = 0;
+	int prev_score = 0;
+	bool have_prev_score = false;
+	unsigned long long search_start_nodes;
+
+	/* number of iterations in a row with a solution as best move */
+	unsigned int solved_iterations = 0;
+	const bool stop_solved = SHOPT(search_solve_stable_iterations) > 0
+		&& (!solution_bm.empty() || !solution_am.empty());
 	
 	/* stop search after current iteration, even in case of fail-low */
 	stop_iteration = false;
@@ -465,6 +725,7 @@ again:
 		maxplyreached_quiesce = 0;
 
 		iteration_start_csecs = Clock::to_cs(clock->get_elapsed_time());
+		search_start_nodes = nodes_fullwidth + nodes_quiesce;
 
 		score = search_root(rootnode, 0, rootdepth, alpha, beta);
 		if (!failsoft && (score < alpha || score > beta) && !stop) {
@@ -481,11 +742,13 @@ again:
 			unsigned long csecs_wasted =
 				Clock::to_cs(clock->get_elapsed_time())
 				- iteration_start_csecs;
-			printf("\nIteration aborted after %u/%u moves (%u%%)"
-					", %.2f s wasted\n",
-					moves_done, moves_total, 
-					100 * moves_done / moves_total,
-					(float) csecs_wasted / 100);
+			if (!quiet) {
+				printf("\nIteration aborted after %u/%u"
+						" moves (%u%%), %.2f s wasted\n",
+						moves_done, moves_total,
+						100 * moves_done / moves_total,
+						(float) csecs_wasted / 100);
+			}
 			break;
 		}
 		
@@ -499,7 +762,11 @@ again:
 			if (stop_iteration) {
 				break;
 			}
-			alpha = -INFTY;
+			stat_asp_faillow++;
+			stat_asp_research_nodes += nodes_fullwidth
+				+ nodes_quiesce - search_start_nodes;
+			delta_low = widen_aspiration_window(delta_low);
+			alpha = (delta_low >= INFTY) ? -INFTY : score - delta_low;
 			//beta = beta;
 			goto again;
 		} else if (score >= beta && score < MATE) {
@@ -508,8 +775,12 @@ again:
 			if (stop_iteration) {
 				break;
 			}
+			stat_asp_failhigh++;
+			stat_asp_research_nodes += nodes_fullwidth
+				+ nodes_quiesce - search_start_nodes;
+			delta_high = widen_aspiration_window(delta_high);
 			//alpha = alpha;
-			beta = INFTY;
+			beta = (delta_high >= INFTY) ? INFTY : score + delta_high;
 			goto again;
 		} else {
 			Move mov = rootnode->get_best_move();
@@ -519,21 +790,47 @@ again:
 
 			print_result(rootdepth, score, searchresult::DEPTH,
 					rootnode->get_best_line());
+			solved_iterations = is_solution(best)
+				? solved_iterations + 1 : 0;
 			if (stop_iteration) {
 				break;
 			} else if (score >= MATE || score <= -MATE) {
 				break;
+			} else if (stop_solved && solved_iterations
+					>= (unsigned int)
+					SHOPT(search_solve_stable_iterations)) {
+				break;
 			}
 
-			alpha = score - WINDOW;
-			beta = score + WINDOW;
+			/* The initial window is widened by the score change
+			 * between the last two iterations, so unstable
+			 * positions do not fail again right away. */
+			int volatility = have_prev_score ?
+				abs(score - prev_score) : 0;
+			prev_score = score;
+			have_prev_score = true;
+
+			if (SHOPT(search_aspiration_window) <= 0) {
+				/* aspiration search disabled */
+				delta_low = delta_high = INFTY;
+			} else {
+				delta_low = delta_high
+					= SHOPT(search_aspiration_window)
+					+ volatility * SHOPT(
+					search_aspiration_volatility_percent)
+					/ 100;
+			}
+			alpha = (delta_low >= INFTY) ? -INFTY : score - delta_low;
+			beta = (delta_high >= INFTY) ? INFTY : score + delta_high;
 		}
 		
 		/* Decide if time is sufficient to start a new iteration. */
 		if (mode == MOVE && !clock->is_exact()
 				&& SHOPT(search_time_for_new_iteration_enable)
 				&& !time_for_new_iteration()) {
-			printf("No time for another iteration.\n");
+			if (!quiet) {
+				printf("No time for another iteration.\n");
+			}
 			break;
 		}
 
@@ -542,6 +839,28 @@ again:
 	return best;
 }
 
+/*
+ * Return the next aspiration window size after a fail-low or fail-high.
+ * The window is multiplied by a constant factor until it exceeds
+ * search_aspiration_max_window, then the search is repeated with an
+ * infinite bound on the failing side.
+ */
+int Search::widen_aspiration_window(int delta)
+{
+	int factor = MAX(SHOPT(search_aspiration_widen_factor_tenth), 10);
+	int maxwin = SHOPT(search_aspiration_max_window);
+
+	if (delta >= INFTY || delta >= maxwin) {
+		return INFTY;
+	}
+
+	delta = MAX(delta * factor / 10, delta + 1);
+	if (delta >= maxwin) {
+		return INFTY;
+	}
+	return delta;
+}
+
 int Search::search_root(Node * node, unsigned int ply, int depth,
 		int alpha, int beta)
 {
@@ -631,7 +950,9 @@ int Search::search_root(Node * node, unsigned int ply, int depth,
 		}
 	}
 	
-	add_history(node);
+	if (bestscore > save_alpha) {
+		add_history(node, depth, NULL, 0);
+	}
 
 	stat_moves_sum += moves;
 	stat_moves_cnt++;
@@ -665,6 +986,8 @@ int Search::search(Node * node, unsigned int ply, int depth, int extend,
 	int bestscore = -INFTY;
 	int moves = 0;
 	bool first = true;
+	Move quiets[SEARCH_MAX_QUIETS]; /* quiet moves searched so far */
+	unsigned int nquiets = 0;
 	nodes_fullwidth++;
 	
 	if (ply > maxplyreached_fullwidth) {
@@ -675,22 +998,9 @@ int Search::search(Node * node, unsigned int ply, int depth, int extend,
 		return score;
 	}
 
-	/* Null-move forward pruning */
-	bool null_ok = !(node->get_parent()->get_played_move().is_null())
-		    && !(Evaluator::get_phase(node->get_board())
-				   == Evaluator::ENDGAME);
-	if (!node->in_check() && null_ok) {
-		Node * child = node->make_move(Move::null(), &nodealloc);
-		score = -search(child, ply+1, depth-2-1, 0, -beta, -beta+1);
-		child->free();
-		if (score >= beta) {
-			stat_nullcut++;
-			if (failsoft) {
-				return score;
-			} else {
-				return beta; /* fail hard */
-			}
-		}
+	/* Static null-move and null-move forward pruning */
+	if (null_move_prune(node, ply, depth, alpha, beta, &score)) {
+		return score;
 	}
 
 	/*
@@ -753,11 +1063,31 @@ int Search::search(Node * node, unsigned int ply, int depth, int extend,
 		}
 
 
+		/* Late move reductions: search quiet moves late in the
+		 * move list with reduced depth and a null window. If the
+		 * move turns out better than expected, it is searched
+		 * again normally. */
+		bool reduced_failed_low = false;
+		int reduction = first ? 0 : lmr_reduction(node, child, mov,
+				depth, moves, alpha, beta);
+		if (reduction > 0) {
+			stat_lmr++;
+			score = -search(child, ply+1, depth-1-reduction, extend,
+					-alpha-1, -alpha);
+			if (score > alpha) {
+				stat_lmr_research++;
+			} else {
+				reduced_failed_low = true;
+			}
+		}
+
 		/* Search the current move. We use a standard
 		 * principal variation search here. */
 		bool nullwin = (SHOPT(search_pvs_mode) == 1 && !first)
 			|| (SHOPT(search_pvs_mode) == 2 && alpha > save_alpha);
-		if (nullwin) {
+		if (reduced_failed_low || stop) {
+			/* nothing to do */
+		} else if (nullwin) {
 			score = -search(child, ply+1, depth-1, extend,
 					-alpha-1, -alpha);
 			if (score > alpha && score < beta) {
@@ -770,6 +1100,10 @@ int Search::search(Node * node, unsigned int ply, int depth, int extend,
 		}
 		first = false;
 
+		if (is_quiet_move(mov) && nquiets < SEARCH_MAX_QUIETS) {
+			quiets[nquiets++] = mov;
+		}
+
 		if (!failsoft && (score < alpha || score > beta) && !stop) {
 			printf("search(): fail hard condition violated:"
 					" score=%d alpha=%d beta=%d\n",
@@ -803,6 +1137,11 @@ int Search::search(Node * node, unsigned int ply, int depth, int extend,
 				score = beta; /* fail hard */
 			}
 			stat_cut++;
+			stat_cutoff_cnt++;
+			stat_cutoff_index_sum += moves;
+			if (moves == 1) {
+				stat_cutoff_first++;
+			}
 			break;
 		}
 	}
@@ -830,7 +1169,9 @@ int Search::search(Node * node, unsigned int ply, int depth, int extend,
 		store_hashtable(node, depth, save_alpha, beta, alpha);
 	} 
 	
-	add_history(node);
+	if (bestscore > save_alpha) {
+		add_history(node, depth, quiets, nquiets);
+	}
 	add_killer(node);
 
 	stat_moves_sum += moves;
@@ -843,6 +1184,76 @@ int Search::search(Node * node, unsigned int ply, int depth, int extend,
 	}
 }
 
+/*
+ * Static evaluation of the node's board, from the side to move's
+ * point of view.
+ */
+inline int Search::static_eval(Node * node, unsigned int ply,
+		int alpha, int beta)
+{
+#ifdef HOICHESS
+	if (nnue != NULL) {
+		return nnue->evaluate(node->get_board(),
+				nnue_accumulator(node, ply));
+	}
+#else
+	(void) ply;
+#endif
+	return evaluator->eval(node->get_board(), alpha, beta, myside);
+}
+
+#ifdef HOICHESS
+/*
+ * Use the NNUE network if the option says so. The accumulators are
+ * allocated when a network is used for the first time, and are
+ * invalidated, since the network may have changed.
+ */
+void Search::init_nnue()
+{
+	nnue = SHOPT(search_eval_nnue) ? NNUE::get_network() : NULL;
+	if (nnue == NULL) {
+		return;
+	}
+
+	if (nnue_stack == NULL) {
+		nnue_stack = new struct nnue_slot[MAXPLY + 1];
+	}
+	for (unsigned int i=0; i<=MAXPLY; i++) {
+		nnue_stack[i].acc.computed = false;
+	}
+}
+
+/*
+ * Return the NNUE accumulator for the node at the given ply. It is
+ * computed incrementally from the parent's accumulator one ply up,
+ * which is computed recursively if necessary, so each node is touched
+ * at most once. A slave reads the boards of the master's nodes above
+ * its starting node, but those do not change while it runs.
+ */
+const NNUEAccumulator & Search::nnue_accumulator(const Node * node,
+		unsigned int ply)
+{
+	ASSERT_DEBUG(ply <= MAXPLY);
+
+	struct nnue_slot * slot = &nnue_stack[ply];
+	const Board & board = node->get_board();
+	if (slot->acc.computed && slot->hashkey == board.get_hashkey()) {
+		return slot->acc;
+	}
+
+	const Node * parent = node->get_parent();
+	if (ply > 0 && parent != NULL) {
+		nnue->update(parent->get_board(), board,
+				nnue_accumulator(parent, ply - 1),
+				&slot->acc);
+	} else {
+		nnue->refresh(board, &slot->acc);
+	}
+	slot->hashkey = board.get_hashkey();
+	return slot->acc;
+}
+#endif
+
 int Search::quiescence_search(Node * node, unsigned int ply, 
 		int alpha, int beta)
 {
@@ -867,7 +1278,7 @@ int Search::quiescence_search(Node * node, unsigned int ply,
 	 * This score will be returned if none
 	 * of the moves is better than alpha.
 	 */
-	score = evaluator->eval(node->get_board(), alpha, beta, myside);
+	score = static_eval(node, ply, alpha, beta);
 	if (score >= beta) {
 		if (failsoft) {
 			return score;
@@ -1170,26 +1581,205 @@ void Search::store_hashtable(Node * node, int depth, int alpha, int beta,
 	hashtable->put(hashentry, &best_line);
 }
 
-void Search::add_history(Node * node)
+bool Search::is_quiet_move(Move mov)
 {
-	if (node->get_best_move()) {
-		histtable[node->get_board().get_side()]->add(node->get_best_move());
+	return !mov.is_capture()
+#ifdef HOICHESS
+		&& !mov.is_enpassant()
+		&& !mov.is_promotion()
+#endif // HOICHESS
+		;
+}
+
+/*
+ * Update history, continuation history and counter move of the side to
+ * move at node, after a best move has been found. quiets[] holds the
+ * quiet moves searched at node, which get a malus unless they are the
+ * best move.
+ */
+void Search::add_history(Node * node, int depth,
+		const Move * quiets, unsigned int nquiets)
+{
+	Move best = node->get_best_move();
+	if (!best || !is_quiet_move(best)) {
+		return;
+	}
+
+	HistoryTable * ht = histtable[node->get_board().get_side()];
+	Move prev = node->get_played_move();
+	int bonus = MIN(depth * depth * 64, HistoryTable::HISTORY_MAX / 4);
+
+	ht->add(best, prev, bonus);
+	ht->set_countermove(prev, best);
+
+	for (unsigned int i=0; i<nquiets; i++) {
+		if (quiets[i] != best) {
+			ht->add(quiets[i], prev, -bonus);
+		}
 	}
 }
 
+void Search::age_history()
+{
+	histtable[WHITE]->age();
+	histtable[BLACK]->age();
+}
+
+/*
+ * Forget history and counter moves, e.g. when a new game is started.
+ */
+void Search::clear_history()
+{
+	histtable[WHITE]->reset();
+	histtable[BLACK]->reset();
+}
+
 void Search::add_killer(Node * node)
 {
 	if (node->get_best_move() != node->get_hashmv()
-			&& !(node->get_best_move().is_capture())
-#ifdef HOICHESS
-			&& !(node->get_best_move().is_enpassant())
-			&& !(node->get_best_move().is_promotion())
-#endif // HOICHESS
-			) {
+			&& is_quiet_move(node->get_best_move())) {
 		node->add_killer(node->get_best_move());
 	}
 }
 
+/*
+ * Static null-move (reverse futility) pruning and null-move pruning.
+ * Returns true if the node can be cut off, with the score to return
+ * in *score.
+ *
+ * The null-move reduction grows with depth and with the margin by which
+ * the material balance exceeds beta. In the endgame, where zugzwang is
+ * common, a null-move cutoff is only accepted if a reduced search of the
+ * node itself without null move also fails high.
+ */
+bool Search::null_move_prune(Node * node, unsigned int ply, int depth,
+		int alpha, int beta, int * score)
+{
+	if (node->in_check() || ply == null_verify_ply
+			|| node->get_parent()->get_played_move().is_null()) {
+		return false;
+	}
+
+	int material = node->material_balance();
+
+	/* static null-move pruning */
+	int margin = SHOPT(search_rfp_margin) * depth;
+	if (SHOPT(search_rfp_enable) && depth <= (int) SHOPT(search_rfp_max_depth)
+			&& beta - alpha == 1 && beta < MATE && beta > -MATE
+			&& material - margin >= beta) {
+		stat_rfpcut++;
+		*score = failsoft ? material - margin : beta;
+		return true;
+	}
+
+	if (!SHOPT(search_null_enable)) {
+		return false;
+	}
+	bool endgame = (Evaluator::get_phase(node->get_board())
+			== Evaluator::ENDGAME);
+	if (endgame && !SHOPT(search_null_verify)) {
+		return false;
+	}
+
+	int R = SHOPT(search_null_reduction);
+	if (SHOPT(search_null_depth_divisor) > 0) {
+		R += depth / (int) SHOPT(search_null_depth_divisor);
+	}
+	if (SHOPT(search_null_eval_margin) > 0
+			&& material - beta >= (int) SHOPT(search_null_eval_margin)) {
+		R++;
+	}
+
+	Node * child = node->make_move(Move::null(), &nodealloc);
+	int nullscore = -search(child, ply+1, depth-R-1, 0, -beta, -beta+1);
+	child->free();
+	if (nullscore < beta || stop) {
+		return false;
+	}
+
+	if (endgame) {
+		/* verification search, with null move disabled at
+		 * this node */
+		unsigned int save_verify_ply = null_verify_ply;
+		null_verify_ply = ply;
+		int vscore = search(node, ply, depth-R-1, 0, beta-1, beta);
+		null_verify_ply = save_verify_ply;
+		if (vscore < beta || stop) {
+			stat_nullverify_fail++;
+			return false;
+		}
+	}
+
+	stat_nullcut++;
+	*score = failsoft ? nullscore : beta; /* fail hard */
+	return true;
+}
+
+/*
+ * Build the late move reduction table. The reduction grows with the
+ * logarithm of both remaining depth and move number:
+ *
+ *   r = base + ln(depth) * ln(moveno) / divisor
+ *
+ * where base and divisor are given in tenths by the shell options.
+ */
+void Search::init_lmr_table()
+{
+	double base = SHOPT(search_lmr_base_tenth) / 10.0;
+	double divisor = MAX(SHOPT(search_lmr_divisor_tenth), 1) / 10.0;
+
+	for (int d=0; d<LMR_TABLE_SIZE; d++) {
+		for (int m=0; m<LMR_TABLE_SIZE; m++) {
+			if (d == 0 || m == 0) {
+				lmr_table[d][m] = 0;
+				continue;
+			}
+			double r = base + log((double) d) * log((double) m)
+				/ divisor;
+			lmr_table[d][m] = (r < 0) ? 0 : (unsigned char) r;
+		}
+	}
+}
+
+/*
+ * Return by how many plies a move should be reduced. Only quiet moves
+ * which do not give or evade check are reduced, and never hash moves
+ * or killers. PV nodes and moves with a good history score are
+ * reduced less.
+ */
+int Search::lmr_reduction(const Node * node, const Node * child, Move mov,
+		int depth, int moves, int alpha, int beta) const
+{
+	if (!SHOPT(search_lmr_enable)
+			|| depth < (int) SHOPT(search_lmr_min_depth)
+			|| moves <= (int) SHOPT(search_lmr_min_moves)
+			|| node->in_check() || child->in_check()
+			|| !is_quiet_move(mov)
+			|| mov == node->get_hashmv()
+			|| mov == node->get_pvmove()
+			|| node->is_killer(mov)) {
+		return 0;
+	}
+
+	int r = lmr_table[MIN(depth, LMR_TABLE_SIZE-1)]
+			[MIN(moves, LMR_TABLE_SIZE-1)];
+
+	/* PV node */
+	if (beta - alpha > 1) {
+		r--;
+	}
+
+	/* move has caused many cutoffs elsewhere in the tree */
+	const HistoryTable * ht = histtable[node->get_board().get_side()];
+	if (ht->get(mov, node->get_played_move())
+			> HistoryTable::HISTORY_MAX / 2) {
+		r--;
+	}
+
+	/* always leave at least one ply before quiescence search */
+	return MAX(0, MIN(r, depth-2));
+}
+
 int Search::bound_score(int score, int alpha, int beta)
 {
 	if (score > beta) {
@@ -1203,10 +1793,23 @@ int Search::bound_score(int score, int alpha, int beta)
 
 void Search::check_time(bool force_check, bool force_update)
 {
+	bool poll = true;
+#ifdef WITH_THREAD
+	/* With a timer thread, stop is set at the deadline, and we
+	 * only need to do the remaining work when the timer says so. */
+	if (timer_running) {
+		if (!timer_tick && !force_check) {
+			return;
+		}
+		timer_tick = false;
+		poll = false;
+	}
+#endif
+
 	/* check time only after a certain number of nodes to reduce
 	 * system call overhead */
 	unsigned long long nodes = nodes_fullwidth + nodes_quiesce;
-	if (nodes < next_timecheck_nodes && !force_check) {
+	if (poll && nodes < next_timecheck_nodes && !force_check) {
 		return;
 	}
 
@@ -1219,7 +1822,7 @@ void Search::check_time(bool force_check, bool force_update)
 	unsigned long elapsed_csecs = Clock::to_cs(clock->get_elapsed_time());
 
 	/* update and adjust time check interval */
-	if (!force_check) {
+	if (poll && !force_check) {
 		adjust_timecheck_interval(elapsed_csecs);
 	}
 	last_timecheck_csecs = elapsed_csecs;
@@ -1342,6 +1945,11 @@ void Search::extend_time_iteration()
 				/* do not start a new iteration anymore */
 				stop_iteration = true;
 			}
+#ifdef WITH_THREAD
+			if (timer_running) {
+				timer_limit = clock->get_limit();
+			}
+#endif
 		}
 	}
 }
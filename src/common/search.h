@@ -30,15 +30,27 @@
 //#include "shell.h"
 #ifdef WITH_THREAD
 # include "mutex.h"
+# include "queue.h"
 # include "thread.h"
 #endif
 #include "node.h"
+#ifdef HOICHESS
+# include "nnue.h"
+#endif
+
+#include <vector>
 
 /* forward declarations */
 class Shell;
 class ParallelSearch;
 class HashTable;
 
+/* number of quiet moves per node remembered for history malus */
+#define SEARCH_MAX_QUIETS 64
+
+/* size of late move reduction table (depth x move number) */
+#define LMR_TABLE_SIZE 64
+
 class Search
 {
       public:
@@ -65,10 +77,17 @@ class Search
 		unsigned long csecs_alloc;	// allocated search time
 		unsigned long long nodes_total;	// total nodes searched
 		std::string best_line;		// line of best moves
+		Move best;		// first move of best line
 		unsigned int maxplyreached_fullwidth;	// maximum ply reached
 		unsigned int maxplyreached_quiesce;	// ... during q.s.
 	};
 
+	/* result of evaluate_batch() */
+	struct evalresult {
+		int eval;		// static evaluation
+		int quiesce;		// quiescence search score
+	};
+
 #ifdef WITH_THREAD
       protected:
 	struct thread_args {
@@ -116,6 +135,18 @@ class Search
       protected:
 	NodeAllocator nodealloc;
 	Evaluator * evaluator;
+#ifdef HOICHESS
+	const NNUE * nnue; /* network to use instead of evaluator, or NULL */
+
+	/* NNUE accumulators of the nodes on the current path, by ply,
+	 * tagged with the hash key of the board they belong to. Only
+	 * allocated when a network is used. */
+	struct nnue_slot {
+		NNUEAccumulator acc;
+		Hashkey hashkey;
+	};
+	struct nnue_slot * nnue_stack;
+#endif
 	HashTable * hashtable;
 	bool shared_hashtable;
 	HistoryTable * histtable[2];
@@ -130,6 +161,10 @@ class Search
       private:
 	unsigned int rootdepth;
 
+	/* ply of a null-move verification search in progress,
+	 * UINT_MAX if none */
+	unsigned int null_verify_ply;
+
 	/* search mode */
       protected:
 	int mode;
@@ -143,8 +178,31 @@ class Search
 	Mutex start_mutex;
 	Mutex main_mutex;
 	Thread * thread;
+
+	/* Timer thread: sets stop when the allocated time is over and
+	 * timer_tick at regular intervals, so that the search does not
+	 * need to read the clock itself. */
+	Thread * timer_thread;
+	Queue<int> timer_queue; /* to wake up timer thread */
+	volatile bool timer_quit;
+	volatile bool timer_tick;
+	bool timer_running;
+	/* copy of the clock limit for the timer thread, updated by the
+	 * search when it allocates more time */
+	volatile Clock::val_t timer_limit;
 #endif
 	
+	/* If not NULL, the search results are appended here. If quiet
+	 * is set, they are not printed, nor is any thinking output. */
+      private:
+	std::vector<struct searchresult> * result_log;
+	bool quiet;
+
+	/* Moves that solve the position (EPD bm) and moves that do not
+	 * (EPD am), see set_solution(). */
+	std::list<Move> solution_bm;
+	std::list<Move> solution_am;
+
 	/* control variable to stop running search */
       protected:
 	volatile bool stop;
@@ -168,10 +226,20 @@ class Search
       protected:
 	/* extended statistics */
 	unsigned long stat_cut;
+	unsigned long stat_cutoff_cnt;
+	unsigned long stat_cutoff_first;
+	unsigned long stat_cutoff_index_sum;
 	unsigned long stat_nullcut;
+	unsigned long stat_nullverify_fail;
+	unsigned long stat_rfpcut;
 	unsigned long stat_futcut;
 	unsigned long stat_xfutcut;
 	unsigned long stat_razcut;
+	unsigned long stat_lmr;
+	unsigned long stat_lmr_research;
+	unsigned long stat_asp_faillow;
+	unsigned long stat_asp_failhigh;
+	unsigned long long stat_asp_research_nodes;
 	unsigned long stat_moves_sum;
 	unsigned long stat_moves_cnt;
 	unsigned long stat_moves_sum_quiesce;
@@ -187,6 +255,10 @@ class Search
 	/* see comment in probe_hashtable() */
 	struct Node::pvline _probe_hashtable_pvline;
 
+	/* Late move reductions, indexed by remaining depth and move
+	 * number. Filled from the shell options by init_lmr_table(). */
+	unsigned char lmr_table[LMR_TABLE_SIZE][LMR_TABLE_SIZE];
+
       public:
 	Search(Shell * shell);
 	virtual ~Search();
@@ -196,6 +268,11 @@ class Search
 			int mode, Color myside, unsigned int maxdepth);
 	Move start(const Board & board, const Clock & clock, int mode,
 			unsigned int maxdepth);
+	void evaluate_batch(const Board * boards, size_t n,
+			struct evalresult * results);
+	static void evaluate_batch_parallel(Search * const * searches,
+			unsigned int nsearches, const Board * boards, size_t n,
+			struct evalresult * results);
 #ifdef WITH_THREAD
 	void start_thread(const Game * game, Clock * clock,
 			int mode, Color myside, unsigned int maxdepth);
@@ -208,19 +285,36 @@ class Search
       private:
 	static void * thread_main(void * arg);
 	static void * slave_thread_main(void * arg);
+	static void * timer_thread_main(void * arg);
+	void start_timer();
+	void stop_timer();
+	void timer_main();
 #endif
 
       public:
 	virtual void interrupt();
+	void set_result_log(std::vector<struct searchresult> * log,
+			bool quiet = true);
+	void set_solution(const std::list<Move> & bm,
+			const std::list<Move> & am);
+	bool is_solution(Move mov) const;
 
 	virtual void set_hash_size(size_t bytes);
 	virtual void set_hash_size_pvline(size_t bytes);
 	virtual void set_hash_table(HashTable * table);
 	virtual void clear_hash();
 	virtual void set_pawnhash_size(size_t bytes);
+	virtual void set_pawnhash_table(PawnHashTable * table);
 	virtual void clear_pawnhash();
 	virtual void set_evalcache_size(size_t bytes);
+	virtual void set_evalcache_table(EvaluationCache * cache);
 	virtual void clear_evalcache();
+	virtual void age_history();
+	virtual void clear_history();
+	void get_cache_statistics(unsigned long * pawnhash_probes,
+			unsigned long * pawnhash_hits,
+			unsigned long * evalcache_probes,
+			unsigned long * evalcache_hits) const;
 	
       protected:
 	virtual Move main();
@@ -228,21 +322,35 @@ class Search
 	virtual int slave_main(const struct slave_search_args& search_args);
 #endif
 	virtual Move iterate(unsigned int depth);
+	int widen_aspiration_window(int delta);
 	virtual int search_root(Node * node, unsigned int ply, int depth,
 			int alpha, int beta);
 	virtual int search(Node * node, unsigned int ply, int depth, int extend,
 			int alpha, int beta);
 	virtual int quiescence_search(Node * node, unsigned int ply, 
 			int alpha, int beta);
+	int static_eval(Node * node, unsigned int ply, int alpha, int beta);
+#ifdef HOICHESS
+	void init_nnue();
+	const NNUEAccumulator & nnue_accumulator(const Node * node,
+			unsigned int ply);
+#endif
 	bool is_draw(const Node * node, unsigned int ply, int * score);
 	bool is_repetition(const Node * node, unsigned int ply, int * score);
 	bool probe_hashtable(Node * node, int depth, int alpha, int beta,
 			int * score);
 	void store_hashtable(Node * node, int depth, int alpha, int beta,
 			int score);
-	void add_history(Node * node);
+	static bool is_quiet_move(Move mov);
+	void add_history(Node * node, int depth,
+			const Move * quiets, unsigned int nquiets);
 	void add_killer(Node * node);
 	int bound_score(int score, int alpha, int beta);
+	bool null_move_prune(Node * node, unsigned int ply, int depth,
+			int alpha, int beta, int * score);
+	void init_lmr_table();
+	int lmr_reduction(const Node * node, const Node * child, Move mov,
+			int depth, int moves, int alpha, int beta) const;
 
       protected:
 	void check_time(bool force_check, bool force_update);
@@ -253,6 +361,7 @@ class Search
       public:
 	virtual void print_statistics();
 	virtual void reset_statistics();
+	virtual void print_evalprofile();
 	unsigned long long get_nodes_fullwidth() const;
 	unsigned long long get_nodes_quiesce() const;
 	unsigned int get_maxplyreached_fullwidth() const;
@@ -54,6 +54,22 @@ void Search::print_statistics()
 					" cuts_xfut=%ld cuts_razor=%ld\n",
 			stat_cut, stat_nullcut, stat_futcut,
 			stat_xfutcut, stat_razcut);
+	printf(INFO_PRFX "cutoff_first=%.1f%% avg_cutoff_index=%.2f\n",
+			stat_cutoff_cnt ?
+				100.0 * stat_cutoff_first / stat_cutoff_cnt : 0.0,
+			stat_cutoff_cnt ?
+				(float) stat_cutoff_index_sum / stat_cutoff_cnt
+				: 0.0);
+	printf(INFO_PRFX "cuts_static_null=%ld null_verify_fail=%ld\n",
+			stat_rfpcut, stat_nullverify_fail);
+	printf(INFO_PRFX "lmr_reductions=%ld lmr_researches=%ld\n",
+			stat_lmr, stat_lmr_research);
+	printf(INFO_PRFX "asp_faillow=%ld asp_failhigh=%ld"
+					" asp_research_nodes=%llu (%.1f%%)\n",
+			stat_asp_faillow, stat_asp_failhigh,
+			stat_asp_research_nodes,
+			nodes_total ? 100.0 * stat_asp_research_nodes
+					/ nodes_total : 0.0);
 	printf(INFO_PRFX "avg_branchfactor_fullwidth=%.2f"
 					" avg_branchfactor_quiesce=%.2f\n",
 		(float) stat_moves_sum / stat_moves_cnt,
@@ -65,6 +81,11 @@ void Search::print_statistics()
 	evaluator->print_statistics();
 }
 
+void Search::print_evalprofile()
+{
+	evaluator->print_profile();
+}
+
 void Search::reset_statistics()
 {
 	nodes_fullwidth = 0;
@@ -73,10 +94,20 @@ void Search::reset_statistics()
 	 * in iterate() so they can be tracked for each iteration
 	 * separately (matter of taste) */
 	stat_cut = 0;
+	stat_cutoff_cnt = 0;
+	stat_cutoff_first = 0;
+	stat_cutoff_index_sum = 0;
 	stat_nullcut = 0;
+	stat_nullverify_fail = 0;
+	stat_rfpcut = 0;
 	stat_futcut = 0;
 	stat_xfutcut = 0;
 	stat_razcut = 0;
+	stat_lmr = 0;
+	stat_lmr_research = 0;
+	stat_asp_faillow = 0;
+	stat_asp_failhigh = 0;
+	stat_asp_research_nodes = 0;
 	stat_moves_sum = 0;
 	stat_moves_cnt = 0;
 	stat_moves_sum_quiesce = 0;
@@ -117,6 +148,9 @@ unsigned int Search::get_maxplyreached_quiesce() const
 
 void Search::print_header()
 {
+	if (quiet) {
+		return;
+	}
 	shell->print_search_header();
 }
 
@@ -125,6 +159,10 @@ void Search::print_header()
  */
 void Search::print_thinking(unsigned int depth)
 {
+	if (quiet) {
+		return;
+	}
+
 	unsigned long csecs = Clock::to_cs(clock->get_elapsed_time());
 
 	/* pack all information into structure that is passed to shell */
@@ -159,9 +197,17 @@ void Search::print_result(unsigned int depth, int score, enum searchresult::resu
 	sr.csecs_alloc = Clock::to_cs(clock->get_limit());
 	sr.nodes_total = nodes_fullwidth + nodes_quiesce;
 	sr.best_line = Node::pvline2str(pvline, rootnode->get_board(), true);
+	sr.best = (pvline.nmoves > 0) ? pvline.moves[0] : NO_MOVE;
 	sr.maxplyreached_fullwidth = maxplyreached_fullwidth;
 	sr.maxplyreached_quiesce = maxplyreached_quiesce;
 
+	if (result_log) {
+		result_log->push_back(sr);
+	}
+	if (quiet) {
+		return;
+	}
+
 	/* call shell for actual output */
 	shell->print_search_result(&sr);
 }
@@ -242,6 +288,11 @@ void Search::set_pawnhash_size(size_t bytes)
 	evaluator->set_pawnhash_size(bytes);
 }
 
+void Search::set_pawnhash_table(PawnHashTable * table)
+{
+	evaluator->set_pawnhash_table(table);
+}
+
 void Search::clear_pawnhash()
 {
 	evaluator->clear_pawnhash();
@@ -252,8 +303,22 @@ void Search::set_evalcache_size(size_t bytes)
 	evaluator->set_evalcache_size(bytes);
 }
 
+void Search::set_evalcache_table(EvaluationCache * cache)
+{
+	evaluator->set_evalcache_table(cache);
+}
+
 void Search::clear_evalcache()
 {
 	evaluator->clear_evalcache();
 }
 
+void Search::get_cache_statistics(unsigned long * pawnhash_probes,
+		unsigned long * pawnhash_hits,
+		unsigned long * evalcache_probes,
+		unsigned long * evalcache_hits) const
+{
+	evaluator->get_cache_statistics(pawnhash_probes, pawnhash_hits,
+			evalcache_probes, evalcache_hits);
+}
+
@@ -59,6 +59,8 @@ Shell::Shell()
 	Clock clock(5);
 	game = new Game(Board(), clock, clock);	
 	book = NULL;
+	book_learned = false;
+	solver = NULL;
 
 #ifdef WITH_THREAD
 	parallel = 0;
@@ -143,20 +145,25 @@ void Shell::interrupt()
 		printf("Interrupt\n");
 	}
 	search->interrupt();
+	if (solver) {
+		solver->interrupt();
+	}
 	stop = true;
 
 	flag_playboth = false;
 }
 
 /*
- * Set the opening book. If bookfile is NULL, disable opening book.
+ * Set the opening book. If bookfile is NULL, disable opening book. With
+ * learn, the book is opened for writing and the results of our games
+ * are recorded in it, see learn_book().
  */
-void Shell::set_book(const char * bookfile)
+void Shell::set_book(const char * bookfile, bool learn)
 {
 	if (bookfile) {
 		delete book;
 		bool ok;
-		book = new Book(bookfile, &ok);
+		book = new Book(bookfile, &ok, learn);
 		if (!ok) {
 			/* Yuck! Under xboard, we must not print messages
 			 * containing things like 'no such file' because this
@@ -173,7 +180,8 @@ void Shell::set_book(const char * bookfile)
 			}
 			book = NULL;
 		} else {
-			printf("Opening book: %s\n", bookfile);
+			printf("Opening book: %s%s\n", bookfile,
+					learn ? " (learning)" : "");
 		}
 	} else {
 		delete book;
@@ -591,6 +599,7 @@ void Shell::user_move(Move mov)
 	DBG(2, "result = %d", game->get_result());
 	if (game->get_result()) {
 		print_result();
+		learn_book(game->get_result_str());
 	}
 }
 
@@ -664,6 +673,7 @@ void Shell::engine_move()
 	DBG(2, "result = %d", game->get_result());
 	if (game->get_result()) {
 		print_result();
+		learn_book(game->get_result_str());
 	}
 }
 
@@ -701,3 +711,48 @@ void Shell::print_result()
 			game->get_result_comment().c_str());
 }
 
+/*
+ * Update the book with the result of the game for each book move we
+ * played. Only done once per game, since xboard sends the result also
+ * if we have detected the end of the game ourselves.
+ */
+void Shell::learn_book(const std::string & result)
+{
+	if (!book || !book->can_learn() || book_learned) {
+		return;
+	}
+
+	int score;
+	if (result == "1-0") {
+		score = 1;
+	} else if (result == "0-1") {
+		score = -1;
+	} else if (result == "1/2-1/2") {
+		score = 0;
+	} else {
+		return;
+	}
+	book_learned = true;
+
+	const unsigned int flags = GameEntry::FLAG_COMPUTER
+		| GameEntry::FLAG_BOOKMOVE;
+	unsigned int n = 0;
+	const std::list<GameEntry> & entries = game->get_entries();
+	for (std::list<GameEntry>::const_iterator it = entries.begin();
+			it != entries.end(); it++) {
+		if ((it->get_flags() & flags) != flags) {
+			continue;
+		}
+		if (book->learn(it->get_board(), it->get_move(),
+					(it->get_side() == WHITE)
+					? score : -score)) {
+			n++;
+		}
+	}
+
+	if (!xboard && n > 0) {
+		printf("Learned result %s for %u book move%s\n",
+				result.c_str(), n, (n == 1) ? "" : "s");
+	}
+}
+
@@ -27,6 +27,7 @@
 #include "hash.h"
 #include "search.h"
 #include "basic.h"
+#include "epdsolver.h"
 
 #include <string>
 #include <sstream>
@@ -91,6 +92,7 @@ class Shell
 	Game * game;
       private:
 	Book * book;
+	bool book_learned;	/* results of this game already learned */
 
 #ifdef WITH_THREAD
 	unsigned int parallel;
@@ -116,6 +118,9 @@ class Shell
 	 * interrupt() sets this flag to abort those commands. */
 	bool stop;
 
+	/* solver of a running "solve" command with several jobs */
+	EPDSolver * solver;
+
 	std::list<struct command> commands;
 	std::list<struct option> option_list;
 
@@ -132,7 +137,7 @@ class Shell
 	void interrupt();
 
       public:
-	void set_book(const char * bookfile);
+	void set_book(const char * bookfile, bool learn = false);
 	void set_hash_size(size_t bytes);
 	size_t get_hash_size() const;
 	void set_pawnhash_size(size_t bytes);
@@ -171,6 +176,7 @@ class Shell
 
       private:
 	void print_result();
+	void learn_book(const std::string & result);
 
       public:
 	void print_search_header();
@@ -205,6 +211,7 @@ class Shell
 	int cmd_otim();
 	int cmd_usermove();
 	int cmd_ping();
+	int cmd_result();
 	int cmd_setboard();
 	int cmd_bk();
 	int cmd_undo();
@@ -228,10 +235,17 @@ class Shell
 	int cmd_noxboard();
 	virtual int cmd_show();
 	int cmd_solve();
+	int cmd_perft();
+	int cmd_parsebench();
+	int cmd_evalbatch();
+	int cmd_evalparams();
+	int cmd_tune();
 	int cmd_book();
+	int cmd_gamedb();
 	int cmd_hash();
 	int cmd_pawnhash();
 	int cmd_evalcache();
+	int cmd_nnue();
 	int cmd_set();
 	int cmd_get();
 	int cmd_playboth();
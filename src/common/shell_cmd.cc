@@ -22,13 +22,23 @@
 #ifdef WITH_THREAD
 # include "parallelsearch.h"
 #endif
+#include "bookbuilder.h"
 #include "epd.h"
+#include "epdsolver.h"
+#include "gamedb.h"
+#include "moveparser.h"
 #include "pgn.h"
+#include "posindex.h"
+#include "tune.h"
+#ifdef HOICHESS
+# include "nnue.h"
+#endif
 
 #include <errno.h>
 #include <limits.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/time.h>
 
 #include <sstream>
 
@@ -56,7 +66,7 @@ const struct Shell::command Shell::shell_commands[] = {
 	{ "?",		&Shell::cmd_null,	""	},
 	{ "ping",	&Shell::cmd_ping,	""	},
 	{ "draw",	&Shell::cmd_null,	""	},
-	{ "result",	&Shell::cmd_null,	""	},
+	{ "result",	&Shell::cmd_result,	""	},
 	{ "setboard",	&Shell::cmd_setboard,	""	},
 	{ "edit",	NULL,			""	},
 	{ "hint",	NULL,			""	},
@@ -97,10 +107,17 @@ const struct Shell::command Shell::shell_commands[] = {
 	{ "noxboard",	&Shell::cmd_noxboard,	""	},
 	{ "show",	&Shell::cmd_show,	""	},
 	{ "solve",	&Shell::cmd_solve,	""	},
+	{ "perft",	&Shell::cmd_perft,	"Count leaf nodes of the legal move tree" },
+	{ "parsebench",	&Shell::cmd_parsebench,	"Benchmark the move parsers on a PGN file" },
+	{ "evalbatch",	&Shell::cmd_evalbatch,	"Evaluate all positions in a FEN/EPD file" },
+	{ "evalparams",	&Shell::cmd_evalparams,	"Show, save or load evaluation parameters" },
+	{ "tune",	&Shell::cmd_tune,	"Tune evaluation parameters on labelled positions" },
 	{ "book",	&Shell::cmd_book,	""	},
+	{ "gamedb",	&Shell::cmd_gamedb,	"Convert PGN to a binary game database, index positions" },
 	{ "hash",	&Shell::cmd_hash,	""	},
 	{ "pawnhash",	&Shell::cmd_pawnhash,	""	},
 	{ "evalcache",	&Shell::cmd_evalcache,	""	},
+	{ "nnue",	&Shell::cmd_nnue,	"Load and benchmark an NNUE network" },
 	{ "set",	&Shell::cmd_set,	""	},
 	{ "get",	&Shell::cmd_get,	""	},
 	{ "playboth",	&Shell::cmd_playboth,	""	},
@@ -210,6 +227,8 @@ int Shell::cmd_new()
 		flag_force = false;
 		myside = BLACK;
 	}
+	book_learned = false;
+	search->clear_history();
 
 	return SHELL_CMD_OK;
 }
@@ -386,6 +405,17 @@ int Shell::cmd_ping()
 	return SHELL_CMD_OK;
 }
 
+/*
+ * xboard reports the end of the game, also if it was not detected by
+ * us, e.g. when a player resigns or loses on time.
+ */
+int Shell::cmd_result()
+{
+	SHELL_CMD_REQUIRE_ARGS(1);
+	learn_book(cmd_args[1]);
+	return SHELL_CMD_OK;
+}
+
 int Shell::cmd_setboard()
 {
 	stop_search();
@@ -410,6 +440,7 @@ int Shell::cmd_setboard()
 		}
 		return SHELL_CMD_FAIL;
 	}
+	search->clear_history();
 	
 	if (verbose) {
 		print_result();
@@ -719,6 +750,10 @@ int Shell::cmd_show()
 		printf("--------------------------------------------------\n");
 		printf("Evaluation if I would play black:\n");
 		eval.print_eval(board, BLACK);
+	} else if (param == "evalprofile") {
+		/* profile of the last search, see option
+		 * search_eval_profile */
+		search->print_evalprofile();
 	} else if (param == "clocks") {
 		printf("[White]\n"); game->get_clock(WHITE)->print();
 		printf("\n[Black]\n"); game->get_clock(BLACK)->print();
@@ -730,6 +765,7 @@ int Shell::cmd_show()
 		printf("Usage: show {board|fen}\n");
 		printf("       show {moves|captures|noncaptures|escapes}\n");
 		printf("       show eval\n");
+		printf("       show evalprofile\n");
 		printf("       show clocks\n");
 		printf("       show game\n");
 		printf("       show pgn\n");
@@ -738,12 +774,173 @@ int Shell::cmd_show()
 	return SHELL_CMD_OK;
 }
 
+/*
+ * Number of leaf nodes of the legal move tree below board, with
+ * depth > 0. Used to verify and benchmark the move generators.
+ */
+static unsigned long long perft(const Board & board, unsigned int depth)
+{
+	Movelist moves;
+	board.generate_moves(&moves);
+
+	unsigned long long nodes = 0;
+	for (unsigned int i=0; i<moves.size(); i++) {
+		Board b = board;
+		b.make_move(moves[i]);
+		if (!b.is_legal()) {
+			continue;
+		}
+		nodes += (depth > 1) ? perft(b, depth - 1) : 1;
+	}
+
+	return nodes;
+}
+
+int Shell::cmd_perft()
+{
+	stop_search();
+
+	SHELL_CMD_REQUIRE_ARGS(1);
+	char * endptr;
+	unsigned long depth = strtoul(cmd_args[1].c_str(), &endptr, 10);
+	if (*endptr != '\0' || depth == 0) {
+		printf("Usage: perft <depth>\n");
+		return SHELL_CMD_FAIL;
+	}
+
+	const Board & board = game->get_board();
+
+	struct timeval tv_start, tv_end;
+	gettimeofday(&tv_start, NULL);
+	unsigned long long nodes = perft(board, depth);
+	gettimeofday(&tv_end, NULL);
+
+	unsigned long long usecs =
+		(tv_end.tv_sec - tv_start.tv_sec) * 1000000ULL
+		+ tv_end.tv_usec - tv_start.tv_usec;
+	printf("perft %lu: %llu nodes, %llu ms, %.0f knps\n",
+			depth, nodes, usecs / 1000,
+			usecs ? (double) nodes * 1000 / usecs : 0.0);
+
+	return SHELL_CMD_OK;
+}
+
+/*
+ * parsebench <pgnfile> [<games>]
+ *
+ * Parse the SAN of every move in the first games of a PGN file with
+ * Board::parse_move(), Board::parse_move_1() and MoveParser::parse(),
+ * and print the moves parsed per second.
+ */
+int Shell::cmd_parsebench()
+{
+	SHELL_CMD_REQUIRE_ARGS(1);
+	const char * filename = cmd_args[1].c_str();
+
+	unsigned long max_games = 1000;
+	if (cmd_args.size() > 2) {
+		char * endptr;
+		max_games = strtoul(cmd_args[2].c_str(), &endptr, 10);
+		if (*endptr != '\0' || max_games == 0) {
+			printf("Usage: parsebench <pgnfile> [<games>]\n");
+			return SHELL_CMD_FAIL;
+		}
+	}
+
+	FILE * fp = fopen(filename, "r");
+	if (fp == NULL) {
+		printf("Cannot open %s: %s\n", filename, strerror(errno));
+		return SHELL_CMD_FAIL;
+	}
+
+	static const char * const names[] = {
+		"Board::parse_move()",
+		"Board::parse_move_1()",
+		"MoveParser::parse()"
+	};
+	const unsigned int nr_parsers = sizeof(names) / sizeof(names[0]);
+	unsigned long long usecs[nr_parsers] = { 0, 0, 0 };
+	unsigned long errors[nr_parsers] = { 0, 0, 0 };
+
+	unsigned long games = 0, moves = 0;
+	while (games < max_games) {
+		PGN pgn;
+		if (!pgn.parse(fp)) {
+			break;
+		}
+
+		/* SAN of each move and the position before it */
+		std::vector<Board> boards;
+		std::vector<std::string> sans;
+		std::vector<Move> expected;
+		Board board = pgn.get_opening();
+		for (std::list<Move>::const_iterator it
+				= pgn.get_moves().begin();
+				it != pgn.get_moves().end(); it++) {
+			boards.push_back(board);
+			sans.push_back(it->san(board));
+			expected.push_back(*it);
+			board.make_move(*it);
+		}
+
+		for (unsigned int k=0; k<nr_parsers; k++) {
+			struct timeval tv_start, tv_end;
+			gettimeofday(&tv_start, NULL);
+			for (size_t i=0; i<sans.size(); i++) {
+				Move mov;
+				switch (k) {
+				case 0:
+					mov = boards[i].parse_move(sans[i]);
+					break;
+				case 1:
+					mov = boards[i].parse_move_1(sans[i]);
+					break;
+				default:
+					mov = MoveParser::parse(boards[i],
+							sans[i]);
+					break;
+				}
+				if (mov != expected[i]) {
+					errors[k]++;
+				}
+			}
+			gettimeofday(&tv_end, NULL);
+			usecs[k] += (tv_end.tv_sec - tv_start.tv_sec)
+				* 1000000ULL
+				+ tv_end.tv_usec - tv_start.tv_usec;
+		}
+
+		games++;
+		moves += sans.size();
+	}
+	fclose(fp);
+
+	printf("%lu games, %lu moves\n", games, moves);
+	for (unsigned int k=0; k<nr_parsers; k++) {
+		printf("%-24s %8llu ms %12.0f moves/s  %lu errors\n",
+				names[k], usecs[k] / 1000,
+				usecs[k] ? (double) moves * 1000000
+				/ usecs[k] : 0.0, errors[k]);
+	}
+
+	return SHELL_CMD_OK;
+}
+
 int Shell::cmd_solve()
 {
 	stop_search();
 	
 	SHELL_CMD_REQUIRE_ARGS(1);
 	const char * filename = cmd_args[1].c_str();
+
+	unsigned int jobs = 1;
+	if (cmd_args.size() > 2) {
+		if (sscanf(cmd_args[2].c_str(), "%u", &jobs) != 1
+				|| jobs == 0) {
+			printf("Usage: solve <epdfile> [<jobs>]\n");
+			return SHELL_CMD_FAIL;
+		}
+	}
 	
 	FILE * fp;
 	bool close_fp;
@@ -760,110 +957,270 @@ int Shell::cmd_solve()
 		close_fp = true;
 	}
 
-	int right = 0;
-	int wrong = 0;
-	int total = 0;
-	int skipped = 0;
-	
-	char buf[1024];
-	while (fgets(buf, sizeof(buf), fp) != NULL) {
-		/* Strip trailing \n and \r */
-		while (buf[strlen(buf)-1] == '\n' || buf[strlen(buf)-1] == '\r') {
-			buf[strlen(buf)-1] = '\0';
+	/* Several positions at once. The threads set by the 'cores'
+	 * command are divided among the jobs, and so are the tables.
+	 * Otherwise, the positions are searched one after another by our
+	 * own search. */
+	EPDSolver * s;
+	if (jobs > 1) {
+		unsigned int nthreads = 1;
+#ifdef WITH_THREAD
+		if (parallel > jobs) {
+			nthreads = parallel / jobs;
 		}
+#endif
+		s = new EPDSolver(this, jobs, nthreads, hashsize,
+				pawnhashsize, evalcachesize,
+				*game->get_clock(), maxdepth);
+	} else {
+		/* Must copy the clock from the game because this is set
+		 * to the desired time limit. */
+		s = new EPDSolver(search, *game->get_clock(), maxdepth);
+	}
+	solver = s;
+	s->run(fp);
+	solver = NULL;
+	delete s;
 
-		if (strcmp(buf, ".") == 0) {
-			break;
+	if (close_fp) {
+		fclose(fp);
+	}
+
+	return SHELL_CMD_OK;
+}
+
+/* number of positions cmd_evalbatch() reads and evaluates at once */
+#define EVALBATCH_CHUNK 65536
+
+/*
+ * evalbatch <infile> [<outfile>]
+ *
+ * Read positions (one FEN or EPD per line) and write the static
+ * evaluation and the quiescence search score of each, from the side
+ * to move's point of view, followed by the FEN. The work is split
+ * among as many threads as set by the 'cores' command. Each thread
+ * uses its own Search object without hash table and caches, so the
+ * engine's tables are not affected.
+ */
+int Shell::cmd_evalbatch()
+{
+	stop_search();
+
+	SHELL_CMD_REQUIRE_ARGS(1);
+	const char * filename = cmd_args[1].c_str();
+	FILE * fp = fopen(filename, "r");
+	if (fp == NULL) {
+		printf("Cannot open %s: %s\n", filename, strerror(errno));
+		return SHELL_CMD_FAIL;
+	}
+
+	FILE * out = stdout;
+	if (cmd_args.size() > 2) {
+		out = fopen(cmd_args[2].c_str(), "w");
+		if (out == NULL) {
+			printf("Cannot open %s: %s\n", cmd_args[2].c_str(),
+					strerror(errno));
+			fclose(fp);
+			return SHELL_CMD_FAIL;
 		}
+	}
 
-		printf("--------------------------------------------------\n");
-		
-		/* Parse EPD, print FEN */
-		EPD epd(buf);
-		Board board(epd.get_fen().c_str());
-		printf("[%s] %s\n", 
-				epd.get1("id").c_str(),
-				epd.get_fen().c_str());
-
-		/* Get the list of best moves */
-		std::list<Move> bms = epd.get_bm();
-		if (bms.size() == 0) {
-			printf("No best move associated to this position,"
-					" skipping.\n");
-			skipped++;
+	unsigned int nthreads = 1;
+#ifdef WITH_THREAD
+	if (parallel > 1) {
+		nthreads = parallel;
+	}
+#endif
+	std::vector<Search *> searches;
+	for (unsigned int t=0; t<nthreads; t++) {
+		Search * worker = new Search(this);
+		worker->reset_statistics();
+		searches.push_back(worker);
+	}
+
+	std::vector<Board> boards;
+	std::vector<std::string> fens;
+	std::vector<struct Search::evalresult> results;
+	boards.reserve(EVALBATCH_CHUNK);
+	fens.reserve(EVALBATCH_CHUNK);
+	results.resize(EVALBATCH_CHUNK);
+
+	unsigned long total = 0;
+	unsigned long skipped = 0;
+	unsigned long lineno = 0;
+
+	struct timeval tv_start, tv_end;
+	gettimeofday(&tv_start, NULL);
+
+	char buf[1024];
+	bool eof = false;
+	while (!eof) {
+		/* read a chunk of positions */
+		boards.clear();
+		fens.clear();
+		while (boards.size() < EVALBATCH_CHUNK) {
+			if (fgets(buf, sizeof(buf), fp) == NULL) {
+				eof = true;
+				break;
+			}
+			lineno++;
+			size_t len = strlen(buf);
+			while (len > 0 && (buf[len-1] == '\n'
+						|| buf[len-1] == '\r')) {
+				buf[--len] = '\0';
+			}
+			if (len == 0 || buf[0] == '#') {
+				continue;
+			}
+
+			Board board;
+			std::string fen = buf;
+			if (!board.parse_fen(fen)) {
+				fen = EPD(buf).get_fen();
+				if (!board.parse_fen(fen)) {
+					printf("%s:%lu: cannot parse position\n",
+							filename, lineno);
+					skipped++;
+					continue;
+				}
+			}
+			if (!board.is_legal()) {
+				printf("%s:%lu: illegal position\n",
+						filename, lineno);
+				skipped++;
+				continue;
+			}
+			boards.push_back(board);
+			fens.push_back(fen);
+		}
+
+		size_t n = boards.size();
+		if (n == 0) {
 			continue;
 		}
 
-		/* Print the list of best moves */
-		printf("[%s] best move:", epd.get1("id").c_str());
-		for (std::list<Move>::const_iterator it = bms.begin();
-				it != bms.end(); it++) {
-			printf(" %s", it->san(board).c_str());
+		Search::evaluate_batch_parallel(&searches[0], nthreads,
+				&boards[0], n, &results[0]);
+
+		for (size_t i=0; i<n; i++) {
+			fprintf(out, "%d %d %s\n", results[i].eval,
+					results[i].quiesce, fens[i].c_str());
 		}
-		printf("\n");
+		total += n;
+	}
 
-		/* Reset search stuff */
-		search->clear_hash();
-		search->clear_pawnhash();
-		search->clear_evalcache();
+	gettimeofday(&tv_end, NULL);
+	unsigned long long usecs =
+		(tv_end.tv_sec - tv_start.tv_sec) * 1000000ULL
+		+ tv_end.tv_usec - tv_start.tv_usec;
 
-		/* Must copy the clock from the game because this is set
-		 * to the desired time limit. If a previous search was
-		 * interrupted, we might get here with a running clock,
-		 * so restart its copy. */
-		Clock clock = *game->get_clock();
-		clock.stop();
-		clock.turn_back();
-		clock.start();
-
-		/* Start search */
-		printf("\n");
-		board.print_small();
-		printf("\n");
-		printf("Thinking...\n");
-		Move mov = search->start(board, clock, Search::MOVE, maxdepth);
-		if (!mov) {
-			printf("Warning: search returned NO_MOVE"
-					", excluding position from result\n");
-			continue;
+	unsigned long long nodes = 0;
+	for (unsigned int t=0; t<nthreads; t++) {
+		nodes += searches[t]->get_nodes_quiesce();
+		delete searches[t];
+	}
+
+	fclose(fp);
+	if (out != stdout) {
+		fclose(out);
+	}
+
+	printf("evalbatch: %lu positions, %lu skipped, %u thread%s,"
+			" %llu ms, %.0f positions/s, %llu q-nodes\n",
+			total, skipped, nthreads, (nthreads == 1 ? "" : "s"),
+			usecs / 1000,
+			usecs ? (double) total * 1000000 / usecs : 0.0,
+			nodes);
+
+	return SHELL_CMD_OK;
+}
+
+/*
+ * evalparams show
+ * evalparams save <file>
+ * evalparams load <file>
+ */
+int Shell::cmd_evalparams()
+{
+	SHELL_CMD_REQUIRE_ARGS(1);
+	const std::string param = cmd_args[1];
+
+	if (param == "show") {
+		Evaluator::print_params();
+	} else if (param == "save") {
+		SHELL_CMD_REQUIRE_ARGS(2);
+		if (!Evaluator::save_params(cmd_args[2].c_str())) {
+			return SHELL_CMD_FAIL;
 		}
-		
-		/* Look if our move is among the best. */
-		bool correct = false;
-		std::list<Move>::const_iterator it;
-		for (it = bms.begin(); it != bms.end(); it++) {
-			if (*it == mov) {
-				right++;
-				correct = true;
-				break;
-			}
+	} else if (param == "load") {
+		SHELL_CMD_REQUIRE_ARGS(2);
+		stop_search();
+		if (!Evaluator::load_params(cmd_args[2].c_str())) {
+			return SHELL_CMD_FAIL;
 		}
-		if (it == bms.end()) {
-			wrong++;
-			correct = false;
+		game->update_psq();
+		search->clear_pawnhash();
+		search->clear_evalcache();
+	} else {
+		printf("Usage: evalparams show\n");
+		printf("       evalparams save <file>\n");
+		printf("       evalparams load <file>\n");
+	}
+
+	return SHELL_CMD_OK;
+}
+
+/*
+ * tune <file> [<passes> [<param> ...]]
+ *
+ * Tune the given evaluation parameters (default: all) on the positions
+ * with game results in file, using as many threads as set by the
+ * 'cores' command. The result can be saved with 'evalparams save'.
+ */
+int Shell::cmd_tune()
+{
+	stop_search();
+
+	SHELL_CMD_REQUIRE_ARGS(1);
+	unsigned long passes = 1;
+	if (cmd_args.size() > 2) {
+		char * endptr;
+		passes = strtoul(cmd_args[2].c_str(), &endptr, 10);
+		if (*endptr != '\0' || passes == 0) {
+			printf("Usage: tune <file> [<passes> [<param> ...]]\n");
+			return SHELL_CMD_FAIL;
 		}
-		
-		printf("My move: %s (%s)\n", mov.san(board).c_str(),
-				correct ? "correct" : "incorrect");
-		
-		total = right + wrong;
-		printf("Correct: %d of %d (%d%%), skipped: %d\n",
-				right, total, 100 * right / total, skipped);
-		printf("SOLVE %u %u %s %u %s\n",
-				total, right,
-				mov.san(board).c_str(), correct,
-				epd.get1("id").c_str());
-
-		if (stop) {
-			break;
+	}
+	std::vector<std::string> names;
+	for (size_t i=3; i<cmd_args.size(); i++) {
+		if (Evaluator::find_param(cmd_args[i].c_str()) == NULL) {
+			printf("Unknown parameter: %s\n", cmd_args[i].c_str());
+			return SHELL_CMD_FAIL;
 		}
-	}	
+		names.push_back(cmd_args[i]);
+	}
+	if (get_option_search_eval_nnue()) {
+		printf("The search uses NNUE evaluation,"
+				" set search_eval_nnue=0 first\n");
+		return SHELL_CMD_FAIL;
+	}
 
-	printf("SOLVE_DONE %u %u\n", total, right);
+	unsigned int nthreads = 1;
+#ifdef WITH_THREAD
+	if (parallel > 1) {
+		nthreads = parallel;
+	}
+#endif
 
-	if (close_fp) {
-		fclose(fp);
+	Tuner tuner(this, nthreads);
+	if (!tuner.load(cmd_args[1].c_str())) {
+		return SHELL_CMD_FAIL;
 	}
+	tuner.tune(passes, names);
+
+	game->update_psq();
+	search->clear_pawnhash();
+	search->clear_evalcache();
 
 	return SHELL_CMD_OK;
 }
@@ -880,6 +1237,14 @@ int Shell::cmd_book()
 		SHELL_CMD_REQUIRE_ARGS(2);
 		const char * file = cmd_args[2].c_str();
 		set_book(file);
+	} else if (param == "learn") {
+		SHELL_CMD_REQUIRE_ARGS(2);
+		const char * file = cmd_args[2].c_str();
+		set_book(file, true);
+		if (book && !book->can_learn()) {
+			printf("Warning: learning needs a book with sorted"
+					" layout\n");
+		}
 	} else if (param == "create") {
 		SHELL_CMD_REQUIRE_ARGS(5);
 		const char * destfile = cmd_args[2].c_str();
@@ -896,15 +1261,190 @@ int Shell::cmd_book()
 					" non-negative integer\n");
 			return SHELL_CMD_FAIL;
 		}
+		ssize_t memory = BookBuilder::DEFAULT_MEMORY;
+		Book::Format format = Book::FORMAT_HASH;
+#ifdef HOICHESS
+		if (Book::is_polyglot_file(destfile)) {
+			format = Book::FORMAT_POLYGLOT;
+		}
+#endif
+		for (size_t i=6; i<cmd_args.size(); i++) {
+			if (cmd_args[i] == "sorted"
+					&& format == Book::FORMAT_HASH) {
+				format = Book::FORMAT_SORTED;
+			} else if (!parse_size(cmd_args[i].c_str(), &memory)
+					|| memory <= 0) {
+				printf("Error: illegal value for <memory>: %s\n",
+						cmd_args[i].c_str());
+				return SHELL_CMD_FAIL;
+			}
+		}
+
+		unsigned int nthreads = 1;
+#ifdef WITH_THREAD
+		if (parallel > 1) {
+			nthreads = parallel;
+		}
+#endif
 
 		printf("Creating opening book `%s' from `%s' ...\n",
 				destfile, srcfile);
-		Book::create_from_pgn(destfile, srcfile, depth, min_move_count);
+		if (!Book::create_from_pgn(destfile, srcfile, depth,
+					min_move_count, memory, nthreads,
+					format)) {
+			return SHELL_CMD_FAIL;
+		}
 	} else {
 		printf("Usage: book close\n");
 		printf("       book open <bookfile>\n");
+		printf("       book learn <bookfile>\n");
 		printf("       book create <bookfile> <pgnfile> <depth>"
-							" <min_move_count>\n");
+					" <min_move_count> [<memory>] [sorted]\n");
+#ifdef HOICHESS
+		printf("A <bookfile> ending in .bin is a Polyglot book.\n");
+#endif
+	}
+
+	return SHELL_CMD_OK;
+}
+
+int Shell::cmd_gamedb()
+{
+	SHELL_CMD_REQUIRE_ARGS(1);
+	const std::string param = cmd_args[1];
+
+	if (param == "create") {
+		SHELL_CMD_REQUIRE_ARGS(3);
+		const char * destfile = cmd_args[2].c_str();
+		const char * srcfile = cmd_args[3].c_str();
+
+		unsigned int nthreads = 1;
+#ifdef WITH_THREAD
+		if (parallel > 1) {
+			nthreads = parallel;
+		}
+#endif
+
+		printf("Creating game database `%s' from `%s' ...\n",
+				destfile, srcfile);
+		if (!GameDB::create_from_pgn(destfile, srcfile, nthreads)) {
+			return SHELL_CMD_FAIL;
+		}
+	} else if (param == "replay") {
+		/* for benchmarking */
+		SHELL_CMD_REQUIRE_ARGS(2);
+		bool ok;
+		GameDB db(cmd_args[2].c_str(), &ok);
+		if (!ok) {
+			return SHELL_CMD_FAIL;
+		}
+
+		struct timeval tv_start, tv_end;
+		gettimeofday(&tv_start, NULL);
+		unsigned long games = 0, moves = 0;
+		PGN pgn;
+		for (unsigned long i=0; i<db.size(); i++) {
+			if (db.read(i, &pgn, false)) {
+				games++;
+				moves += pgn.get_moves().size();
+			}
+		}
+		gettimeofday(&tv_end, NULL);
+
+		const double secs = (tv_end.tv_sec - tv_start.tv_sec)
+			+ (tv_end.tv_usec - tv_start.tv_usec) / 1000000.0;
+		printf("%lu games, %lu moves replayed in %.2f s,"
+				" %.0f games/s\n", games, moves, secs,
+				secs > 0 ? games / secs : 0.0);
+	} else if (param == "index") {
+		SHELL_CMD_REQUIRE_ARGS(3);
+		const char * destfile = cmd_args[2].c_str();
+		const char * srcfile = cmd_args[3].c_str();
+		ssize_t memory = PositionIndex::DEFAULT_MEMORY;
+		if (cmd_args.size() > 4 && (!parse_size(cmd_args[4].c_str(),
+						&memory) || memory <= 0)) {
+			printf("Error: illegal value for <memory>: %s\n",
+					cmd_args[4].c_str());
+			return SHELL_CMD_FAIL;
+		}
+
+		printf("Creating position index `%s' from `%s' ...\n",
+				destfile, srcfile);
+		if (!PositionIndex::create(destfile, srcfile, memory)) {
+			return SHELL_CMD_FAIL;
+		}
+	} else if (param == "find") {
+		/* gamedb find <indexfile> [<dbfile>] */
+		SHELL_CMD_REQUIRE_ARGS(2);
+		bool ok;
+		PositionIndex index(cmd_args[2].c_str(), &ok);
+		if (!ok) {
+			return SHELL_CMD_FAIL;
+		}
+
+		const Board & board = game->get_board();
+		struct timeval tv_start, tv_end;
+		gettimeofday(&tv_start, NULL);
+		std::vector<PositionIndexEntry> entries;
+		index.find(board.get_hashkey(), &entries);
+		gettimeofday(&tv_end, NULL);
+
+		const double msecs = (tv_end.tv_sec - tv_start.tv_sec) * 1000.0
+			+ (tv_end.tv_usec - tv_start.tv_usec) / 1000.0;
+		/* entries of the same game are adjacent */
+		unsigned long games = 0;
+		for (size_t i=0; i<entries.size(); i++) {
+			if (i == 0 || entries[i].game != entries[i-1].game) {
+				games++;
+			}
+		}
+		printf("Position found %lu times in %lu of %lu games"
+				" (%.2f ms)\n", (unsigned long) entries.size(),
+				games, index.get_nr_games(), msecs);
+		if (entries.empty()) {
+			return SHELL_CMD_OK;
+		}
+		index.print_statistics(board, entries);
+
+		/* list the first games if the database is given */
+		if (cmd_args.size() > 3) {
+			GameDB db(cmd_args[3].c_str(), &ok);
+			if (!ok) {
+				return SHELL_CMD_FAIL;
+			} else if (db.size() != index.get_nr_games()) {
+				printf("Error: %s does not belong to %s\n",
+						cmd_args[3].c_str(),
+						cmd_args[2].c_str());
+				return SHELL_CMD_FAIL;
+			}
+
+			PGN pgn;
+			unsigned long listed = 0;
+			for (size_t i=0; i<entries.size() && listed<10; i++) {
+				if (i > 0 && entries[i].game
+						== entries[i-1].game) {
+					continue;
+				}
+				listed++;
+				if (!db.read(entries[i].game, &pgn)) {
+					continue;
+				}
+				std::map<std::string, std::string> tags
+					= pgn.get_tags();
+				printf(" %7lu  %s - %s  %s  (ply %u)\n",
+						(unsigned long) entries[i].game + 1,
+						tags["White"].c_str(),
+						tags["Black"].c_str(),
+						tags["Result"].c_str(),
+						entries[i].ply);
+			}
+		}
+	} else {
+		printf("Usage: gamedb create <dbfile> <pgnfile>\n");
+		printf("       gamedb replay <dbfile>\n");
+		printf("       gamedb index <indexfile> <dbfile>"
+				" [<memory>]\n");
+		printf("       gamedb find <indexfile> [<dbfile>]\n");
 	}
 
 	return SHELL_CMD_OK;
@@ -1002,6 +1542,148 @@ int Shell::cmd_evalcache()
 	return SHELL_CMD_OK;
 }
 
+#ifdef HOICHESS
+/*
+ * Benchmark the network on the children of board: incremental update
+ * of the accumulator plus evaluation, and full refreshes, for each
+ * available kernel.
+ */
+static void nnue_bench(NNUE * net, const Board & board, unsigned long count)
+{
+	Movelist moves;
+	board.generate_moves(&moves);
+
+	std::vector<Board> children;
+	for (unsigned int i=0; i<moves.size(); i++) {
+		Board b = board;
+		b.make_move(moves[i]);
+		if (b.is_legal()) {
+			children.push_back(b);
+		}
+	}
+	if (children.empty()) {
+		children.push_back(board);
+	}
+
+	const enum NNUE::kernel_type save_kernel = net->get_kernel();
+	NNUEAccumulator rootacc, acc;
+
+	for (int k=NNUE::KERNEL_SCALAR; k<=NNUE::KERNEL_AVX2; k++) {
+		if (!net->set_kernel((enum NNUE::kernel_type) k)) {
+			continue;
+		}
+		net->refresh(board, &rootacc);
+
+		struct timeval tv_start, tv_end;
+		long sum = 0;
+		gettimeofday(&tv_start, NULL);
+		for (unsigned long i=0; i<count; i++) {
+			const Board & b = children[i % children.size()];
+			net->update(board, b, rootacc, &acc);
+			sum += net->evaluate(b, acc);
+		}
+		gettimeofday(&tv_end, NULL);
+		unsigned long long usecs_eval =
+			(tv_end.tv_sec - tv_start.tv_sec) * 1000000ULL
+			+ tv_end.tv_usec - tv_start.tv_usec;
+
+		gettimeofday(&tv_start, NULL);
+		for (unsigned long i=0; i<count; i++) {
+			net->refresh(children[i % children.size()], &acc);
+		}
+		gettimeofday(&tv_end, NULL);
+		unsigned long long usecs_refresh =
+			(tv_end.tv_sec - tv_start.tv_sec) * 1000000ULL
+			+ tv_end.tv_usec - tv_start.tv_usec;
+
+		printf("%-6s  %10.0f evals/s  %10.0f refreshes/s"
+				"  (checksum %ld)\n",
+				NNUE::kernel_name((enum NNUE::kernel_type) k),
+				usecs_eval ? count * 1e6 / usecs_eval : 0.0,
+				usecs_refresh ? count * 1e6 / usecs_refresh
+					: 0.0,
+				sum);
+	}
+
+	net->set_kernel(save_kernel);
+}
+#endif
+
+int Shell::cmd_nnue()
+{
+#ifdef HOICHESS
+	SHELL_CMD_REQUIRE_ARGS(1);
+	const std::string param = cmd_args[1];
+	NNUE * net = NNUE::get_network();
+
+	if (param == "load") {
+		SHELL_CMD_REQUIRE_ARGS(2);
+		stop_search();
+		NNUE * newnet = new NNUE();
+		if (!newnet->load(cmd_args[2].c_str())) {
+			delete newnet;
+			return SHELL_CMD_FAIL;
+		}
+		NNUE::set_network(newnet);
+		newnet->print_info();
+		if (!get_option_search_eval_nnue()) {
+			printf("Use 'option search_eval_nnue=1'"
+					" to enable it in the search\n");
+		}
+	} else if (param == "unload") {
+		stop_search();
+		NNUE::set_network(NULL);
+	} else if (param == "info" || param == "kernel" || param == "bench") {
+		if (net == NULL) {
+			printf("No network loaded\n");
+			return SHELL_CMD_FAIL;
+		}
+		if (param == "info") {
+			net->print_info();
+		} else if (param == "kernel") {
+			SHELL_CMD_REQUIRE_ARGS(2);
+			stop_search();
+			int k;
+			for (k=NNUE::KERNEL_SCALAR; k<=NNUE::KERNEL_AVX2; k++) {
+				if (cmd_args[2] == NNUE::kernel_name(
+						(enum NNUE::kernel_type) k)) {
+					break;
+				}
+			}
+			if (k > NNUE::KERNEL_AVX2 || !net->set_kernel(
+					(enum NNUE::kernel_type) k)) {
+				printf("Kernel not available: %s\n",
+						cmd_args[2].c_str());
+				return SHELL_CMD_FAIL;
+			}
+		} else {
+			unsigned long count = 1000000;
+			if (cmd_args.size() > 2) {
+				char * endptr;
+				count = strtoul(cmd_args[2].c_str(), &endptr, 10);
+				if (*endptr != '\0' || count == 0) {
+					printf("Usage: nnue bench [count]\n");
+					return SHELL_CMD_FAIL;
+				}
+			}
+			stop_search();
+			nnue_bench(net, game->get_board(), count);
+		}
+	} else {
+		printf("Usage: nnue load <file>\n");
+		printf("       nnue unload\n");
+		printf("       nnue info\n");
+		printf("       nnue kernel {scalar|sse2|avx2}\n");
+		printf("       nnue bench [count]\n");
+	}
+
+	return SHELL_CMD_OK;
+#else
+	printf("NNUE evaluation is only available for chess\n");
+	return SHELL_CMD_FAIL;
+#endif
+}
+
 int Shell::cmd_set()
 {
 	SHELL_CMD_REQUIRE_ARGS(1);
@@ -1054,16 +1736,40 @@ int Shell::cmd_loadgame()
 	SHELL_CMD_REQUIRE_ARGS(1);
 	const char * pgnfile  = cmd_args[1].c_str();
 
-	FILE* fp = fopen(pgnfile, "r");
-	if (fp == NULL) {
-		fprintf(stderr, "Cannot open %s for reading: %s\n",
-				pgnfile, strerror(errno));
-		return SHELL_CMD_FAIL;
-	}
-
 	PGN pgn;
-	pgn.parse(fp);
-	fclose(fp);
+	if (GameDB::is_gamedb(pgnfile)) {
+		/* loadgame <dbfile> [<n>], counting from 1 */
+		unsigned long n = 1;
+		if (cmd_args.size() > 2 && (sscanf(cmd_args[2].c_str(),
+						"%lu", &n) != 1 || n == 0)) {
+			printf("Error: illegal game number: %s\n",
+					cmd_args[2].c_str());
+			return SHELL_CMD_FAIL;
+		}
+		bool ok;
+		GameDB db(pgnfile, &ok);
+		if (!ok) {
+			return SHELL_CMD_FAIL;
+		} else if (n > db.size()) {
+			printf("Error: %s has only %lu games\n",
+					pgnfile, db.size());
+			return SHELL_CMD_FAIL;
+		} else if (!db.read(n - 1, &pgn)) {
+			printf("Error: game %lu in %s is corrupt\n",
+					n, pgnfile);
+			return SHELL_CMD_FAIL;
+		}
+	} else {
+		FILE* fp = fopen(pgnfile, "r");
+		if (fp == NULL) {
+			fprintf(stderr, "Cannot open %s for reading: %s\n",
+					pgnfile, strerror(errno));
+			return SHELL_CMD_FAIL;
+		}
+
+		pgn.parse(fp);
+		fclose(fp);
+	}
 
 	Game g(pgn, Clock(), Clock());
 	printf("--- begin read game ---\n");
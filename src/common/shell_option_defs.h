@@ -2,6 +2,7 @@
 SHELL_DEFINE_OPTION(search_update_interval_csecs, 500);
 SHELL_DEFINE_OPTION(search_timecheck_interval_csecs_min, 2);
 SHELL_DEFINE_OPTION(search_timecheck_interval_csecs_max, 5);
+SHELL_DEFINE_OPTION(search_timer_thread, 1);
 
 SHELL_DEFINE_OPTION(search_extend_time_iteration_enable, 1);
 SHELL_DEFINE_OPTION(search_extend_time_iteration_min_percent_done, 75);
@@ -9,12 +10,39 @@ SHELL_DEFINE_OPTION(search_extend_time_iteration_expect_safety_factor_tenth, 11)
 SHELL_DEFINE_OPTION(search_extend_time_iteration_extend_safety_factor_tenth, 10);
 SHELL_DEFINE_OPTION(search_time_for_new_iteration_enable, 1);
 SHELL_DEFINE_OPTION(search_time_for_new_iteration_expect_factor_tenth, 15);
+SHELL_DEFINE_OPTION(search_solve_stable_iterations, 0);
 
 SHELL_DEFINE_OPTION(search_parallel_min_depth, 6);
 SHELL_DEFINE_OPTION(search_parallel_min_move_ratio, 2);
 SHELL_DEFINE_OPTION(search_parallel_hash_pvtable, 0);
 SHELL_DEFINE_OPTION(search_parallel_shared_hash, 0);
+SHELL_DEFINE_OPTION(search_parallel_shared_pawnhash, 0);
+SHELL_DEFINE_OPTION(search_parallel_shared_evalcache, 0);
 SHELL_DEFINE_OPTION(search_parallel_pvs_mode, 1);
 
+SHELL_DEFINE_OPTION(search_eval_profile, 0);
+SHELL_DEFINE_OPTION(search_eval_nnue, 0);
+
 SHELL_DEFINE_OPTION(search_failsoft, 0);
 SHELL_DEFINE_OPTION(search_pvs_mode, 1);
+
+SHELL_DEFINE_OPTION(search_aspiration_window, 25);
+SHELL_DEFINE_OPTION(search_aspiration_volatility_percent, 50);
+SHELL_DEFINE_OPTION(search_aspiration_widen_factor_tenth, 25);
+SHELL_DEFINE_OPTION(search_aspiration_max_window, 600);
+
+SHELL_DEFINE_OPTION(search_null_enable, 1);
+SHELL_DEFINE_OPTION(search_null_reduction, 2);
+SHELL_DEFINE_OPTION(search_null_depth_divisor, 6);
+SHELL_DEFINE_OPTION(search_null_eval_margin, 200);
+SHELL_DEFINE_OPTION(search_null_verify, 1);
+
+SHELL_DEFINE_OPTION(search_rfp_enable, 1);
+SHELL_DEFINE_OPTION(search_rfp_max_depth, 3);
+SHELL_DEFINE_OPTION(search_rfp_margin, 150);
+
+SHELL_DEFINE_OPTION(search_lmr_enable, 1);
+SHELL_DEFINE_OPTION(search_lmr_min_depth, 3);
+SHELL_DEFINE_OPTION(search_lmr_min_moves, 4);
+SHELL_DEFINE_OPTION(search_lmr_base_tenth, 5);
+SHELL_DEFINE_OPTION(search_lmr_divisor_tenth, 25);
@@ -0,0 +1,302 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "tune.h"
+#include "epd.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+
+Tuner::Tuner(Shell * shell, unsigned int nthreads)
+{
+	ASSERT(nthreads > 0);
+	for (unsigned int t=0; t<nthreads; t++) {
+		/* no hash table and caches, so that the scores always
+		 * reflect the current parameters */
+		Search * search = new Search(shell);
+		search->reset_statistics();
+		searches.push_back(search);
+	}
+
+	k = 1.0;
+	evaluations = 0;
+	usecs = 0;
+}
+
+Tuner::~Tuner()
+{
+	for (size_t t=0; t<searches.size(); t++) {
+		delete searches[t];
+	}
+}
+
+/*
+ * Find the game result in a line of the position file. Accepted are
+ * "1-0", "0-1" and "1/2-1/2" anywhere in the line (e.g. as EPD
+ * comment c9 "1-0";), or a number in brackets like [0.5].
+ */
+bool Tuner::parse_result(const char * s, float * result) /* static */
+{
+	if (strstr(s, "1/2-1/2") != NULL) {
+		*result = 0.5;
+	} else if (strstr(s, "1-0") != NULL) {
+		*result = 1.0;
+	} else if (strstr(s, "0-1") != NULL) {
+		*result = 0.0;
+	} else if ((s = strchr(s, '[')) != NULL) {
+		char * endptr;
+		double r = strtod(s + 1, &endptr);
+		if (*endptr != ']' || r < 0.0 || r > 1.0) {
+			return false;
+		}
+		*result = r;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Read positions with game results, one FEN or EPD per line.
+ */
+bool Tuner::load(const char * filename)
+{
+	FILE * fp = fopen(filename, "r");
+	if (fp == NULL) {
+		printf("Cannot open %s: %s\n", filename, strerror(errno));
+		return false;
+	}
+
+	unsigned long lineno = 0;
+	unsigned long skipped = 0;
+	char buf[1024];
+	while (fgets(buf, sizeof(buf), fp) != NULL) {
+		lineno++;
+		size_t len = strlen(buf);
+		while (len > 0 && (buf[len-1] == '\n' || buf[len-1] == '\r')) {
+			buf[--len] = '\0';
+		}
+		if (len == 0 || buf[0] == '#') {
+			continue;
+		}
+
+		float result;
+		Board board;
+		if (!parse_result(buf, &result)) {
+			printf("%s:%lu: no game result\n", filename, lineno);
+			skipped++;
+			continue;
+		}
+		if (!board.parse_fen(buf)
+				&& !board.parse_fen(EPD(buf).get_fen())) {
+			printf("%s:%lu: cannot parse position\n",
+					filename, lineno);
+			skipped++;
+			continue;
+		}
+		if (!board.is_legal()) {
+			printf("%s:%lu: illegal position\n", filename, lineno);
+			skipped++;
+			continue;
+		}
+
+		const std::string fen = board.get_fen();
+		fen_offsets.push_back(fens.size());
+		fens.insert(fens.end(), fen.begin(), fen.end());
+		fens.push_back('\0');
+		results.push_back((board.get_side() == WHITE)
+				? result : 1.0 - result);
+	}
+	fclose(fp);
+
+	scores.resize(results.size());
+	boards.resize(MIN(CHUNK_SIZE, results.size()));
+
+	printf("Read %lu positions from %s, %lu skipped\n",
+			(unsigned long) results.size(), filename, skipped);
+	return !results.empty();
+}
+
+/*
+ * Compute the quiescence scores of all positions with the current
+ * parameters and return the error.
+ */
+double Tuner::evaluate()
+{
+	struct timeval tv_start, tv_end;
+	gettimeofday(&tv_start, NULL);
+
+	for (size_t first=0; first<results.size(); first+=CHUNK_SIZE) {
+		const size_t n = MIN(CHUNK_SIZE, results.size() - first);
+		for (size_t i=0; i<n; i++) {
+			const char * fen = &fens[fen_offsets[first + i]];
+			if (!boards[i].parse_fen(fen)) {
+				BUG("cannot parse stored position %s", fen);
+			}
+		}
+		Search::evaluate_batch_parallel(&searches[0], searches.size(),
+				&boards[0], n, &scores[first]);
+	}
+
+	gettimeofday(&tv_end, NULL);
+	usecs += (tv_end.tv_sec - tv_start.tv_sec) * 1000000ULL
+		+ tv_end.tv_usec - tv_start.tv_usec;
+	evaluations++;
+
+	return error(k);
+}
+
+/*
+ * Mean squared error of the current scores, mapped to an expected
+ * result by 1 / (1 + 10^(-k * score / 400)).
+ */
+double Tuner::error(double k) const
+{
+	double sum = 0.0;
+	for (size_t i=0; i<results.size(); i++) {
+		const int score = scores[i].quiesce;
+		double expected = 1.0 / (1.0 + pow(10.0, -k * score / 400.0));
+		double d = results[i] - expected;
+		sum += d * d;
+	}
+	return sum / results.size();
+}
+
+/*
+ * Choose the scaling constant k that minimizes the error of the
+ * current scores, by golden section search.
+ */
+void Tuner::tune_k()
+{
+	const double phi = (sqrt(5.0) - 1.0) / 2.0;
+	double a = 0.1, b = 4.0;
+	double c = b - phi * (b - a);
+	double d = a + phi * (b - a);
+	double ec = error(c);
+	double ed = error(d);
+
+	while (b - a > 0.0001) {
+		if (ec < ed) {
+			b = d;
+			d = c;
+			ed = ec;
+			c = b - phi * (b - a);
+			ec = error(c);
+		} else {
+			a = c;
+			c = d;
+			ec = ed;
+			d = a + phi * (b - a);
+			ed = error(d);
+		}
+	}
+
+	k = (a + b) / 2.0;
+}
+
+/*
+ * Tune the parameters whose names are given (all, if names is empty)
+ * for at most the given number of passes over all values. Stops
+ * early if a pass brings no improvement.
+ */
+void Tuner::tune(unsigned int passes, const std::vector<std::string> & names)
+{
+	std::vector<struct coord> coords;
+	for (const struct eval_param * p = Evaluator::params; p->name; p++) {
+		bool selected = names.empty();
+		for (size_t i=0; i<names.size(); i++) {
+			if (names[i] == p->name) {
+				selected = true;
+			}
+		}
+		if (!selected) {
+			continue;
+		}
+		for (unsigned int i=0; i<p->count; i++) {
+			struct coord c;
+			c.value = &p->values[i];
+			c.step = 1;
+			coords.push_back(c);
+			if (p->packed) {
+				c.step = 65536;
+				coords.push_back(c);
+			}
+		}
+	}
+
+	Evaluator::params_changed();
+	evaluate();
+	tune_k();
+	double best = error(k);
+	printf("Tuning %lu values on %lu positions with %lu thread%s,"
+			" k=%.4f, error %.6f\n",
+			(unsigned long) coords.size(),
+			(unsigned long) results.size(),
+			(unsigned long) searches.size(),
+			(searches.size() == 1 ? "" : "s"), k, best);
+
+	for (unsigned int pass=1; pass<=passes; pass++) {
+		unsigned long changed = 0;
+		evaluations = 0;
+		usecs = 0;
+
+		for (size_t i=0; i<coords.size(); i++) {
+			int * v = coords[i].value;
+			const int step = coords[i].step;
+			double e;
+
+			*v += step;
+			Evaluator::params_changed();
+			if ((e = evaluate()) < best) {
+				best = e;
+				changed++;
+				continue;
+			}
+
+			*v -= 2 * step;
+			Evaluator::params_changed();
+			if ((e = evaluate()) < best) {
+				best = e;
+				changed++;
+				continue;
+			}
+
+			*v += step;
+		}
+		Evaluator::params_changed();
+
+		printf("pass %u: error %.6f, %lu of %lu values changed,"
+				" %lu evaluations, %.0f positions/s\n",
+				pass, best, changed,
+				(unsigned long) coords.size(), evaluations,
+				usecs ? (double) evaluations * results.size()
+					* 1000000 / usecs : 0.0);
+		fflush(stdout);
+
+		if (changed == 0) {
+			break;
+		}
+	}
+}
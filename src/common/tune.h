@@ -0,0 +1,88 @@
+/* Copyright (C) 2026 The HoiChess contributors
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef TUNE_H
+#define TUNE_H
+
+#include "common.h"
+#include "board.h"
+#include "eval.h"
+#include "search.h"
+
+#include <string>
+#include <vector>
+
+/* forward declarations */
+class Shell;
+
+/*
+ * Texel style tuning of the evaluation parameters (Evaluator::params[]).
+ *
+ * The positions of a file labelled with game results are resolved by
+ * a quiescence search. The error is the mean squared difference between
+ * the results and the scores mapped to [0,1] by a logistic function.
+ * The parameters are optimized by local search: each value is moved by
+ * one step in either direction, and the change is kept if the error
+ * decreases. The quiescence searches are run in parallel.
+ *
+ * The positions are kept as packed FEN strings, some 60 bytes each, and
+ * Boards are built from them for one chunk at a time when they are
+ * evaluated, so the piece-square sums always match the parameters.
+ */
+class Tuner {
+      private:
+	/* one value to tune */
+	struct coord {
+		int * value;
+		int step;	/* 1, or 65536 for the endgame half of a
+				 * packed value */
+	};
+
+	/* number of Boards built at once by evaluate() */
+	static const size_t CHUNK_SIZE = 4096;
+
+      private:
+	std::vector<Search *> searches;
+	std::vector<char> fens;		/* NUL-terminated, one after another */
+	std::vector<size_t> fen_offsets;
+	std::vector<float> results;	/* from the side to move's point
+					 * of view */
+	std::vector<struct Search::evalresult> scores;
+	std::vector<Board> boards;	/* current chunk */
+	double k;
+
+	/* statistics */
+	unsigned long evaluations;
+	unsigned long long usecs;
+
+      public:
+	Tuner(Shell * shell, unsigned int nthreads);
+	~Tuner();
+
+      public:
+	bool load(const char * filename);
+	void tune(unsigned int passes, const std::vector<std::string> & names);
+
+      private:
+	double evaluate();
+	double error(double k) const;
+	void tune_k();
+	static bool parse_result(const char * s, float * result);
+};
+
+#endif // TUNE_H
@@ -20,6 +20,8 @@
 #include "common.h"
 #include "basic.h"
 #include "board.h"
+#include "eval.h"
+#include "moveparser.h"
 
 #include <time.h>
 
@@ -51,6 +53,8 @@ void init()
 	Bitboard::init();
 #endif
 	Board::init();
+	MoveParser::init();
+	Evaluator::init();
 
 	srand(time(NULL));
 
@@ -53,6 +53,10 @@ void Board::clear()
 
 	material[WHITE] = 0;
 	material[BLACK] = 0;
+	psq_mg[WHITE] = 0;
+	psq_mg[BLACK] = 0;
+	psq_eg[WHITE] = 0;
+	psq_eg[BLACK] = 0;
 
 	for (Square sq = A0; sq <= I9; sq++) {
 		pce_movecnt[sq] = 0;
@@ -60,6 +64,7 @@ void Board::clear()
 	
 	hashkey = NULLHASHKEY;
 	pawnhashkey = NULLHASHKEY;
+	materialkey = NULLHASHKEY;
 }
 
 #ifdef USE_UNMAKE_MOVE
@@ -264,6 +269,24 @@ void Board::switch_sides()
 	pawnhashkey ^= hash_side; // ?
 }
 
+/*
+ * Recompute the piece-square sums, after Evaluator::init() has
+ * changed the piece-square tables.
+ */
+void Board::update_psq()
+{
+	psq_mg[WHITE] = psq_mg[BLACK] = 0;
+	psq_eg[WHITE] = psq_eg[BLACK] = 0;
+	for (Square sq = A0; sq <= I9; sq++) {
+		const Piece p = position_pieces[sq];
+		if (p != NO_PIECE) {
+			const Color c = position_colors[sq];
+			psq_mg[c] += psq_table_mg[c][p][sq];
+			psq_eg[c] += psq_table_eg[c][p][sq];
+		}
+	}
+}
+
 void Board::place_piece(Square sq, Color side, Piece ptype)
 {
 	ASSERT_DEBUG(color_at(sq) == NO_COLOR);
@@ -277,6 +300,9 @@ void Board::place_piece(Square sq, Color side, Piece ptype)
 	}
 	
 	material[side] += mat_values[ptype];
+	materialkey += MATERIALKEY_ONE(side, ptype);
+	psq_mg[side] += psq_table_mg[side][ptype][sq];
+	psq_eg[side] += psq_table_eg[side][ptype][sq];
 	
 	hashkey ^= hashkeys[side][ptype][sq];
 	if (ptype == PAWN) {
@@ -297,6 +323,9 @@ void Board::remove_piece(Square sq, Color side, Piece ptype)
 	}
 	
 	material[side] -= mat_values[ptype];
+	materialkey -= MATERIALKEY_ONE(side, ptype);
+	psq_mg[side] -= psq_table_mg[side][ptype][sq];
+	psq_eg[side] -= psq_table_eg[side][ptype][sq];
 	
 	hashkey ^= hashkeys[side][ptype][sq];
 	if (ptype == PAWN) {
@@ -320,6 +349,11 @@ void Board::move_piece(Square from, Square to, Color side, Piece ptype)
 		king[side] = to;
 	}
 	
+	psq_mg[side] += psq_table_mg[side][ptype][to]
+		- psq_table_mg[side][ptype][from];
+	psq_eg[side] += psq_table_eg[side][ptype][to]
+		- psq_table_eg[side][ptype][from];
+
 	hashkey ^= hashkeys[side][ptype][from];
 	hashkey ^= hashkeys[side][ptype][to];
 	if (ptype == PAWN) {
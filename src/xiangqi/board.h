@@ -49,11 +49,14 @@ class Board
 //	unsigned int 	flags;
 
 	int 		material[2];
+	int		psq_mg[2];	// piece-square sums, see
+	int		psq_eg[2];	// Evaluator::init()
 
 	unsigned int	pce_movecnt[90];
 
 	Hashkey 	hashkey;
 	Hashkey 	pawnhashkey;
+	Hashkey		materialkey;		// piece counts, see basic.h
 
 	
 	
@@ -85,6 +88,9 @@ class Board
 	Hashkey get_pawnhashkey() const
 	{ return pawnhashkey; }
 
+	Hashkey get_materialkey() const
+	{ return materialkey; }
+
 	inline Hashkey get_hashkey_noside() const;
 	inline unsigned int get_pce_movecnt(Square sq) const;
 
@@ -97,6 +103,7 @@ class Board
 	/* Basic board functions, defined in board.cc */
       public:
 	void clear();
+	void update_psq();
 #ifdef USE_UNMAKE_MOVE
 	BoardHistory make_move(Move mov);
 	void unmake_move(const BoardHistory & hist);
@@ -190,6 +197,8 @@ class Board
 	/* Static Data Members */
       private:
 	static Hashkey hashkeys[2][7][90];
+	static int psq_table_mg[2][7][90];
+	static int psq_table_eg[2][7][90];
 	static Hashkey hash_side;
 
 	/* Static Member Functions */
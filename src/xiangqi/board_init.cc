@@ -23,6 +23,8 @@
 
 
 Hashkey Board::hashkeys[2][7][90];
+int Board::psq_table_mg[2][7][90];
+int Board::psq_table_eg[2][7][90];
 Hashkey Board::hash_side;
 
 
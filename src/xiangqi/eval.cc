@@ -51,8 +51,11 @@ int Evaluator::material_balance(int ms, int mxs)
  */
 unsigned int Evaluator::get_phase(const Board & board)
 {
-	const int mat = board.material[WHITE] + board.material[BLACK];
+	return get_phase(board.material[WHITE] + board.material[BLACK]);
+}
 
+unsigned int Evaluator::get_phase(int mat)
+{
 	/* Starting material is 2*4800 = 9600 */
 	if (mat > 8600) {
 		return OPENING;
@@ -63,6 +66,106 @@ unsigned int Evaluator::get_phase(const Board & board)
 	}
 }
 
+/*
+ * Continuous version of get_phase(), used to interpolate between
+ * midgame and endgame scores.
+ */
+int Evaluator::get_phase_weight(const Board & board)
+{
+	return get_phase_weight(board.material[WHITE] + board.material[BLACK]);
+}
+
+int Evaluator::get_phase_weight(int mat)
+{
+	const int mat_opening = 8600;
+	const int mat_endgame = 5400;
+
+	if (mat >= mat_opening) {
+		return PHASE_WEIGHT_MAX;
+	} else if (mat <= mat_endgame) {
+		return 0;
+	} else {
+		return (mat - mat_endgame) * PHASE_WEIGHT_MAX
+			/ (mat_opening - mat_endgame);
+	}
+}
+
+/*
+ * Fill a material table entry from the material signature alone.
+ */
+void Evaluator::compute_material(Hashkey key, MaterialEntry * e)
+{
+	unsigned int count[2][7];
+	int mat[2];
+
+	for (Color c = WHITE; c <= BLACK; c++) {
+		mat[c] = 0;
+		for (Piece p = PAWN; p <= KING; p++) {
+			count[c][p] = MATERIALKEY_COUNT(key, c, p);
+			mat[c] += count[c][p] * mat_values[p];
+		}
+	}
+
+	e->imbalance = material_balance(mat[WHITE], mat[BLACK]);
+	e->phase = get_phase(mat[WHITE] + mat[BLACK]);
+	e->phase_weight = get_phase_weight(mat[WHITE] + mat[BLACK]);
+	e->endgame = NULL;
+	e->strong = NO_COLOR;
+
+	for (Color c = WHITE; c <= BLACK; c++) {
+		const Color xc = XSIDE(c);
+		const unsigned int attackers = count[c][PAWN]
+			+ count[c][KNIGHT] + count[c][CANNON] + count[c][ROOK];
+
+		/* Guards and elephants cannot leave their own half of
+		 * the board, so a side with nothing else cannot win. */
+		e->scale[c] = (attackers == 0)
+			? 0 : MaterialEntry::SCALE_NORMAL;
+
+		/* Rook against a lone king */
+		if (mat[xc] == 0 && count[c][ROOK]) {
+			e->strong = c;
+			e->endgame = &endgame_krk;
+		}
+	}
+}
+
+/*
+ * KRK (and more): Drive the lone king out of the center of its
+ * palace, where it is hardest to mate.
+ */
+int Evaluator::endgame_krk(const Board & board, Color strong)
+{
+	const Color weak = XSIDE(strong);
+	const Square wk = board.get_king(weak);
+	const Square palace = (weak == WHITE) ? E1 : E8;
+
+	return board.material[strong]
+		+ board.psq_eg[strong] - board.psq_eg[weak]
+		+ 20 * sq_distance(wk, palace);
+}
+
+/*
+ * Fill the piece-square tables of class Board, which are used to
+ * update Board::psq_mg and Board::psq_eg incrementally. Must be called
+ * after Board::init() and before any Board is set up.
+ */
+void Evaluator::init()
+{
+	for (Square sq = A0; sq <= I9; sq++) {
+		for (Color c = WHITE; c <= BLACK; c++) {
+			const Square idx = (c == WHITE) ? sq
+	                        : SQUARE(XRNK(RNK(sq)), FIL(sq));
+			for (Piece p = PAWN; p <= KING; p++) {
+				Board::psq_table_mg[c][p][sq] =
+					positional_scores[p][idx];
+				Board::psq_table_eg[c][p][sq] =
+					positional_scores[p][idx];
+			}
+		}
+	}
+}
+
 void Evaluator::setup(const Board * board)
 {
 	ASSERT_DEBUG(board != NULL);
@@ -71,18 +174,15 @@ void Evaluator::setup(const Board * board)
 //	const Color side = board->get_side();
 //	const Color xside = XSIDE(side);
 
-	phase = get_phase(*board);
-
 #if 0
 	if (pawnhashtable) {
-		if (pawnhashtable->probe(board->get_pawnhashkey(),
-					&pawnhashentry)){
-			if (pawnhashentry.get_phase() == phase) {
-				pawnhashtable->incr_hits2();
-			}
-		}
 		/* probe() marks entry invalid if nothing was found in
 		 * the table, so we don't need to do this here again. */
+		stat_pawnhash_probes++;
+		if (pawnhashtable->probe(board->get_pawnhashkey(),
+					&pawnhashentry)) {
+			stat_pawnhash_hits++;
+		}
 	} else {
 		pawnhashentry.set_invalid();
 	}
@@ -111,19 +211,29 @@ void Evaluator::finish()
  *****************************************************************************/
 
 const struct score_plugin Evaluator::plugins[] = {
-	{ "positional",	&Evaluator::score_positional	},
+	SCORE_PLUGIN("positional",	score_positional),
 
-	{ NULL, NULL }
+	{ NULL, { NULL, NULL } }
 };
 
 const struct score_plugin Evaluator::plugins2[] = {
-//	{ "control",	&Evaluator::score_control	},
+//	SCORE_PLUGIN("control",	score_control),
 
-	{ NULL, NULL }
+	{ NULL, { NULL, NULL } }
 };
 
 
-const int Evaluator::positional_scores[][90] = {
+/*
+ * Tunable parameters, changed at runtime by "evalparams load" and by
+ * the tuner.
+ */
+const struct eval_param Evaluator::params[] = {
+	{ "positional_scores",	&positional_scores[0][0], 7 * 90, false },
+
+	{ NULL, NULL, 0, false }
+};
+
+int Evaluator::positional_scores[][90] = {
 	{ // PAWN
 	  0,  0,  0,  0,  0,  0,  0,  0,  0,
 	  0,  0,  0,  0,  0,  0,  0,  0,  0,
@@ -217,27 +327,28 @@ const int Evaluator::positional_scores[][90] = {
 };
 
 
-int Evaluator::score_positional(Color side)
+/*
+ * The piece-square scores from positional_scores[] are summed up
+ * incrementally by class Board, see init(). What remains here is
+ * non-incremental.
+ */
+template <Color side>
+int Evaluator::score_positional()
 {
 	int score = 0;
 
+	/* penalize repetition, midgame only */
+	if (phase_weight == 0) {
+		return score;
+	}
+
 	for (Square sq=A0; sq<=I9; sq++) {
 		if (board->color_at(sq) != side) {
 			continue;
 		}
 
-		Piece ptype = board->piece_at(sq);
-	
-		/* positional score */
-		Square idx = (side == WHITE) ? sq
-	                        : SQUARE(XRNK(RNK(sq)), FIL(sq));
-		score += positional_scores[ptype][idx];
-
-		/* penalize repetition during opening phase */
-		if (phase == OPENING) {
-			score += - (board->get_pce_movecnt(sq)-1)*2;
-		}
+		score += - (board->get_pce_movecnt(sq)-1)*2;
 	}
 	
-	return score;
+	return SCORE(score, 0);
 }
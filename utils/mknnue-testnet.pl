@@ -0,0 +1,66 @@
+#!/usr/bin/perl
+#
+# Write a tiny HalfKP network for HoiChess ("nnue load <file>").
+#
+# The weights are set by hand, not trained: the network computes
+# material, pawn advancement and minor piece centralization for both
+# sides, which is enough to test the NNUE code and to benchmark it.
+#
+# Usage: mknnue-testnet.pl <file>
+
+use warnings;
+use strict;
+
+my $HALF = 32;
+my $HIDDEN = 32;
+my $DIVISOR = 1;
+
+# material / 32 for PAWN KNIGHT BISHOP ROOK QUEEN
+my @material = (3, 9, 10, 16, 28);
+
+my $file = shift or die "Usage: $0 <file>\n";
+open(my $fh, ">", $file) or die "Cannot open $file: $!\n";
+binmode($fh);
+
+print $fh "HOINNUE1";
+print $fh pack("V3", $HALF, $HIDDEN, $DIVISOR);
+
+# feature transformer bias
+print $fh pack("v*", (0) x $HALF);
+
+# Feature transformer weights. A row only depends on piece, color and
+# square (relative to the perspective), not on the king square.
+my $rows = "";
+for my $piece (0 .. 4) {
+	for my $enemy (0 .. 1) {
+		for my $sq (0 .. 63) {
+			my ($rnk, $fil) = (int($sq / 8), $sq % 8);
+			my @w = (0) x $HALF;
+			$w[0 + $enemy] = $material[$piece];
+			if ($piece == 0) {
+				$w[2 + $enemy] = $enemy ? 6 - $rnk : $rnk - 1;
+			} elsif ($piece == 1 || $piece == 2) {
+				my $d = abs(2 * $rnk - 7) + abs(2 * $fil - 7);
+				$w[4 + $enemy] = int((14 - $d) / 4);
+			}
+			$rows .= pack("v*", map { $_ & 0xffff } @w);
+		}
+	}
+}
+print $fh $rows for (1 .. 64);
+
+# hidden layer: pass through the first six inputs (side to move half)
+print $fh pack("V*", (0) x $HIDDEN);
+for my $j (0 .. $HIDDEN - 1) {
+	my @w = (0) x (2 * $HALF);
+	$w[$j] = 64 if ($j < 6);
+	print $fh pack("c*", @w);
+}
+
+# output layer
+print $fh pack("V", 0);
+my @o = (32, -32, 3, -3, 4, -4);
+push(@o, (0) x ($HIDDEN - @o));
+print $fh pack("c*", @o);
+
+close($fh) or die "Cannot write $file: $!\n";